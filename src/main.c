@@ -3,20 +3,48 @@
 #include <stdlib.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // World constants
-#define WORLD_WIDTH 4000
-#define WORLD_HEIGHT 4000
+// The world is unbounded; the village sits at a fixed point and the desert is
+// streamed in chunks around the camera (see "World streaming" below).
+#define VILLAGE_X 2000.0f
+#define VILLAGE_Y 2000.0f
 #define PLAYER_SPEED 175.0f
-#define NUM_SCAVENGE_ITEMS 18
+#define GLIDER_SPEED_MULT 8.0f      // sand glider: 1400 px/s
+#define GLIDER_ACCEL      1.5f      // boost ramp-up per second
+#define GLIDER_BRAKE      6.0f      // boost ramp-down per second (terrain not ready)
 #define NUM_PARTICLES 15
+#define PARTICLE_FIELD_HALF_W 800   // particles wrap inside this box around the camera
+#define PARTICLE_FIELD_HALF_H 500
 #define NUM_CITY_BUILDINGS 6
 #define MAX_INVENTORY 10
 #define PICKUP_RADIUS 50.0f
 #define PICKUP_EFFECT_DURATION 0.3f
 #define FULL_MSG_DURATION 2.0f
 
+// Item types come from ITEM_DEFS_PATH (built-in defaults if it is missing);
+// their sprites are scaled and packed into one atlas texture at startup
+#define ITEM_DEFS_PATH    "assets/items.txt"
+#define ITEM_MAX_TYPES    8192      // scavenger cargo holds type + 1 in 16 bits
+#define ITEM_MAX_WEIGHT   500000    // ITEM_MAX_TYPES of these still sum within 32 bits
+#define ITEM_MAX_TOKENS   1000
+#define ITEM_SPRITE_PX    80        // longest atlas side of a sprite (32 px drawn, up to 2.5x zoom)
+#define ITEM_ATLAS_WIDTH  1024
+#define ITEM_ATLAS_MAX_H  4096      // sprites that do not fit are drawn as dots
+#define ITEM_ATLAS_PAD    2         // clear gap between sprites against filtering bleed
+
 // Day/night cycle
 #define DAY_DURATION 180.0f
 
@@ -27,9 +55,220 @@
 
 // Sprite / ground tile constants
 #define GROUND_TILE_SIZE  256
-#define GROUND_TILES_X    ((WORLD_WIDTH  / GROUND_TILE_SIZE) + 2)
-#define GROUND_TILES_Y    ((WORLD_HEIGHT / GROUND_TILE_SIZE) + 2)
-#define NUM_TERRAIN_ACCENTS 20
+
+// Camera zoom (mouse wheel), from close-up to a region overview
+#define ZOOM_MIN          0.15f
+#define ZOOM_MAX          2.5f
+#define ZOOM_WHEEL_STEP   0.15f   // log-zoom change per wheel notch
+#define ZOOM_SMOOTHING    10.0f   // 1/s, eases camera.zoom toward the target
+#define CAMERA_FOLLOW     6.32f   // 1/s, eases camera.target toward the player (0.1 per 60 Hz tick)
+
+// Level of detail, by on-screen size in pixels
+#define LOD_IMPOSTOR_TILE_PX  96.0f  // ground tiles smaller than this are flat-color rects
+#define LOD_DUNE_MIN_PX       0.75f  // thinner dune lines are skipped
+#define LOD_ACCENT_MIN_PX     12.0f  // smaller terrain accents are skipped
+#define LOD_POINT_SPRITE_PX   8.0f   // smaller item sprites become colored points
+#define LOD_LABEL_MIN_ZOOM    0.75f  // item labels hidden below this zoom
+#define LOD_EFFECTS_MIN_ZOOM  0.4f   // spawn shimmers hidden below this zoom
+#define LOD_MARKER_MAX_ZOOM   0.5f   // player marker ring shown below this zoom
+
+// World streaming: the desert is cut into CHUNK_SIZE x CHUNK_SIZE chunks that are
+// generated from (seed, chunk coords) when the camera nears them and evicted LRU
+#define CHUNK_SIZE          1024
+#define CHUNK_TILES         (CHUNK_SIZE / GROUND_TILE_SIZE)   // ground tiles per chunk side
+#define CHUNK_MAX_ITEMS     4
+#define CHUNK_MAX_ACCENTS   6
+#define CHUNK_MAX_DUNES     3
+#define CHUNK_CELLS         64                          // terrain noise samples per chunk side
+#define CHUNK_CELL_SIZE     (CHUNK_SIZE / CHUNK_CELLS)  // 16px
+#define CHUNK_LOAD_MARGIN   512.0f  // keep chunks this far outside the view loaded
+#define MAX_LOADED_CHUNKS   192     // load rect + prefetch + one frame's installs (see CHUNK_VIEW_BUDGET)
+#define CHUNK_VIEW_BUDGET   96      // most chunks the load rect may span; big windows raise the minimum zoom
+#define VILLAGE_CLEAR_RADIUS 300.0f // no accents this close to the village
+#define HEAT_SHIMMER_RADIUS 3000.0f // deep desert starts this far from the village
+
+// Terrain noise (wavelengths in world pixels)
+#define NOISE_HEIGHT_WAVELENGTH  900.0f   // sand tone / dune height
+#define NOISE_RIDGE_WAVELENGTH   700.0f   // dune crests where ridged noise peaks
+#define NOISE_DEBRIS_WAVELENGTH  1600.0f  // debris field density
+#define DUNE_RIDGE_THRESHOLD     0.92f
+#define DUNE_STEP                40.0f    // crest tracing step
+
+// Minimap: a toroidal overview texture with one MINIMAP_CHUNK_PX block per chunk.
+// Chunk (cx, cy) always lands in block (cx mod N, cy mod N); a block is redrawn
+// only when its chunk is installed or its items change.
+#define MINIMAP_BLOCKS          24    // blocks per texture side (N)
+#define MINIMAP_CHUNK_PX        8     // texels per chunk side
+#define MINIMAP_TEX_SIZE        (MINIMAP_BLOCKS * MINIMAP_CHUNK_PX)
+#define MINIMAP_VIEW_CHUNKS     20    // chunks shown across; < N leaves slack for wrap
+#define MINIMAP_VIEW_PX         (MINIMAP_VIEW_CHUNKS * MINIMAP_CHUNK_PX)
+#define COL_MINIMAP_UNEXPLORED  (Color){ 60, 52, 44, 255 }
+
+// Game save: header and section table, then each section's records exactly as
+// they sit in memory (SimState, the overlay hash table), so a load maps the
+// file and copies them back. The world itself is the 64-bit seed.
+#define GAME_SAVE_PATH      "game.sav"
+#define GAME_SAVE_MAGIC     0x53435441u   // "ATCS"
+#define GAME_SAVE_VERSION   3             // bump whenever a saved struct changes
+#define SAVE_SECTION_ALIGN  16
+#define OVERLAY_MIN_CAPACITY 64
+
+// Autosave: the sim copies the save state into a snapshot, a background job
+// writes it DEFLATE-packed to the next of AUTOSAVE_SLOTS rolling files
+#define AUTOSAVE_INTERVAL   120.0f
+#define AUTOSAVE_SLOTS      3
+#define AUTOSAVE_PATH_FMT   "autosave_%d.sav"
+#define AUTOSAVE_MAGIC      0x5A435441u   // "ATCZ"
+
+// State journal: item changes and the sim state are appended to game.journal
+// as they happen, on top of game.sav; past JOURNAL_COMPACT_BYTES the two are
+// folded into a new game.sav and the journal starts over
+#define JOURNAL_PATH            "game.journal"
+#define JOURNAL_MAGIC           0x4A435441u   // "ATCJ"
+#define JOURNAL_VERSION         1
+#define JOURNAL_FLUSH_INTERVAL  2.0f          // seconds; the most a crash loses
+#define JOURNAL_COMPACT_BYTES   (1 << 20)
+#define JOURNAL_MIN_BUFFER      4096
+
+// Rewind: the sim state of every tick goes into a ring, a full keyframe each
+// REWIND_KEYFRAME_TICKS and only the changed words in between. F7 scrubs it.
+#define REWIND_SECONDS          10
+#define REWIND_FRAMES           (REWIND_SECONDS * SIM_TICK_HZ)
+#define REWIND_KEYFRAME_TICKS   60
+#define REWIND_DATA_BYTES       (256 << 10)  // every frame a keyframe would still fit
+#define REWIND_HITCH_MS         25.0  // a tick this long is remembered for F8
+
+// Static collision: colliders live in a spatial hash of COLLISION_CELL_SIZE
+// cells, so a mover only ever tests the few cells its bounds overlap
+#define COLLISION_CELL_SIZE   128
+#define COLLISION_CELL_CAP    8      // colliders referenced per cell
+#define COLLISION_HASH_SIZE   8192   // cell slots (power of two)
+#define MAX_COLLIDERS         2048
+#define PLAYER_RADIUS         12.0f
+#define DEBRIS_COLLIDER_W     40.0f  // footprint of a debris accent
+#define DEBRIS_COLLIDER_H     24.0f
+#define NUM_VILLAGE_BUILDINGS 4
+
+// Pathfinding: jump point search on a coarse walkability grid rasterized from
+// the static colliders, with a chunk-level planner in front for long routes
+#define PATH_CELL_SIZE      32       // walkability grid resolution (px)
+#define PATH_WINDOW_MAX     192      // local search window, cells per side
+#define PATH_WINDOW_PAD     16       // cells of slack around start and goal
+#define PATH_LOCAL_RANGE    2048.0f  // longer legs go through the chunk planner
+#define PATH_CHUNK_WINDOW   48       // chunk planner window, chunks per side
+#define PATH_MAX_POINTS     128
+#define PATH_MAX_CORRIDOR   64
+#define PATH_CACHE_SIZE     16
+#define PATH_ARRIVE_RADIUS  6.0f
+#define PATH_MAX_EXPANSIONS 1500     // jump points per search (keeps a query well under 1ms)
+
+// Scavenger crowds: shared flow fields on a grid around the village steer a
+// structure-of-arrays crowd; no per-agent path search
+#define FLOW_CELL_SIZE      64
+#define FLOW_GRID           128      // cells per side (8192px, centered on the village)
+#define FLOW_CELLS          (FLOW_GRID * FLOW_GRID)
+#define FLOW_BUILD_SLICE    1024     // cells between deadline checks while rebuilding
+#define FLOW_ITEM_REFRESH   1.0f     // seconds between item-field rebuilds
+#define FLOW_VILLAGE_RADIUS 160.0f   // drop-off area around the village center
+#define FLOW_GATE_RADIUS    96.0f
+#define FLOW_DIR_GOAL       8
+#define FLOW_DIR_NONE       255
+#define NUM_SCAVENGERS      5000
+#define SCAV_SPEED          70.0f
+#define SCAV_RADIUS         6.0f
+#define SCAV_BUDGET_MS      2.0
+#define SCAV_SECTOR_SIZE    1024     // crowd is binned into sectors for sim LOD
+#define SCAV_SECTORS        (FLOW_GRID * FLOW_CELL_SIZE / SCAV_SECTOR_SIZE)
+#define SCAV_CATCHUP_MAX    2.0f     // seconds of straight-line motion granted on catch-up
+
+// Frame-budget scheduler: deferrable jobs run in whatever the frame budget has
+// left after the frame's own CPU work (tracked as a moving average)
+#define FRAME_BUDGET_MS         16.6
+#define FRAME_SAFETY_MS         2.0     // headroom for swap and timing jitter
+#define FRAME_WORK_SMOOTHING    0.1     // moving-average weight of the newest frame
+#define DEFERRED_MAX_JOBS       8
+#define DEFERRED_STARVE_FRAMES  30      // pending this long: run a minimal slice anyway
+#define DEFERRED_MIN_SLICE_MS   0.25
+
+// Simulation level of detail: things near the view tick every frame, further
+// rings every SIM_LOD_MID/FAR_STRIDE ticks with the elapsed time, and beyond
+// SIM_LOD_FAR_PAD nothing ticks until it comes back (one closed-form step)
+#define SIM_LOD_NEAR_PAD    256.0f
+#define SIM_LOD_MID_PAD     2048.0f
+#define SIM_LOD_FAR_PAD     6144.0f
+#define SIM_LOD_MID_STRIDE  4
+#define SIM_LOD_FAR_STRIDE  16
+
+// Job system: one shared worker pool with work-stealing deques (the sim
+// thread is deque 0 and helps while it waits); long jobs go on a background
+// queue that only the workers take from
+#define JOB_MAX_WORKERS          7
+#define JOB_DEQUE_SIZE           1024  // per thread (power of two)
+#define JOB_POOL_SIZE            1024  // job records per thread, reused in a ring
+#define JOB_SPIN_TRIES           64    // idle polls before a worker sleeps
+
+// Sim / render split: the sim thread ticks at SIM_TICK_HZ and publishes a
+// snapshot of everything that is drawn; the main thread renders the newest
+#define SIM_TICK_HZ              60
+#define SIM_MAX_DT               0.1f  // longer stalls are not caught up in one tick
+#define RENDER_CHUNK_PAD         700.0f  // dune arcs reach this far outside their chunk
+#define MINIMAP_UPLOAD_RING      64    // minimap blocks queued for the render thread (power of two)
+
+// Frame pacing: the main thread renders at the F6 frame cap, drawing the
+// sim state interpolated between the last two ticks
+#define RENDER_FALLBACK_HZ       60      // when the monitor refresh rate is unknown
+#define RENDER_VRR_MARGIN        3       // "display" cap stays this far under refresh, inside the VRR range
+#define RENDER_SPIN_MARGIN       0.0015  // seconds before a frame deadline spent spinning, not sleeping
+#define RENDER_SNAP_DIST         400.0f  // a jump this long in one tick (load, rewind) is not interpolated
+
+// The window is resizable down to the widest UI panel (trade, 940x580) plus
+// a margin, and HiDPI aware: everything works in screen units and raylib
+// scales the framebuffer
+#define WINDOW_MIN_WIDTH         1000
+#define WINDOW_MIN_HEIGHT        640
+
+// Power saving: unfocused windows draw at RENDER_UNFOCUSED_HZ; a static
+// screen (modal open, no input for RENDER_IDLE_DELAY) redraws on input and
+// otherwise at RENDER_IDLE_HZ; a minimized window pauses the sim and only
+// polls for events. The sim then skips building snapshots nobody draws.
+#define RENDER_UNFOCUSED_HZ      10
+#define RENDER_IDLE_HZ           4
+#define RENDER_IDLE_DELAY        0.5     // seconds
+#define RENDER_MINIMIZED_POLL    0.1     // seconds
+#define SIM_THROTTLED_PUBLISH    (SIM_TICK_HZ / RENDER_UNFOCUSED_HZ)  // ticks per snapshot when not active
+
+// Input: between frames the main thread samples input every
+// INPUT_SAMPLE_PERIOD and queues timestamped events for the sim
+#define INPUT_SAMPLE_PERIOD      0.001   // seconds
+#define INPUT_IDLE_SAMPLE_PERIOD 0.01    // between throttled frames
+#define INPUT_QUEUE_SIZE         256     // power of two
+#define UI_INPUT_MAX             16      // clicks / ESC presses per rendered frame
+
+// Logging: a log call copies its format and arguments into a lock-free ring;
+// a writer thread formats and prints them, so no game thread touches stdio
+#define LOG_RING_SIZE            1024  // records (power of two)
+#define LOG_MAX_ARGS             6     // conversions captured per record
+#define LOG_IDLE_SLEEP_NS        2000000L
+#ifdef CLOCK_MONOTONIC_COARSE
+#define LOG_CLOCK                CLOCK_MONOTONIC_COARSE  // ms resolution, no syscall
+#else
+#define LOG_CLOCK                CLOCK_MONOTONIC
+#endif
+
+// Background chunk generation
+#define CHUNK_GEN_SLOTS          2    // pool workers generating chunks at once
+#define CHUNK_JOB_POOL           32   // max in-flight requests (power of two)
+#define CHUNK_INSTALLS_PER_FRAME 4    // finished chunks installed per frame while some are missing
+#define PREFETCH_SECONDS         3.0f // look-ahead along the camera's velocity
+#define PREFETCH_MIN_SPEED       50.0f
+#define PREFETCH_MAX_CHUNKS      56   // loaded chunks the prefetch sweep may pin per frame
+#define CHUNK_WAIT_TIMEOUT       5.0  // blocking waits for the load rect give up after this (s)
+
+// Chunks touched in a frame are never evicted, so everything one frame can
+// touch has to fit: the load rect, the prefetch sweep, and installs (the
+// urgent ones plus every in-flight job finishing)
+_Static_assert(CHUNK_VIEW_BUDGET + PREFETCH_MAX_CHUNKS + CHUNK_INSTALLS_PER_FRAME + CHUNK_JOB_POOL
+               <= MAX_LOADED_CHUNKS, "a frame can pin more chunks than the cache holds");
 
 // Sandstorm states
 typedef enum {
@@ -47,16 +286,16 @@ typedef enum {
 } WorkbenchState;
 
 // Workbench world position (building1 is at villageCenter - (100,80), bench is centered inside)
-// villageCenter = (WORLD_WIDTH/2, WORLD_HEIGHT/2) = (2000, 2000)
+// villageCenter = (VILLAGE_X, VILLAGE_Y) = (2000, 2000)
 // building1.x = 2000 - 100 = 1900, building1.y = 2000 - 80 = 1920, w=80, h=60
 // bench center x = 1900 + 80/2 = 1940, bench center y = 1920 + 60 - 18 = 1962
-#define WORKBENCH_X (WORLD_WIDTH / 2.0f - 100.0f + 80.0f / 2.0f)
-#define WORKBENCH_Y (WORLD_HEIGHT / 2.0f - 80.0f + 60.0f - 18.0f)
+#define WORKBENCH_X (VILLAGE_X - 100.0f + 80.0f / 2.0f)
+#define WORKBENCH_Y (VILLAGE_Y - 80.0f + 60.0f - 18.0f)
 
 // City gate position: villageCenter + (200, 0)
 // villageCenter = (2000, 2000), so gate is at (2200, 2000)
-#define GATE_X (WORLD_WIDTH / 2.0f + 200.0f)
-#define GATE_Y (WORLD_HEIGHT / 2.0f)
+#define GATE_X (VILLAGE_X + 200.0f)
+#define GATE_Y (VILLAGE_Y)
 #define GATE_INTERACT_RADIUS 70.0f
 
 // --- New palette ---
@@ -68,6 +307,10 @@ typedef enum {
 #define COL_DUNE_LINE      (Color){ 184, 152, 106, 255 }
 #define COL_HAZE           (Color){ 212, 196, 168, 255 }
 
+// Scavengers
+#define COL_SCAV_ROBE      (Color){ 122, 104, 84, 255 }
+#define COL_SCAV_HEAD      (Color){ 88,  72,  58, 255 }
+
 // Z / Player
 #define COL_Z_BODY         (Color){ 92,  61,  46, 255 }
 #define COL_Z_HEAD         (Color){ 107, 76,  61, 255 }
@@ -105,34 +348,41 @@ typedef enum {
 #define COL_ALMOST_WHITE   (Color){ 240, 235, 224, 255 }
 #define COL_DIVIDER        (Color){ 255, 255, 255, 21  }
 
-// Item type enum
-typedef enum {
-    ITEM_ELECTRONICS,
-    ITEM_POWER,
-    ITEM_OPTICS,
-    ITEM_STRUCTURAL
-} ItemCategory;
-
-// Item type definition (static data)
+// Item type definition, one line of the item data file. The strings point
+// into the table's copy of the file.
 typedef struct {
+    const char *id;             // unique key (hash index)
     const char *name;
-    ItemCategory category;
+    int         category;       // interned categoryName; repairs match on it
     const char *categoryName;
-    Color color;
+    Color       color;
+    const char *spritePath;     // "" = no sprite
+    float       repairBonus;    // extra condition on a same-category repair
+    int         tradeTokens;
+    int         spawnWeight;
+    Rectangle   atlasRect;      // in Sprites.itemAtlas; width 0 = drawn as a dot
 } ItemTypeDef;
 
-static const ItemTypeDef ITEM_TYPES[] = {
-    { "Circuit Board", ITEM_ELECTRONICS, "ELECTRONICS", { 107, 123, 107, 255 } },
-    { "Wire Bundle",   ITEM_ELECTRONICS, "ELECTRONICS", { 184, 115,  51, 255 } },
-    { "Battery Cell",  ITEM_POWER,       "POWER",       { 139,  58,  58, 255 } },
-    { "Lens Array",    ITEM_OPTICS,      "OPTICS",      { 135, 206, 235, 255 } },
-    { "Metal Plating", ITEM_STRUCTURAL,  "STRUCTURAL",  { 168, 168, 168, 255 } }
-};
-#define NUM_ITEM_TYPES 5
+// Every item type, loaded once before the sim starts and read-only after, so
+// both threads share it. Lookups by id go through an open-addressing index
+// of id hashes; world spawns pick a type by binary search over cumulative
+// spawn weights.
+typedef struct {
+    ItemTypeDef  *types;
+    int           count, capacity;
+    const char  **categories;   // interned names, by category number
+    int           numCategories;
+    int          *index;        // type + 1 per slot, 0 = empty
+    unsigned int  indexMask;
+    unsigned int *spawnCumulative;
+    unsigned int  spawnTotal;
+    unsigned int  hash;         // ids and weights in order; saves record it
+    char         *text;         // the data file, split in place
+} ItemTable;
 
 // World item (exists in the world, can be picked up)
 typedef struct {
-    int typeIndex;      // index into ITEM_TYPES
+    int typeIndex;      // index into itemTable.types
     float condition;    // 0.3 - 0.9
     Vector2 position;
     bool active;        // true = visible, false = picked up
@@ -165,13 +415,6 @@ typedef struct {
     Vector2 velocity;
 } Particle;
 
-// Ground soft circle (stored once at startup)
-typedef struct {
-    Vector2 center;
-    float radius;
-    Color color;
-} GroundCircle;
-
 // Dune line: stored as a series of points approximating a sweeping arc
 #define DUNE_SEGMENTS 12
 typedef struct {
@@ -184,10 +427,6 @@ typedef struct {
     int heights[NUM_CITY_BUILDINGS];
 } CityBuildings;
 
-// Static initialized arrays
-#define NUM_GROUND_CIRCLES 18
-#define NUM_DUNE_LINES 6
-
 // --- Visual enhancement structs ---
 
 // Footprint
@@ -237,10 +476,11 @@ typedef struct {
     Texture2D z_right;
     // Building sprites
     Texture2D building[5];  // building_1..5
-    // Item sprites
-    Texture2D item[5];      // circuit, wire, battery, lens, metal
+    // Item sprites, packed (ItemTypeDef.atlasRect)
+    Texture2D itemAtlas;
     // Ground tile sprites
     Texture2D ground[3];    // ground_1..3
+    Color     groundAvg[3]; // average color of each ground tile (zoomed-out impostor)
     // Terrain accent sprites
     Texture2D dune[3];      // dune_1..3
     Texture2D debris1;      // debris_1
@@ -253,6 +493,366 @@ typedef struct {
     int     spriteIdx; // 0=dune_1, 1=dune_2, 2=dune_3, 3=debris_1
 } TerrainAccent;
 
+// One streamed chunk of desert: ground tiles, dune arcs, accents and the items
+// that spawn in it. Everything here is regenerated from (seed, cx, cy).
+typedef struct {
+    int  cx, cy;                    // chunk coordinates (floor(world / CHUNK_SIZE))
+    bool loaded;
+    unsigned int lastUsedFrame;     // LRU stamp, refreshed while near the camera
+    unsigned char tiles[CHUNK_TILES][CHUNK_TILES];  // ground sprite index 0-2
+    unsigned char height[CHUNK_CELLS][CHUNK_CELLS]; // dune height 0-255 per 16px cell
+    DuneLine      dunes[CHUNK_MAX_DUNES];
+    int           numDunes;
+    TerrainAccent accents[CHUNK_MAX_ACCENTS];
+    int           numAccents;
+    WorldItem     items[CHUNK_MAX_ITEMS];
+    SpawnShimmer  shimmers[CHUNK_MAX_ITEMS];  // one shimmer slot per item
+    int           numItems;
+    unsigned char modifiedMask;     // bit i set = items[i] was changed by play
+    unsigned char journalMask;      // bit i set = items[i] changed since the last journal flush
+    bool          minimapDirty;     // terrain or items changed since last minimap upload
+    short         colliders[CHUNK_MAX_ACCENTS];  // ids in the CollisionWorld, set on install
+    int           numColliders;
+    double        simTime;          // sim clock the item timers were advanced to (< 0 = fresh)
+    unsigned char pendingRespawn;   // bit i set = items[i] timed out, awaiting placement
+} Chunk;
+
+// Player-caused changes to one chunk. Only items whose bit is set in itemMask
+// are stored; everything else is regenerated from the seed.
+typedef struct {
+    int  cx, cy;
+    bool used;
+    unsigned char itemMask;
+    WorldItem items[CHUNK_MAX_ITEMS];
+} ChunkDiff;
+
+// Sparse overlay of every chunk the player has changed (open-addressed hash
+// table keyed by chunk coords, capacity is a power of two)
+typedef struct {
+    ChunkDiff *entries;
+    int        capacity;
+    int        count;
+} WorldOverlay;
+
+typedef enum {
+    SAVE_SECTION_STATE,         // one SimState
+    SAVE_SECTION_OVERLAY,       // WorldOverlay.entries, every slot of the hash table
+    SAVE_SECTION_COUNT
+} SaveSectionId;
+
+typedef struct {
+    unsigned int       id;
+    unsigned int       recordSize;  // sizeof(record) when written; a mismatch rejects the file
+    unsigned int       count;
+    unsigned int       checksum;    // SaveChecksum of the section's bytes
+    unsigned long long offset;      // from the start of the file, SAVE_SECTION_ALIGN aligned
+} SaveSection;
+
+typedef struct {
+    unsigned int       magic, version;
+    unsigned long long fileSize;
+    unsigned long long seed;
+    int                overlayCount;    // used slots in the overlay section
+    unsigned int       sectionCount;
+    unsigned int       checksum;        // of this header, computed with checksum = 0
+    unsigned int       journalId;       // the game.journal that extends this save (0 = none)
+    unsigned int       itemTableHash;   // ItemTable.hash; item indices and respawns depend on it
+    SaveSection        sections[SAVE_SECTION_COUNT];
+} SaveHeader;
+
+// Autosave file: this header, then a whole save image compressed
+typedef struct {
+    unsigned int       magic;
+    unsigned int       checksum;    // SaveChecksum of the compressed bytes
+    unsigned long long rawSize;     // size of the save image they inflate to
+} PackedSaveHeader;
+
+// Axis-aligned static collider; free slots chain through nextFree
+typedef struct {
+    Rectangle box;
+    int       nextFree;
+} Collider;
+
+// One broadphase cell; count == 0 marks an empty hash slot
+typedef struct {
+    int   x, y;
+    int   count;
+    short ids[COLLISION_CELL_CAP];
+} CollisionCell;
+
+// Static colliders (village, gate, debris) indexed by a linear-probing spatial hash
+typedef struct {
+    Collider      colliders[MAX_COLLIDERS];
+    int           freeHead;
+    CollisionCell cells[COLLISION_HASH_SIZE];
+    unsigned int  version;      // bumped on every add/remove (path repair, cache)
+} CollisionWorld;
+
+// A route being followed. Long routes keep a corridor of chunk-level waypoints
+// and refine only the current leg (corridor[corridorNext]) into grid points.
+typedef struct {
+    Vector2      points[PATH_MAX_POINTS];
+    int          count, next;
+    Vector2      corridor[PATH_MAX_CORRIDOR];
+    int          corridorCount, corridorNext;
+    bool         active;
+    unsigned int version;       // collision version the leg was last checked against
+} Path;
+
+typedef struct {
+    bool         used;
+    bool         goalExact;     // last point is the requested goal, not a snapped cell
+    int          startX, startY, goalX, goalY;  // path-grid cells
+    unsigned int version;
+    int          count;
+    Vector2      points[PATH_MAX_POINTS];
+} PathCacheEntry;
+
+typedef struct {
+    float f;
+    int   node;
+} PathOpenNode;
+
+// Search scratch space, reused by every query. Per-node data is valid only
+// where visit[] matches searchId, so nothing is cleared between searches.
+typedef struct {
+    int            originX, originY, w, h;     // window, in path-grid cells
+    unsigned char  blocked[PATH_WINDOW_MAX * PATH_WINDOW_MAX];
+    float          g[PATH_WINDOW_MAX * PATH_WINDOW_MAX];
+    int            parent[PATH_WINDOW_MAX * PATH_WINDOW_MAX];
+    unsigned int   visit[PATH_WINDOW_MAX * PATH_WINDOW_MAX];
+    unsigned int   closed[PATH_WINDOW_MAX * PATH_WINDOW_MAX];
+    unsigned int   searchId;
+    PathOpenNode   open[PATH_WINDOW_MAX * PATH_WINDOW_MAX];
+    int            openCount;
+    PathCacheEntry cache[PATH_CACHE_SIZE];
+    int            cacheNext;
+} PathFinder;
+
+// Small deterministic RNG for world generation (independent of raylib's global RNG)
+typedef struct {
+    unsigned int state;
+} WorldRng;
+
+typedef struct StateJournal StateJournal;
+
+// Fixed-size chunk cache: memory stays bounded however far the player walks
+typedef struct {
+    Chunk        chunks[MAX_LOADED_CHUNKS];
+    unsigned long long seed;
+    unsigned int frame;
+    int          missing;       // load-rect chunks still missing at the last update
+    WorldRng     rng;           // respawn placement and timers
+    WorldOverlay *overlay;      // diffs are applied on install, recorded on evict
+    CollisionWorld *collision;  // chunk colliders are added on install, removed on evict
+    StateJournal *journal;      // evicted chunks hand it their unjournaled item changes
+} ChunkCache;
+
+// One minimap block on its way to the texture (bx < 0: reset the whole texture)
+typedef struct {
+    int   bx, by;
+    Color px[MINIMAP_CHUNK_PX * MINIMAP_CHUNK_PX];
+} MinimapUpload;
+
+// Minimap texture and which chunk each block currently shows. The sim thread
+// renders blocks into the upload ring; the render thread owns the texture.
+typedef struct {
+    Texture2D     texture;
+    int           blockCx[MINIMAP_BLOCKS][MINIMAP_BLOCKS];
+    int           blockCy[MINIMAP_BLOCKS][MINIMAP_BLOCKS];
+    bool          blockValid[MINIMAP_BLOCKS][MINIMAP_BLOCKS];
+    bool          open;
+    MinimapUpload uploads[MINIMAP_UPLOAD_RING];
+    atomic_uint   uploadHead;   // sim thread writes here
+    atomic_uint   uploadTail;   // render thread reads here
+} Minimap;
+
+// Deferrable work: called with an absolute GetTime() deadline, does what fits
+// and returns true while it still has work pending
+typedef bool (*DeferredFn)(void *ctx, double deadline);
+
+typedef struct {
+    const char *name;
+    DeferredFn  fn;
+    void       *ctx;
+    int         skippedFrames;  // consecutive frames it got no time
+} DeferredJob;
+
+typedef struct {
+    DeferredJob jobs[DEFERRED_MAX_JOBS];    // registration order is priority order
+    int         count;
+    double      frameStart;
+    double      workMs;         // average CPU time per frame outside the scheduler
+    double      spentMs;        // scheduler time this frame
+} FrameScheduler;
+
+typedef struct {
+    unsigned int tick;
+    double       clock;     // simulated seconds since start
+    Rectangle    view;      // camera view this tick
+} SimLod;
+
+typedef enum {
+    FLOW_VILLAGE,
+    FLOW_GATE,
+    FLOW_ITEMS,       // multi-source: every active item in a loaded chunk
+    NUM_FLOW_FIELDS
+} FlowFieldId;
+
+// Direction per cell (0-7, FLOW_DIR_GOAL or FLOW_DIR_NONE). Agents read the
+// front buffer while the back one is rebuilt over several frames.
+typedef struct {
+    unsigned char dir[2][FLOW_CELLS];
+    int           front;
+    bool          dirty;
+} FlowField;
+
+typedef struct {
+    float          originX, originY;        // world position of cell (0, 0)
+    unsigned char  blocked[FLOW_CELLS];
+    unsigned int   rasterVersion;           // collision version blocked[] was built from
+    unsigned int   seenVersion;
+    FlowField      fields[NUM_FLOW_FIELDS];
+    int            goalItem[2][FLOW_CELLS]; // items field goals: chunk slot * CHUNK_MAX_ITEMS + item, or -1
+    float          itemTimer;
+
+    // Incremental rebuild (breadth-first integration, then directions)
+    int            building;                // field being rebuilt, -1 when idle
+    int            phase;
+    unsigned short cost[FLOW_CELLS];
+    int            queue[FLOW_CELLS];
+    int            head, tail, dirCursor;
+} FlowFields;
+
+typedef enum {
+    SCAV_WANDER,
+    SCAV_SEEK,        // following the items field
+    SCAV_RETURN       // carrying loot home
+} ScavengerState;
+
+// Scavenger crowd, one array per field so the per-frame move pass is a
+// straight streaming loop and steering touches only what it needs
+typedef struct {
+    int           count;
+    float         x[NUM_SCAVENGERS], y[NUM_SCAVENGERS];
+    float         vx[NUM_SCAVENGERS], vy[NUM_SCAVENGERS];
+    float         speed[NUM_SCAVENGERS];
+    float         timer[NUM_SCAVENGERS];
+    unsigned char state[NUM_SCAVENGERS];
+    unsigned char home[NUM_SCAVENGERS];     // FLOW_VILLAGE or FLOW_GATE
+    unsigned short cargo[NUM_SCAVENGERS];   // item type + 1, 0 = empty-handed
+    double        simTime[NUM_SCAVENGERS];  // clock each agent was last simulated to
+    int           sectorStart[SCAV_SECTORS * SCAV_SECTORS + 1];  // agents are kept sorted by sector
+    int           order[NUM_SCAVENGERS];    // re-binning scratch
+    double        scratch[NUM_SCAVENGERS];
+    int           sectorCursor;             // first sector of the next update (after a budget cut)
+    bool          sectorOverdue[SCAV_SECTORS * SCAV_SECTORS];   // due when the budget ran out
+    WorldRng      rng;
+} ScavengerCrowd;
+
+// Queued chunk request (lower priority value = generated sooner)
+typedef struct {
+    float priority;
+    int   job;          // index into ChunkStreamer.jobs
+} ChunkRequest;
+
+// One in-flight generation job. cx/cy/inUse/wantedFrame belong to the main
+// thread; chunk is filled by a worker and handed back through the done queue.
+typedef struct {
+    int   cx, cy;
+    bool  inUse;
+    unsigned int wantedFrame;   // last streaming frame that still needed it
+    Chunk chunk;
+} ChunkJob;
+
+typedef struct {
+    atomic_uint sequence;
+    int         job;
+} ChunkDoneCell;
+
+typedef struct Job Job;
+typedef void (*JobFn)(void *data, int begin, int end);
+
+// Completion counter: pending jobs, plus jobs waiting for it to reach zero
+typedef struct {
+    atomic_int  pending;
+    atomic_flag lock;       // guards waiters (and the final decrement)
+    Job        *waiters;
+} JobCounter;
+
+struct Job {
+    JobFn       fn;
+    void       *data;
+    int         begin, end;
+    JobCounter *counter;    // decremented when the job finishes (may be NULL)
+    Job        *next;       // waiter / background list link
+    bool        heap;       // malloc'd (background jobs outlive the per-thread ring)
+};
+
+// Chase-Lev deque: the owning thread pushes and pops at the bottom,
+// other threads steal from the top
+typedef struct {
+    atomic_long  top;
+    atomic_long  bottom;
+    _Atomic(Job *) slots[JOB_DEQUE_SIZE];
+} JobDeque;
+
+typedef struct {
+    JobDeque     deque;
+    Job          pool[JOB_POOL_SIZE];
+    unsigned int poolNext;
+    unsigned int rng;       // steal victim selection
+} JobThread;
+
+typedef struct {
+    JobThread       threads[JOB_MAX_WORKERS + 1];   // [0] is the sim thread
+    pthread_t       workers[JOB_MAX_WORKERS];
+    int             workerCount;
+    atomic_bool     quit;
+
+    pthread_mutex_t sleepLock;
+    pthread_cond_t  wake;
+    atomic_int      sleepers;
+
+    pthread_mutex_t backgroundLock;
+    Job            *backgroundHead, *backgroundTail;
+    atomic_int      backgroundCount;
+} JobSystem;
+
+// Chunk generation pipeline:
+//   sim thread -> priority heap (mutex) -> up to CHUNK_GEN_SLOTS background
+//                 jobs on the shared pool, each draining the heap
+//   pool       -> generate into ChunkJob.chunk off the sim thread
+//   pool       -> lock-free bounded MPSC ring -> sim thread installs
+typedef struct {
+    ChunkJob        jobs[CHUNK_JOB_POOL];
+    int             jobsInUse;
+    unsigned int    frame;      // streaming frame, copied from the cache
+
+    pthread_mutex_t lock;       // guards heap, heapCount and generating
+    ChunkRequest    heap[CHUNK_JOB_POOL];
+    int             heapCount;
+    int             generating; // background jobs currently draining the heap
+
+    ChunkDoneCell   done[CHUNK_JOB_POOL];
+    atomic_uint     doneHead;   // producers claim slots here
+    unsigned int    doneTail;   // sim thread reads here
+
+    JobSystem      *pool;
+    unsigned long long seed;
+} ChunkStreamer;
+
+// What the deferred world jobs (chunk finalization, respawn placement, flow
+// fields, minimap uploads) work on
+typedef struct {
+    ChunkCache    *cache;
+    ChunkStreamer *streamer;
+    FlowFields    *flow;
+    Minimap       *minimap;
+    Sprites       *spr;
+    Vector2        playerPos;
+} DeferredWorld;
+
 // Sandstorm particle (screen space)
 #define MAX_STORM_PARTICLES 60
 typedef struct {
@@ -264,6 +864,560 @@ typedef struct {
     float size;
 } StormParticle;
 
+// Inputs of the parallel update phases, filled in each frame
+typedef struct {
+    float           dt;
+    Particle       *particles;
+    Vector2         particleCenter;
+    float           particleFieldScale;
+    StormParticle  *stormParticles;
+    WorldRng       *stormRng;
+    int             screenWidth, screenHeight;
+    Footprint      *footprints;
+    DustPuff       *dustPuffs;
+    ChunkCache     *cache;
+    const SimLod   *lod;
+    ScavengerCrowd *crowd;
+    FlowFields     *flow;
+} FramePhases;
+
+// What is in view this frame, culled in parallel, kept in index order
+typedef struct {
+    Rectangle       view;
+    ChunkCache     *cache;
+    ScavengerCrowd *crowd;
+    unsigned char   chunkVisible[MAX_LOADED_CHUNKS];
+    int             chunks[MAX_LOADED_CHUNKS];
+    int             numChunks;
+    unsigned char   scavengerVisible[NUM_SCAVENGERS];
+    int             scavengers[NUM_SCAVENGERS];
+    int             numScavengers;
+} RenderList;
+
+// Keys the sim reacts to; the render thread latches them each frame
+typedef enum {
+    INPUT_UP,
+    INPUT_DOWN,
+    INPUT_LEFT,
+    INPUT_RIGHT,
+    INPUT_INVENTORY,
+    INPUT_BACK,
+    INPUT_INTERACT,
+    INPUT_GLIDER,
+    INPUT_HOME,
+    INPUT_GATE,
+    INPUT_MINIMAP,
+    INPUT_SAVE,
+    INPUT_LOAD,
+    INPUT_LOAD_AUTOSAVE,
+    INPUT_PERF,
+    INPUT_REWIND,
+    INPUT_REWIND_HITCH,
+    INPUT_FRAME_CAP,
+    INPUT_COUNT
+} InputAction;
+
+static const int INPUT_KEYS[INPUT_COUNT] = {
+    KEY_W, KEY_S, KEY_A, KEY_D, KEY_TAB, KEY_ESCAPE, KEY_E, KEY_G, KEY_H, KEY_C, KEY_M, KEY_F5, KEY_F9,
+    KEY_F10, KEY_F3, KEY_F7, KEY_F8, KEY_F6
+};
+
+// Input one sim tick acts on, built from the events sampled since the last
+typedef struct {
+    unsigned int down;          // bit per InputAction
+    unsigned int pressed;
+    Vector2      mouse;         // where the click was, else the latest position
+    bool         clicked;       // left button
+    float        wheel;
+    Vector2      resize;        // new screen size, 0 = unchanged
+    double       time;          // sample time of the oldest press or click, 0 = none
+} InputFrame;
+
+// Raw input as the main thread samples it, stamped with GetTime()
+typedef enum {
+    INPUT_EVENT_KEY_DOWN,       // action: InputAction
+    INPUT_EVENT_KEY_UP,
+    INPUT_EVENT_CLICK,          // left button went down at pos
+    INPUT_EVENT_WHEEL,
+    INPUT_EVENT_RESIZE,         // pos is the new screen size
+} InputEventType;
+
+typedef struct {
+    InputEventType type;
+    int            action;
+    Vector2        pos;         // mouse position when sampled
+    float          wheel;
+    double         time;
+} InputEvent;
+
+typedef struct {
+    InputEvent  events[INPUT_QUEUE_SIZE];
+    atomic_uint head, tail;
+    unsigned    dropped;        // producer only
+} InputQueue;
+
+// Sim-side end of the input queue. A second press of the same key (or a
+// second click) within one tick is held back for the next tick, so quick
+// double-taps reach the sim as two presses, in order.
+typedef struct {
+    unsigned int down;
+    Vector2      mouse;
+    bool         held;
+    InputEvent   heldEvent;
+} InputReader;
+
+// Clicks and ESC presses since the last rendered frame, for the UI hit test
+typedef struct {
+    Vector2 mouse;
+    int     count;
+    struct {
+        bool    back;           // ESC, otherwise a click at pos
+        Vector2 pos;
+        double  time;
+    } events[UI_INPUT_MAX];
+} UiInput;
+
+// Main-thread sampler: turns raylib's polled state into events, both for
+// the sim (queue) and for the next frame's UI hit test
+typedef struct {
+    unsigned int down;
+    bool         buttonDown;
+    UiInput      ui;
+    double       lastActivity;  // GetTime() of the last event or mouse move
+} InputSampler;
+
+// Click-to-response latency, measured on the render thread: from the sample
+// time of an input to the first presented frame whose snapshot answers it
+typedef struct {
+    double lastTime;            // sample time of the newest input measured
+    double lastMs, avgMs, maxMs;
+    int    count;
+} InputLatency;
+
+// Frame rate caps, cycled with F6
+typedef enum {
+    FRAME_CAP_DISPLAY,          // just under the monitor refresh rate (VRR friendly)
+    FRAME_CAP_60,
+    FRAME_CAP_120,
+    FRAME_CAP_144,
+    FRAME_CAP_240,
+    FRAME_CAP_UNCAPPED,
+    FRAME_CAP_COUNT
+} FrameCap;
+
+// How evenly frames are presented, measured on the render thread
+typedef struct {
+    int    targetHz;            // 0 = uncapped
+    double lastFrame;           // GetTime() at the last frame start
+    double intervalMs;          // average frame interval
+    double jitterMs;            // average |interval - target| (|interval - average| uncapped)
+    double lateMs;              // average wake-up past the deadline
+    double maxJitterMs;
+} FramePacing;
+
+// How much the render thread is drawing, told to the sim so it can follow
+typedef enum {
+    PRESENT_ACTIVE,             // at the frame cap
+    PRESENT_IDLE,               // static screen: on input, else RENDER_IDLE_HZ
+    PRESENT_UNFOCUSED,          // RENDER_UNFOCUSED_HZ
+    PRESENT_MINIMIZED,          // nothing drawn, sim paused
+} PresentMode;
+
+// Log levels are raylib's TraceLogLevel (LOG_DEBUG .. LOG_ERROR)
+typedef enum {
+    LOGCAT_GAME,                // gameplay: storms, session totals
+    LOGCAT_WORLD,               // streaming, save / load
+    LOGCAT_SIM,                 // threads, queues, timing
+    LOGCAT_COUNT,
+} LogCategory;
+
+typedef union {
+    long long   i;
+    double      f;
+    const char *s;              // must outlive the record (literals, static tables)
+    const void *p;
+} LogArg;
+
+typedef struct {
+    _Alignas(64) atomic_uint seq;  // ring sequence: pos when free, pos + 1 when filled
+    int         level;
+    LogCategory category;
+    double      time;           // seconds since InitLogger
+    const char *fmt;            // printf-style literal; see LogSpecLength for what is supported
+    int         numArgs;
+    LogArg      args[LOG_MAX_ARGS];
+} LogRecord;
+
+// Bounded multi-producer ring (any thread may log) drained by one writer.
+// A full ring drops the record and counts it against its category.
+typedef struct {
+    LogRecord   records[LOG_RING_SIZE];
+    atomic_uint head;           // next slot to claim (producers)
+    unsigned    tail;           // next slot to write out (writer thread only)
+    atomic_int  minLevel;
+    atomic_uint categoryMask;
+    atomic_uint dropped[LOGCAT_COUNT];
+    atomic_bool quit;
+    double      startTime;
+    FILE       *out;
+    pthread_t   thread;
+} Logger;
+
+// Inventory, workbench and trade state. Owned by the sim; the UI screens draw
+// the snapshot copy and ask for changes through UiCommands.
+typedef struct {
+    InventorySlot  inventory[MAX_INVENTORY];
+    WorkbenchState workbenchState;
+    int            repairSlot, sacrificeSlot;
+    float          repairTimer;
+    bool           repairDone;
+    int            tokenCount;
+    bool           tradeScreenOpen;
+    int            dataLogsPurchased;
+    bool           toolUpgradePurchased, carryUpgradePurchased;
+    int            maxInventory;
+    float          baseRepairBonus;
+    int            selectedTradeSlot;
+    bool           dataLogViewerOpen;
+    int            dataLogViewerIndex;
+    bool           inventoryOpen;
+    int            inventoryTab;
+} UiModel;
+
+// Sandstorm state machine
+typedef struct {
+    StormState state;
+    float      timer;       // counts down through the current state
+    float      duration;    // length of the current state
+    float      phase;       // 0..1 progress through the current state
+    float      msgAlpha;
+    float      speedMult;   // player speed multiplier
+} Storm;
+
+// Sim state that outlives a session: the player, the clocks and the UI model.
+// Plain data with no pointers, so a save stores it as a single record.
+typedef struct {
+    Vector2 playerPos;
+    Vector2 facing;
+    float   targetZoom;
+    float   dayTimer;
+    Storm   storm;
+    UiModel ui;
+} SimState;
+
+// Everything a save holds, copied by the sim thread in one go so the
+// autosave writer never reads live state
+typedef struct {
+    SimState           state;
+    unsigned long long seed;
+    ChunkDiff         *overlay;         // copy of the overlay hash table
+    int                overlayCapacity, overlayCount;
+    int                overlayAlloc;    // entries allocated; grows with the world overlay
+    int                slot;
+} SaveSnapshot;
+
+typedef struct {
+    bool   ok;
+    int    slot;                // -1 before the first autosave
+    double writeMs;             // serialize + compress + write + sync
+    size_t rawBytes, packedBytes;
+} AutosaveResult;
+
+// Periodic autosave. While busy, the snapshot and result belong to the
+// background job; the sim picks the result up once busy clears.
+typedef struct {
+    SaveSnapshot   snapshot;
+    AutosaveResult result;      // written by the job
+    atomic_bool    busy;
+    JobSystem     *pool;
+    bool           pending;     // sim thread: a job was started and not yet harvested
+    float          timer;       // seconds until the next autosave
+    int            nextSlot;
+    double         copyUs;      // last snapshot copy, on the sim thread
+    AutosaveResult last;        // newest harvested result
+    int            failures;
+} Autosaver;
+
+typedef enum {
+    JOURNAL_ITEM,               // JournalItem: a world item was picked up or respawned
+    JOURNAL_STATE,              // SimState: player, clocks, inventory, tokens, upgrades
+} JournalRecordType;
+
+typedef struct {
+    unsigned int magic, version;
+    unsigned int journalId;     // matches SaveHeader.journalId of the base save
+    unsigned int reserved;
+} JournalHeader;
+
+// Each record is this header and size bytes of payload. Replay stops at the
+// first record that is cut short or fails its checksum (a torn append).
+typedef struct {
+    unsigned int type;
+    unsigned int size;
+    unsigned int checksum;      // SaveChecksum of the payload
+    unsigned int reserved;
+} JournalRecord;
+
+typedef struct {
+    int       cx, cy;
+    int       index;
+    WorldItem item;
+} JournalItem;
+
+// Records are buffered as they happen and appended every
+// JOURNAL_FLUSH_INTERVAL. The journal is only attached once the session has
+// a base on disk (a load, or the first F5), so a new game never extends an
+// older save.
+struct StateJournal {
+    bool           attached;
+    unsigned int   journalId;
+    int            fd;
+    long long      fileSize;
+    unsigned char *buffer;
+    size_t         used, capacity;
+    int            pending;     // records in the buffer
+    float          flushTimer;
+    SimState       lastState;   // as last journaled; unchanged state is not repeated
+};
+
+// Run of changed 32-bit words in a rewind record; count words follow
+typedef struct {
+    unsigned short start, count;
+} RewindRun;
+
+typedef struct {
+    unsigned int offset, size;  // bytes in the data ring
+    bool         keyframe;      // runs cover the whole state, not a delta
+    float        tickMs;        // sim work of the tick that produced it
+} RewindFrame;
+
+// Per-tick SimState history. Frames are a ring, oldest first, and the oldest
+// is always a keyframe; their records are allocated in order from a byte ring
+// whose oldest frames give way as it wraps.
+typedef struct {
+    RewindFrame    frames[REWIND_FRAMES];
+    int            first, count;
+    unsigned char *data;
+    unsigned int   head;        // next free byte in data
+    SimState       last;        // state of the newest frame, the delta base
+    int            sinceKeyframe;
+    bool           scrubbing;
+    int            cursor;      // frame shown while scrubbing, 0 = oldest
+    int            hitch;       // newest frame whose tick hitched, -1 = none
+    double         recordUs;
+} RewindBuffer;
+
+// Scrub banner contents
+typedef struct {
+    bool  scrubbing;
+    int   frame, frames;
+    float secondsBack;
+    float hitchMs;              // > 0 when the tick after the shown frame hitched
+} RewindStatus;
+
+// Timings shown by the perf overlay (F3), filled in by the sim each tick
+typedef struct {
+    double         tickMs;      // sim work per tick (moving average)
+    double         deferredMs;  // deferred jobs, last tick
+    double         autosaveCopyUs;
+    AutosaveResult autosave;
+    bool           autosaveBusy;
+    int            autosaveFailures;
+    int            rewindFrames;
+    size_t         rewindBytes;
+    double         rewindRecordUs;
+    double         inputToSimMs;    // sample to the tick that took it, last press or click
+} PerfStats;
+
+// Transient UI feedback (flashes, coin animation, messages). Owned by the
+// render thread and driven by GameEvents, so it runs at the display rate.
+typedef struct {
+    float tokenAnimTimer;
+    int   tokenAnimDelta;
+    float pickupFlashTimer, pickupFlashMax;
+    float fullMsgTimer;
+} UiFeedback;
+
+typedef enum {
+    UPGRADE_DATA_LOG,
+    UPGRADE_REPAIR_TOOLS,
+    UPGRADE_PACK,
+} ShopUpgrade;
+
+// Screen rectangles of the UI screens' controls. The click hit test (before
+// drawing) and the draw functions work from the same layout.
+typedef struct {
+    Rectangle panel;
+    Rectangle tabs[2];
+    Rectangle logRows[5];
+} InventoryLayout;
+
+typedef struct {
+    Rectangle panel;
+    Rectangle rows[MAX_INVENTORY];
+    Rectangle repairButton;
+    Rectangle closeButton;
+} WorkbenchLayout;
+
+typedef struct {
+    Rectangle panel;
+    Rectangle rows[MAX_INVENTORY];
+    Rectangle tradeButton;
+    Rectangle cards[3];         // by ShopUpgrade
+    Rectangle buyButtons[3];
+    Rectangle closeButton;
+} TradeLayout;
+
+typedef struct {
+    Rectangle panel;
+    Rectangle closeButton;
+} DataLogLayout;
+
+// All screen layouts for the current window size and pack capacity, owned by
+// the render thread and rebuilt only when one of those changes
+typedef struct {
+    int             width, height;  // screen units (HiDPI scaling is raylib's)
+    int             maxInventory;
+    InventoryLayout inventory;
+    WorkbenchLayout workbench;
+    TradeLayout     trade;
+    DataLogLayout   dataLog;
+} UiLayouts;
+
+// Gameplay events, published by the sim as they happen. Every consumer has
+// its own EventQueue, so each queue has exactly one producer and one consumer.
+typedef enum {
+    EVENT_ITEM_PICKED_UP,
+    EVENT_INVENTORY_FULL,
+    EVENT_REPAIR_COMPLETED,
+    EVENT_TRADE_EXECUTED,
+    EVENT_UPGRADE_PURCHASED,
+    EVENT_STORM_STATE_CHANGED,
+} GameEventType;
+
+typedef struct {
+    GameEventType type;
+    union {
+        struct { int typeIndex; float condition; Vector2 position; } pickup;
+        struct { int typeIndex; float condition; bool typeMatch; } repair;
+        struct { int typeIndex; int tokens; } trade;    // tokens after the trade
+        struct { ShopUpgrade upgrade; int cost, tokens; } purchase;
+        struct { StormState from, to; } storm;
+    };
+} GameEvent;
+
+// Requests from the UI screens. The sim checks each against its own state
+// before applying it, since the screens draw a snapshot a tick behind.
+typedef enum {
+    UI_CMD_SELECT_TAB,          // arg: inventory tab
+    UI_CMD_OPEN_LOG,            // arg: log index
+    UI_CMD_CLOSE_LOG,
+    UI_CMD_PICK_WORKBENCH_SLOT, // arg: inventory slot
+    UI_CMD_START_REPAIR,
+    UI_CMD_CLOSE_WORKBENCH,
+    UI_CMD_SELECT_TRADE_SLOT,   // arg: inventory slot
+    UI_CMD_TRADE,
+    UI_CMD_BUY,                 // arg: ShopUpgrade
+    UI_CMD_CLOSE_TRADE,
+} UiCommandType;
+
+typedef struct {
+    UiCommandType type;
+    int           arg;
+    double        time;         // sample time of the click behind it
+} UiCommand;
+
+// Fixed-size single-producer/single-consumer rings. head is only written by
+// the producer and tail only by the consumer; sizes are powers of two.
+#define EVENT_QUEUE_SIZE   64
+#define COMMAND_QUEUE_SIZE 32
+typedef struct {
+    GameEvent   events[EVENT_QUEUE_SIZE];
+    atomic_uint head, tail;
+    unsigned    dropped;        // producer only: pushes that found the ring full
+} EventQueue;
+
+typedef struct {
+    UiCommand   commands[COMMAND_QUEUE_SIZE];
+    atomic_uint head, tail;
+} CommandQueue;
+
+// Session totals kept by the telemetry consumer
+typedef struct {
+    int itemsPickedUp, repairs, trades, purchases;
+    int tokensEarned, tokensSpent;
+    int storms;
+} GameStats;
+
+typedef struct {
+    float          x, y;
+    unsigned short cargo;       // ScavengerCrowd.cargo
+} ScavengerSprite;
+
+// Everything one rendered frame needs, copied out by the sim at the end of a
+// tick. Chunks and scavengers are the ones in view (chunks padded for dunes).
+typedef struct {
+    bool            valid;
+    Camera2D        camera, prevCamera;     // prev*: the state one tick earlier,
+    Vector2         playerPos, facing;      // for drawing between ticks
+    Vector2         prevPlayerPos;
+    float           walkTimer, breathTimer, pulseTimer;
+    float           prevWalkTimer;
+    double          tickTime;               // GetTime() at the start of the tick
+    float           dayPhase;
+    bool            isNight;
+    float           shadowOffsetX, shadowOffsetY;
+    StormState      stormState;
+    float           stormPhase, stormMsgAlpha;
+    StormParticle   stormParticles[MAX_STORM_PARTICLES];
+    WindLine        windLines[MAX_WIND_LINES];
+    Footprint       footprints[MAX_FOOTPRINTS];
+    DustPuff        dustPuffs[MAX_DUST_PUFFS];
+    Particle        particles[NUM_PARTICLES];
+    PickupEffect    pickupEffect;
+    Path            route;
+    CityBuildings   cityBuildings;
+    bool            gliderOn;
+    int             chunksMissing;
+    bool            minimapOpen;
+    bool            perfOpen;
+    FrameCap        frameCap;
+    PerfStats       perf;
+    RewindStatus    rewind;
+    double          inputTime;      // sample time of the newest input this state answers
+    UiModel         ui;
+    Chunk           chunks[MAX_LOADED_CHUNKS];
+    int             numChunks;
+    ScavengerSprite scavengers[NUM_SCAVENGERS];
+    int             numScavengers;
+} RenderSnapshot;
+
+// Lock-free triple buffer: the sim fills the back slot and swaps it with the
+// middle one; the render thread swaps the middle one for its front slot when
+// it is fresh. Neither side ever waits for the other.
+#define SNAPSHOT_FRESH 4
+typedef struct {
+    RenderSnapshot slots[3];
+    atomic_int     middle;      // slot index, | SNAPSHOT_FRESH until the renderer takes it
+    int            back;        // sim thread only
+    int            front;       // render thread only
+} SnapshotBuffer;
+
+// State shared between the sim thread and the render (main) thread
+typedef struct {
+    SnapshotBuffer  snapshots;
+    InputQueue      input;      // render -> sim
+    CommandQueue    commands;   // render -> sim
+    EventQueue      uiEvents;   // sim -> render (UI feedback)
+    EventQueue      telemetry;  // sim -> render (session stats)
+    atomic_int      present;    // PresentMode, render -> sim
+    Minimap        *minimap;
+    Sprites        *spr;        // the sim only reads the CPU-side groundAvg colors
+    int             screenWidth, screenHeight;
+    atomic_bool     quit;
+    pthread_t       thread;
+} SimThread;
+
 // Time-of-day palette
 typedef struct {
     Color skyColor;
@@ -272,11 +1426,132 @@ typedef struct {
 } TODPalette;
 
 // Function prototypes
-void DrawGround(GroundCircle *circles, int circleCount,
-                DuneLine *dunes, int duneCount,
-                Sprites *spr, unsigned char (*tileGrid)[GROUND_TILES_X],
+void GenerateChunk(Chunk *chunk, int cx, int cy, unsigned long long seed);
+void GenerateCityBuildings(CityBuildings *city, unsigned long long seed);
+ChunkDiff *FindChunkDiff(WorldOverlay *overlay, int cx, int cy);
+void RecordChunkDiff(WorldOverlay *overlay, const Chunk *chunk);
+void ApplyChunkDiff(WorldOverlay *overlay, Chunk *chunk);
+void PlaceRespawnedItem(Chunk *ch, int i, WorldRng *rng);
+bool FinalizeChunks(ChunkCache *cache, ChunkStreamer *streamer, int maxInstalls, double deadline);
+bool WaitForChunks(ChunkCache *cache, ChunkStreamer *streamer, Camera2D camera,
+                   int screenWidth, int screenHeight);
+void InitFrameScheduler(FrameScheduler *sched);
+void AddDeferredJob(FrameScheduler *sched, const char *name, DeferredFn fn, void *ctx);
+void BeginSchedulerFrame(FrameScheduler *sched);
+void RunDeferredJobs(FrameScheduler *sched);
+void EndSchedulerFrame(FrameScheduler *sched);
+bool DeferredFinalizeChunks(void *ctx, double deadline);
+bool DeferredPlaceRespawns(void *ctx, double deadline);
+bool DeferredBuildFlowFields(void *ctx, double deadline);
+bool DeferredUpdateMinimap(void *ctx, double deadline);
+void FreeWorldOverlay(WorldOverlay *overlay);
+bool SaveGame(const char *path, const SimState *state, ChunkCache *cache, unsigned int journalId);
+bool LoadGame(const char *path, SimState *state, unsigned long long *seed, WorldOverlay *overlay,
+              unsigned int *journalId);
+int LoadNewestAutosave(SimState *state, unsigned long long *seed, WorldOverlay *overlay);
+void InitAutosaver(Autosaver *as, JobSystem *pool);
+bool StartAutosave(Autosaver *as, const SimState *state, ChunkCache *cache);
+void UpdateAutosave(Autosaver *as, const SimState *state, ChunkCache *cache, float dt);
+void StopAutosaver(Autosaver *as);
+void InitJournal(StateJournal *j);
+void JournalChunkItems(StateJournal *j, Chunk *ch);
+bool FlushJournal(StateJournal *j, ChunkCache *cache, const SimState *state);
+bool CompactJournal(StateJournal *j, const SimState *state, ChunkCache *cache);
+int ReplayJournal(const char *path, unsigned int journalId, SimState *state, WorldOverlay *overlay,
+                  long long *validSize);
+bool AttachJournal(StateJournal *j, unsigned int journalId, long long validSize, const SimState *state);
+void CloseJournal(StateJournal *j);
+bool InitRewind(RewindBuffer *rw);
+void ResetRewind(RewindBuffer *rw);
+void RecordRewind(RewindBuffer *rw, const SimState *state, float tickMs);
+bool RewindStateAt(const RewindBuffer *rw, int frame, SimState *out);
+void ResumeFromRewind(RewindBuffer *rw, SimState *state);
+RewindStatus GetRewindStatus(const RewindBuffer *rw);
+size_t RewindBytes(const RewindBuffer *rw);
+void FreeRewind(RewindBuffer *rw);
+Chunk *FindChunk(ChunkCache *cache, int cx, int cy);
+Chunk *InstallChunk(ChunkCache *cache, const Chunk *generated);
+void ClearChunkCache(ChunkCache *cache);
+void InitCollisionWorld(CollisionWorld *world);
+int AddCollider(CollisionWorld *world, Rectangle box);
+void RemoveCollider(CollisionWorld *world, int id);
+Vector2 MoveCircle(CollisionWorld *world, Vector2 pos, Vector2 delta, float radius);
+bool PointBlocked(CollisionWorld *world, Vector2 pos, float radius);
+int FindPathLocal(PathFinder *pf, CollisionWorld *world, Vector2 start, Vector2 goal,
+                  Vector2 *out, int maxPoints);
+bool PlanPath(Path *path, PathFinder *pf, ChunkCache *cache, Vector2 start, Vector2 goal);
+bool FollowPath(Path *path, PathFinder *pf, CollisionWorld *world, Vector2 pos,
+                float stepLen, Vector2 *dirOut);
+void DrawPathRoute(Path *path, Vector2 playerPos, float zoom, float pulseTimer);
+void InitFlowFields(FlowFields *ff);
+void UpdateFlowFields(FlowFields *ff, ChunkCache *cache, float dt);
+bool BuildFlowFields(FlowFields *ff, ChunkCache *cache, double deadline);
+void InitScavengers(ScavengerCrowd *crowd, int count, unsigned long long seed);
+void UpdateScavengers(ScavengerCrowd *crowd, FlowFields *ff, ChunkCache *cache, const SimLod *lod);
+void DrawScavengers(const ScavengerSprite *sprites, int count, float zoom);
+void RunUpdatePhases(JobSystem *js, FramePhases *phases, bool updateParticles, bool updateStorm);
+void BuildRenderList(RenderList *list, JobSystem *js, ChunkCache *cache, ScavengerCrowd *crowd,
+                     Rectangle view);
+void VillageBuildingRects(Rectangle out[NUM_VILLAGE_BUILDINGS]);
+void GatePillarRects(Rectangle out[2]);
+void InitSnapshotBuffer(SnapshotBuffer *buf);
+RenderSnapshot *BeginSnapshot(SnapshotBuffer *buf);
+void PublishSnapshot(SnapshotBuffer *buf);
+RenderSnapshot *AcquireSnapshot(SnapshotBuffer *buf);
+void InitInputQueue(InputQueue *q);
+void SampleInput(InputSampler *sampler, InputQueue *q);
+bool PushResizeEvent(InputQueue *q, int width, int height);
+void WaitForNextFrame(InputSampler *sampler, InputQueue *q, double frameDeadline, PresentMode mode);
+PresentMode ChoosePresentMode(const UiModel *ui, const UiFeedback *feedback, const InputSampler *sampler);
+int PresentHz(PresentMode mode, int targetHz);
+int FrameCapHz(FrameCap cap);
+double PaceFrame(FramePacing *pacing, double frameDeadline, int targetHz);
+float SnapshotBlend(const RenderSnapshot *snap, double now);
+UiInput TakeUiInput(InputSampler *sampler);
+InputFrame TakeInput(InputReader *reader, InputQueue *q);
+void InitLogger(FILE *out, int minLevel);
+void ShutdownLogger(void);
+void SetLogCategory(LogCategory category, bool enabled);
+void LogMessage(int level, LogCategory category, const char *fmt, ...);
+void LoadItemTable(ItemTable *table, const char *path);
+void FreeItemTable(ItemTable *table);
+int FindItemType(const ItemTable *table, const char *id);
+int RandomItemType(const ItemTable *table, WorldRng *rng);
+Texture2D BuildItemAtlas(ItemTable *table);
+void InitEventQueue(EventQueue *q);
+bool PushEvent(EventQueue *q, const GameEvent *ev);
+bool PopEvent(EventQueue *q, GameEvent *out);
+void InitCommandQueue(CommandQueue *q);
+bool PushCommand(CommandQueue *q, UiCommandType type, int arg, double time);
+bool PopCommand(CommandQueue *q, UiCommand *out);
+void UpdateUiFeedback(UiFeedback *feedback, EventQueue *events, float dt);
+void DrainTelemetry(EventQueue *events, GameStats *stats);
+void StartSimThread(SimThread *sim, Minimap *minimap, Sprites *spr, int screenWidth, int screenHeight);
+void StopSimThread(SimThread *sim);
+void InitJobSystem(JobSystem *js);
+void ShutdownJobSystem(JobSystem *js);
+void InitJobCounter(JobCounter *counter);
+void RunJob(JobSystem *js, JobFn fn, void *data, int begin, int end, JobCounter *counter);
+void RunJobAfter(JobSystem *js, JobCounter *dependency, JobFn fn, void *data, int begin, int end,
+                 JobCounter *counter);
+void RunBackgroundJob(JobSystem *js, JobFn fn, void *data);
+void ParallelFor(JobSystem *js, JobFn fn, void *data, int count, int grain, JobCounter *counter);
+void WaitForJobs(JobSystem *js, JobCounter *counter);
+void StartChunkStreamer(ChunkStreamer *streamer, unsigned long long seed, JobSystem *pool);
+void StopChunkStreamer(ChunkStreamer *streamer);
+bool RequestChunk(ChunkStreamer *streamer, int cx, int cy, float priority);
+int UpdateChunkStreaming(ChunkCache *cache, ChunkStreamer *streamer, Camera2D camera,
+                         Vector2 cameraVelocity, int screenWidth, int screenHeight);
+void InitMinimap(Minimap *map);
+void ClearMinimap(Minimap *map);
+void FlushMinimapUploads(Minimap *map);
+bool UpdateMinimap(Minimap *map, ChunkCache *cache, Sprites *spr, Vector2 playerPos, double deadline);
+static Rectangle MinimapRect(int screenWidth, int screenHeight);
+void DrawMinimap(Minimap *map, Vector2 playerPos, Vector2 facing,
+                 int screenWidth, int screenHeight, float pulseTimer);
+void DrawGround(const Chunk *chunks, int count, Sprites *spr,
                 Camera2D camera, int screenWidth, int screenHeight);
-void DrawTerrainAccents(TerrainAccent *accents, int count, Sprites *spr);
+void DrawTerrainAccents(TerrainAccent *accents, int count, Sprites *spr, float zoom);
 void DrawZ(Vector2 position, float walkTimer, float breathTimer,
            Vector2 facing, float shadowOffsetX, float shadowOffsetY,
            Sprites *spr);
@@ -291,13 +1566,22 @@ void DrawWorldItems(WorldItem *items, int count, Vector2 playerPos,
                     float shadowOffsetX, float shadowOffsetY, bool isNight,
                     Sprites *spr);
 void DrawAtmosphere(Camera2D camera, int screenWidth, int screenHeight);
-void UpdateParticles(Particle *particles, int count, float deltaTime);
-void DrawParticles(Particle *particles, int count);
+void UpdateParticles(Particle *particles, int count, Vector2 center, float fieldScale,
+                     float deltaTime);
+void DrawParticles(Particle *particles, int count, float zoom);
 void DrawPickupEffect(PickupEffect *effect, Camera2D camera);
-void DrawInventoryScreen(InventorySlot *inventory, int maxInv,
-                         int *inventoryTab, int dataLogsPurchased,
-                         bool *dataLogViewerOpen, int *dataLogViewerIndex);
+InventoryLayout InventoryLayoutFor(int maxInventory, int sw, int sh);
+WorkbenchLayout WorkbenchLayoutFor(int maxInventory, int sw, int sh);
+TradeLayout TradeLayoutFor(int maxInventory, int sw, int sh);
+DataLogLayout DataLogLayoutFor(int sw, int sh);
+bool UpdateUiLayouts(UiLayouts *layouts, int maxInventory, int sw, int sh);
+void HitTestUi(const UiModel *ui, const UiLayouts *layouts, const UiInput *in, CommandQueue *commands,
+               UiFeedback *feedback);
+void DrawInventoryScreen(const UiModel *ui, const UiLayouts *layouts, Vector2 mouse);
 void DrawHUD(InventorySlot *inventory, int screenWidth, int maxInv, int tokenCount, float tokenAnimTimer, int tokenAnimDelta);
+void DrawPerfOverlay(const PerfStats *perf, const InputLatency *latency, const FramePacing *pacing,
+                     int fps, float frameTime);
+void DrawRewindBanner(const RewindStatus *status, int screenWidth);
 void DrawParallaxDunes(ParallaxDune *dunes, int count, Camera2D camera,
                        int screenWidth, int screenHeight);
 void DrawFootprints(Footprint *footprints, int count);
@@ -309,19 +1593,9 @@ void DrawSunMoon(float dayPhase, int screenWidth);
 void DrawStormOverlay(StormState state, float stormPhase, StormParticle *particles,
                       int count, int screenWidth, int screenHeight);
 void DrawSpawnShimmers(SpawnShimmer *shimmers, int count);
-void DrawWorkbenchUI(InventorySlot *inventory, WorkbenchState *workbenchState,
-                     int *repairSlot, int *sacrificeSlot,
-                     float *repairTimer, bool *repairDone,
-                     float *pickupFlashTimer, float pickupFlashMax,
-                     int maxInventory, float baseRepairBonus);
-void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
-                       int *tokenCount, bool *tradeScreenOpen,
-                       int *dataLogsPurchased, bool *toolUpgradePurchased,
-                       bool *carryUpgradePurchased, int *maxInventoryPtr,
-                       float *baseRepairBonusPtr, float *tokenAnimTimer,
-                       int *tokenAnimDelta, int *selectedTradeSlot,
-                       bool *dataLogViewerOpen, int *dataLogViewerIndex);
-void DrawDataLogViewer(int logIndex, bool *open);
+void DrawWorkbenchUI(const UiModel *ui, const UiLayouts *layouts);
+void DrawTradeScreenUI(const UiModel *ui, const UiFeedback *feedback, const UiLayouts *layouts, Vector2 mouse);
+void DrawDataLogViewer(int logIndex, const UiLayouts *layouts, Vector2 mouse);
 
 // Helper: draw a rounded rectangle using a rectangle + circles at corners
 static void DrawRoundRect(float x, float y, float w, float h, float r, Color col)
@@ -336,6 +1610,67 @@ static void DrawRoundRect(float x, float y, float w, float h, float r, Color col
     DrawCircle((int)(x + w - r), (int)(y + h - r), r, col);
 }
 
+// Helper: average color of an image file (1x1 resize), for flat-color LOD impostors
+static Color GroundAverageColor(const char *path)
+{
+    Image img = LoadImage(path);
+    if (img.data == NULL) return COL_SAND_BASE;
+    ImageResize(&img, 1, 1);
+    Color c = GetImageColor(img, 0, 0);
+    UnloadImage(img);
+    c.a = 255;
+    return c;
+}
+
+// Helper: world-space rectangle visible through the camera
+static Rectangle CameraView(Camera2D camera, int screenWidth, int screenHeight)
+{
+    return (Rectangle){ camera.target.x - camera.offset.x / camera.zoom,
+                        camera.target.y - camera.offset.y / camera.zoom,
+                        screenWidth / camera.zoom, screenHeight / camera.zoom };
+}
+
+// Helper: smallest zoom whose load rect spans at most CHUNK_VIEW_BUDGET
+// chunks on a screenWidth x screenHeight window (ZOOM_MIN on small windows)
+static float MinZoomForScreen(int screenWidth, int screenHeight)
+{
+    float zoom = ZOOM_MIN;
+    for (; zoom < ZOOM_MAX; zoom *= 1.01f) {
+        int cols = (int)((screenWidth  / zoom + CHUNK_LOAD_MARGIN * 2.0f) / CHUNK_SIZE) + 2;
+        int rows = (int)((screenHeight / zoom + CHUNK_LOAD_MARGIN * 2.0f) / CHUNK_SIZE) + 2;
+        if (cols * rows <= CHUNK_VIEW_BUDGET) break;
+    }
+    return fminf(zoom, ZOOM_MAX);
+}
+
+// Helper: sim-LOD update stride for something occupying bounds — 1 near the
+// view, SIM_LOD_MID/FAR_STRIDE in the outer rings, 0 (frozen) beyond
+static int SimLodStride(const SimLod *lod, Rectangle bounds)
+{
+    Rectangle v = lod->view;
+    float gapX = fmaxf(v.x - (bounds.x + bounds.width),  bounds.x - (v.x + v.width));
+    float gapY = fmaxf(v.y - (bounds.y + bounds.height), bounds.y - (v.y + v.height));
+    float gap  = fmaxf(gapX, gapY);
+    if (gap < SIM_LOD_NEAR_PAD) return 1;
+    if (gap < SIM_LOD_MID_PAD)  return SIM_LOD_MID_STRIDE;
+    if (gap < SIM_LOD_FAR_PAD)  return SIM_LOD_FAR_STRIDE;
+    return 0;
+}
+
+// Helper: is a stride-strided entity due this tick? phase spreads the ticks.
+static bool SimLodDue(const SimLod *lod, int stride, int phase)
+{
+    return stride > 0 && (lod->tick + (unsigned int)phase) % (unsigned int)stride == 0;
+}
+
+// Helper: does the chunk (grown by pad on every side) overlap the view?
+static bool ChunkInView(const Chunk *ch, Rectangle view, float pad)
+{
+    float originX = (float)ch->cx * CHUNK_SIZE, originY = (float)ch->cy * CHUNK_SIZE;
+    return originX - pad < view.x + view.width  && originX + CHUNK_SIZE + pad > view.x &&
+           originY - pad < view.y + view.height && originY + CHUNK_SIZE + pad > view.y;
+}
+
 // Helper: color lerp
 static Color ColorLerpRGBA(Color a, Color b, float t)
 {
@@ -349,6 +1684,154 @@ static Color ColorLerpRGBA(Color a, Color b, float t)
     };
 }
 
+// Helper: integer hash (murmur3 finalizer), used to seed per-chunk generation
+static unsigned int HashUint(unsigned int h)
+{
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Helper: fold the 64-bit world seed (plus a per-use tag) into a 32-bit hash
+static unsigned int HashSeed(unsigned long long seed, unsigned int tag)
+{
+    unsigned int h = HashUint((unsigned int)seed ^ tag);
+    return HashUint(h ^ (unsigned int)(seed >> 32) * 0x9E3779B9u);
+}
+
+static unsigned int HashChunkCoords(unsigned long long seed, int cx, int cy)
+{
+    unsigned int h = HashSeed(seed, 0x43484E4Bu);
+    h = HashUint(h ^ (unsigned int)cx);
+    h = HashUint(h ^ (unsigned int)cy * 0x27D4EB2Du);
+    return h ? h : 1u;  // xorshift state must be non-zero
+}
+
+// Helper: xorshift32 step
+static unsigned int RngNext(WorldRng *rng)
+{
+    unsigned int x = rng->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng->state = x;
+    return x;
+}
+
+// Helper: random int in [min, max] inclusive (same contract as GetRandomValue)
+static int RngRange(WorldRng *rng, int min, int max)
+{
+    if (max <= min) return min;
+    return min + (int)(RngNext(rng) % (unsigned int)(max - min + 1));
+}
+
+// Helper: world position -> chunk coordinate (floors toward -inf)
+static int WorldToChunk(float v)
+{
+    return (int)floorf(v / (float)CHUNK_SIZE);
+}
+
+// ---------------------------------------------------------------------------
+// Gradient noise, four samples at a time. Written with GCC/Clang vector
+// extensions so it compiles to NEON on Apple Silicon and SSE on x86.
+// ---------------------------------------------------------------------------
+typedef float        v4f __attribute__((vector_size(16)));
+typedef int          v4i __attribute__((vector_size(16)));
+typedef unsigned int v4u __attribute__((vector_size(16)));
+
+static inline v4u NoiseHash4(v4i ix, v4i iy, unsigned int seed)
+{
+    v4u h = ((v4u)ix * 0x27D4EB2Du) ^ ((v4u)iy * 0x165667B1u) ^ seed;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h;
+}
+
+// Diagonal gradient picked by two hash bits: flip the sign bit of dx / dy
+static inline v4f NoiseGrad4(v4u h, v4f dx, v4f dy)
+{
+    v4f gx = (v4f)((v4u)dx ^ ((h & 1u) << 31));
+    v4f gy = (v4f)((v4u)dy ^ ((h & 2u) << 30));
+    return gx + gy;
+}
+
+static inline v4f NoiseFade4(v4f t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+// 2D gradient noise in roughly [-1, 1]
+static v4f GradientNoise4(v4f x, v4f y, unsigned int seed)
+{
+    v4i ix = __builtin_convertvector(x, v4i);
+    v4i iy = __builtin_convertvector(y, v4i);
+    ix += (v4i)(x < __builtin_convertvector(ix, v4f));  // floor: true lanes are -1
+    iy += (v4i)(y < __builtin_convertvector(iy, v4f));
+    v4f fx = x - __builtin_convertvector(ix, v4f);
+    v4f fy = y - __builtin_convertvector(iy, v4f);
+
+    v4f n00 = NoiseGrad4(NoiseHash4(ix,     iy,     seed), fx,        fy);
+    v4f n10 = NoiseGrad4(NoiseHash4(ix + 1, iy,     seed), fx - 1.0f, fy);
+    v4f n01 = NoiseGrad4(NoiseHash4(ix,     iy + 1, seed), fx,        fy - 1.0f);
+    v4f n11 = NoiseGrad4(NoiseHash4(ix + 1, iy + 1, seed), fx - 1.0f, fy - 1.0f);
+
+    v4f u = NoiseFade4(fx);
+    v4f v = NoiseFade4(fy);
+    v4f nx0 = n00 + u * (n10 - n00);
+    v4f nx1 = n01 + u * (n11 - n01);
+    return nx0 + v * (nx1 - nx0);
+}
+
+// Fill a CHUNK_CELLS x CHUNK_CELLS grid of noise sampled at cell centers.
+// octaves > 1 adds half-wavelength, half-amplitude detail; ridged folds the
+// result into 1 - |n| so crests form thin lines.
+static void FillNoiseGrid(float *out, float originX, float originY, float wavelength,
+                          int octaves, bool ridged, unsigned int seed)
+{
+    const v4f laneOffset = { 0.5f, 1.5f, 2.5f, 3.5f };
+    for (int y = 0; y < CHUNK_CELLS; y++) {
+        for (int x = 0; x < CHUNK_CELLS; x += 4) {
+            v4f wx = originX + ((float)x + laneOffset) * (float)CHUNK_CELL_SIZE;
+            v4f wy = (v4f){ 0 } + (originY + ((float)y + 0.5f) * (float)CHUNK_CELL_SIZE);
+            v4f sum = { 0 };
+            float freq = 1.0f / wavelength;
+            float amp  = 1.0f;
+            float norm = 0.0f;
+            for (int o = 0; o < octaves; o++) {
+                sum  += GradientNoise4(wx * freq, wy * freq, seed + (unsigned int)o * 0x9E3779B9u) * amp;
+                norm += amp;
+                freq *= 2.0f;
+                amp  *= 0.5f;
+            }
+            sum /= norm;
+            if (ridged) {
+                sum = 1.0f - (v4f)((v4u)sum & 0x7FFFFFFFu);  // 1 - |n|
+            }
+            memcpy(&out[y * CHUNK_CELLS + x], &sum, sizeof(sum));
+        }
+    }
+}
+
+// Helper: bilinear lookup into a noise grid at world position (clamped to the grid)
+static float SampleNoiseGrid(const float *grid, float originX, float originY, float wx, float wy)
+{
+    float gx = (wx - originX) / (float)CHUNK_CELL_SIZE - 0.5f;
+    float gy = (wy - originY) / (float)CHUNK_CELL_SIZE - 0.5f;
+    if (gx < 0.0f) gx = 0.0f;
+    if (gy < 0.0f) gy = 0.0f;
+    if (gx > CHUNK_CELLS - 1.001f) gx = CHUNK_CELLS - 1.001f;
+    if (gy > CHUNK_CELLS - 1.001f) gy = CHUNK_CELLS - 1.001f;
+    int x0 = (int)gx, y0 = (int)gy;
+    float tx = gx - x0, ty = gy - y0;
+    float a = grid[y0 * CHUNK_CELLS + x0],       b = grid[y0 * CHUNK_CELLS + x0 + 1];
+    float c = grid[(y0 + 1) * CHUNK_CELLS + x0], d = grid[(y0 + 1) * CHUNK_CELLS + x0 + 1];
+    return (a + (b - a) * tx) + ((c + (d - c) * tx) - (a + (b - a) * tx)) * ty;
+}
+
 int CountInventory(InventorySlot *inventory, int maxInv)
 {
     int count = 0;
@@ -371,856 +1854,5588 @@ bool AddToInventory(InventorySlot *inventory, int typeIndex, float condition, in
     return false;
 }
 
-int main(void)
+// ---------------------------------------------------------------------------
+// Snapshot triple buffer  — BeginSnapshot/PublishSnapshot on the sim thread,
+// AcquireSnapshot on the render thread. Publishing swaps the filled back slot
+// into the middle; acquiring swaps the middle into front only if it is fresh,
+// so the renderer keeps redrawing its last snapshot while the sim is busy.
+// ---------------------------------------------------------------------------
+void InitSnapshotBuffer(SnapshotBuffer *buf)
 {
-    const int screenWidth = 1280;
-    const int screenHeight = 720;
-
-    InitWindow(screenWidth, screenHeight, "Above the Clouds");
-    SetTargetFPS(60);
+    buf->back  = 0;
+    buf->front = 2;
+    atomic_init(&buf->middle, 1);
+    for (int i = 0; i < 3; i++) buf->slots[i].valid = false;
+}
 
-    // --- Load all sprites ---
-    Sprites spr = { 0 };
-    spr.z_down    = LoadTexture("assets/sprites/z_down.png");
-    spr.z_up      = LoadTexture("assets/sprites/z_up.png");
-    spr.z_left    = LoadTexture("assets/sprites/z_left.png");
-    spr.z_right   = LoadTexture("assets/sprites/z_right.png");
-    spr.building[0] = LoadTexture("assets/sprites/building_1.png");
-    spr.building[1] = LoadTexture("assets/sprites/building_2.png");
-    spr.building[2] = LoadTexture("assets/sprites/building_3.png");
-    spr.building[3] = LoadTexture("assets/sprites/building_4.png");
-    spr.building[4] = LoadTexture("assets/sprites/building_5.png");
-    spr.item[0]   = LoadTexture("assets/sprites/item_circuit.png");
-    spr.item[1]   = LoadTexture("assets/sprites/item_wire.png");
-    spr.item[2]   = LoadTexture("assets/sprites/item_battery.png");
-    spr.item[3]   = LoadTexture("assets/sprites/item_lens.png");
-    spr.item[4]   = LoadTexture("assets/sprites/item_metal.png");
-    spr.ground[0] = LoadTexture("assets/sprites/ground_1.png");
-    spr.ground[1] = LoadTexture("assets/sprites/ground_2.png");
-    spr.ground[2] = LoadTexture("assets/sprites/ground_3.png");
-    SetTextureFilter(spr.ground[0], TEXTURE_FILTER_BILINEAR);
-    SetTextureFilter(spr.ground[1], TEXTURE_FILTER_BILINEAR);
-    SetTextureFilter(spr.ground[2], TEXTURE_FILTER_BILINEAR);
-    spr.dune[0]   = LoadTexture("assets/sprites/dune_1.png");
-    spr.dune[1]   = LoadTexture("assets/sprites/dune_2.png");
-    spr.dune[2]   = LoadTexture("assets/sprites/dune_3.png");
-    spr.debris1   = LoadTexture("assets/sprites/debris_1.png");
-    spr.city_gate = LoadTexture("assets/sprites/city_gate.png");
-    SetTextureFilter(spr.city_gate, TEXTURE_FILTER_BILINEAR);
+RenderSnapshot *BeginSnapshot(SnapshotBuffer *buf)
+{
+    return &buf->slots[buf->back];
+}
 
-    // --- Ground tile grid (randomly assign 0/1/2 per tile, generated once) ---
-    // Stored as a flat 2D array: tileGrid[y][x]
-    static unsigned char tileGrid[GROUND_TILES_Y][GROUND_TILES_X];
-    for (int ty = 0; ty < GROUND_TILES_Y; ty++) {
-        for (int tx = 0; tx < GROUND_TILES_X; tx++) {
-            tileGrid[ty][tx] = (unsigned char)GetRandomValue(0, 2);
-        }
-    }
+void PublishSnapshot(SnapshotBuffer *buf)
+{
+    int prev = atomic_exchange(&buf->middle, buf->back | SNAPSHOT_FRESH);
+    buf->back = prev & ~SNAPSHOT_FRESH;
+}
 
-    // Player starting position (center of world)
-    Vector2 playerPos = { WORLD_WIDTH / 2.0f, WORLD_HEIGHT / 2.0f };
+RenderSnapshot *AcquireSnapshot(SnapshotBuffer *buf)
+{
+    if (atomic_load(&buf->middle) & SNAPSHOT_FRESH) {
+        int prev = atomic_exchange(&buf->middle, buf->front);
+        buf->front = prev & ~SNAPSHOT_FRESH;
+    }
+    return &buf->slots[buf->front];
+}
 
-    // Camera setup
-    Camera2D camera = { 0 };
-    camera.target = playerPos;
-    camera.offset = (Vector2){ screenWidth / 2.0f, screenHeight / 2.0f };
-    camera.rotation = 0.0f;
-    camera.zoom = 1.0f;
+// ---------------------------------------------------------------------------
+// Input events  — raylib polls input on the main thread. Between frames that
+// thread polls every INPUT_SAMPLE_PERIOD (WaitForNextFrame), and after each
+// poll SampleInput turns state changes into timestamped events: into an SPSC
+// ring for the sim, and into the UiInput the next frame hit-tests. The sim
+// drains the ring at the start of each tick, in sample order.
+// ---------------------------------------------------------------------------
+void InitInputQueue(InputQueue *q)
+{
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->dropped = 0;
+}
 
-    // --- Initialize ground circles (stored once, no flickering) ---
-    GroundCircle groundCircles[NUM_GROUND_CIRCLES];
-    Color circleColors[3] = { COL_SAND_CIRCLE_A, COL_SAND_CIRCLE_B, COL_SAND_CIRCLE_C };
-    for (int i = 0; i < NUM_GROUND_CIRCLES; i++) {
-        groundCircles[i].center = (Vector2){
-            (float)GetRandomValue(0, WORLD_WIDTH),
-            (float)GetRandomValue(0, WORLD_HEIGHT)
-        };
-        groundCircles[i].radius = (float)GetRandomValue(120, 320);
-        Color c = circleColors[i % 3];
-        // Alpha 30-40
-        int alpha = GetRandomValue(30, 40);
-        groundCircles[i].color = (Color){ c.r, c.g, c.b, (unsigned char)alpha };
-    }
-
-    // --- Initialize dune lines (stored once) ---
-    DuneLine duneLines[NUM_DUNE_LINES];
-    for (int d = 0; d < NUM_DUNE_LINES; d++) {
-        // Random arc: pick a center, radius, and angular sweep
-        float cx   = (float)GetRandomValue(200, WORLD_WIDTH  - 200);
-        float cy   = (float)GetRandomValue(200, WORLD_HEIGHT - 200);
-        float arcR = (float)GetRandomValue(300, 700);
-        float startA = (float)GetRandomValue(0, 180) * DEG2RAD;
-        float sweepA = (float)GetRandomValue(60, 140) * DEG2RAD;
-
-        int numPts = DUNE_SEGMENTS + 1;
-        for (int s = 0; s < numPts; s++) {
-            float t = (float)s / (float)DUNE_SEGMENTS;
-            float angle = startA + t * sweepA;
-            duneLines[d].pts[s].x = cx + cosf(angle) * arcR;
-            duneLines[d].pts[s].y = cy + sinf(angle) * arcR;
-        }
-        duneLines[d].numPts = numPts;
-        duneLines[d].width  = (float)GetRandomValue(2, 3);
-    }
-
-    // Create typed world items
-    WorldItem worldItems[NUM_SCAVENGE_ITEMS];
-    for (int i = 0; i < NUM_SCAVENGE_ITEMS; i++) {
-        float angle    = GetRandomValue(0, 360) * DEG2RAD;
-        float distance = (float)GetRandomValue(100, 1200);
-        worldItems[i].position = (Vector2){
-            WORLD_WIDTH  / 2.0f + cosf(angle) * distance,
-            WORLD_HEIGHT / 2.0f + sinf(angle) * distance
-        };
-        worldItems[i].typeIndex     = GetRandomValue(0, NUM_ITEM_TYPES - 1);
-        worldItems[i].condition     = 0.3f + (GetRandomValue(0, 600) / 1000.0f);
-        worldItems[i].active        = true;
-        worldItems[i].respawnTimer  = 0.0f;
+static bool PushInputEvent(InputQueue *q, const InputEvent *ev)
+{
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head - tail == INPUT_QUEUE_SIZE) {
+        q->dropped++;
+        return false;
     }
+    q->events[head & (INPUT_QUEUE_SIZE - 1)] = *ev;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
 
-    // --- Terrain accents (20 random positions, generated once after worldItems) ---
-    TerrainAccent terrainAccents[NUM_TERRAIN_ACCENTS];
-    {
-        float cx = WORLD_WIDTH  / 2.0f;
-        float cy = WORLD_HEIGHT / 2.0f;
-        int placed = 0;
-        int attempts = 0;
-        while (placed < NUM_TERRAIN_ACCENTS && attempts < 2000) {
-            attempts++;
-            float wx = 80.0f + (float)GetRandomValue(0, WORLD_WIDTH  - 160);
-            float wy = 80.0f + (float)GetRandomValue(0, WORLD_HEIGHT - 160);
-            // Avoid village center area (300px)
-            if (Vector2Distance((Vector2){wx,wy}, (Vector2){cx,cy}) < 300.0f) continue;
-            // Avoid proximity to any scavenge item (80px)
-            bool tooClose = false;
-            for (int j = 0; j < NUM_SCAVENGE_ITEMS; j++) {
-                if (Vector2Distance((Vector2){wx,wy}, worldItems[j].position) < 80.0f) {
-                    tooClose = true;
-                    break;
-                }
-            }
-            if (tooClose) continue;
-            terrainAccents[placed].pos       = (Vector2){ wx, wy };
-            terrainAccents[placed].spriteIdx = GetRandomValue(0, 3);
-            placed++;
+static bool PopInputEvent(InputQueue *q, InputEvent *out)
+{
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (tail == head) return false;
+    *out = q->events[tail & (INPUT_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static void AddUiInput(UiInput *ui, bool back, Vector2 pos, double time)
+{
+    if (ui->count == UI_INPUT_MAX) return;
+    ui->events[ui->count].back = back;
+    ui->events[ui->count].pos  = pos;
+    ui->events[ui->count].time = time;
+    ui->count++;
+}
+
+// Call right after every PollInputEvents (EndDrawing runs one too)
+void SampleInput(InputSampler *sampler, InputQueue *q)
+{
+    double now    = GetTime();
+    Vector2 mouse = GetMousePosition();
+    unsigned queuedBefore = atomic_load_explicit(&q->head, memory_order_relaxed) + q->dropped;
+    int uiBefore = sampler->ui.count;
+
+    // A key pressed and released between two polls is down in neither, but
+    // still comes through raylib's pressed-key queue
+    unsigned int down = 0, tapped = 0;
+    for (int a = 0; a < INPUT_COUNT; a++) {
+        if (IsKeyDown(INPUT_KEYS[a])) down |= 1u << a;
+    }
+    for (int key = GetKeyPressed(); key != 0; key = GetKeyPressed()) {
+        for (int a = 0; a < INPUT_COUNT; a++) {
+            if (INPUT_KEYS[a] == key && !(down & (1u << a))) tapped |= 1u << a;
+        }
+    }
+    for (int a = 0; a < INPUT_COUNT; a++) {
+        unsigned int bit = 1u << a;
+        bool pressed  = (down & bit) && !(sampler->down & bit);
+        bool released = !(down & bit) && (sampler->down & bit);
+        if (pressed || (tapped & bit)) {
+            PushInputEvent(q, &(InputEvent){ INPUT_EVENT_KEY_DOWN, a, mouse, 0.0f, now });
+            if (a == INPUT_BACK) AddUiInput(&sampler->ui, true, mouse, now);
+        }
+        if (released || (tapped & bit)) {
+            PushInputEvent(q, &(InputEvent){ INPUT_EVENT_KEY_UP, a, mouse, 0.0f, now });
         }
     }
+    sampler->down = down;
 
-    // Create floating particles (drift left-to-right at varying speeds)
-    Particle particles[NUM_PARTICLES];
-    for (int i = 0; i < NUM_PARTICLES; i++) {
-        particles[i].position = (Vector2){
-            (float)GetRandomValue(0, WORLD_WIDTH),
-            (float)GetRandomValue(0, WORLD_HEIGHT)
-        };
-        // Primarily left-to-right drift, small vertical wander
-        float speed = (float)GetRandomValue(8, 25);
-        particles[i].velocity = (Vector2){
-            speed,
-            (float)GetRandomValue(-4, 4)
-        };
+    bool buttonDown = IsMouseButtonDown(MOUSE_LEFT_BUTTON);
+    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) || (buttonDown && !sampler->buttonDown)) {
+        PushInputEvent(q, &(InputEvent){ INPUT_EVENT_CLICK, 0, mouse, 0.0f, now });
+        AddUiInput(&sampler->ui, false, mouse, now);
     }
+    sampler->buttonDown = buttonDown;
 
-    // Initialize city buildings (fix flickering bug - stored once)
-    CityBuildings cityBuildings;
-    for (int i = 0; i < NUM_CITY_BUILDINGS; i++) {
-        cityBuildings.heights[i] = GetRandomValue(60, 120);
-    }
-
-    // Inventory
-    InventorySlot inventory[MAX_INVENTORY];
-    for (int i = 0; i < MAX_INVENTORY; i++) {
-        inventory[i].occupied  = false;
-        inventory[i].typeIndex = 0;
-        inventory[i].condition = 0.0f;
-    }
-
-    // Workbench state
-    WorkbenchState workbenchState = WB_CLOSED;
-    int   repairSlot    = -1;
-    int   sacrificeSlot = -1;
-    float repairTimer   = 0.0f;
-    bool  repairDone    = false;
-
-    // Gate trade state
-    int   tokenCount          = 0;
-    bool  tradeScreenOpen     = false;
-    int   dataLogsPurchased   = 0;
-    bool  toolUpgradePurchased  = false;
-    bool  carryUpgradePurchased = false;
-    int   maxInventory        = 8;        // starts at 8, upgrades to 10
-    float baseRepairBonus     = 0.2f;     // starts at 0.2, upgrades to 0.25
-    float tokenAnimTimer      = 0.0f;
-    int   tokenAnimDelta      = 1;
-    int   selectedTradeSlot   = -1;
-    bool  dataLogViewerOpen   = false;
-    int   dataLogViewerIndex  = 0;
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0.0f) PushInputEvent(q, &(InputEvent){ INPUT_EVENT_WHEEL, 0, mouse, wheel, now });
 
-    // Pickup effect
-    PickupEffect pickupEffect = { 0 };
-    pickupEffect.active = false;
+    if (atomic_load_explicit(&q->head, memory_order_relaxed) + q->dropped != queuedBefore ||
+        sampler->ui.count != uiBefore || mouse.x != sampler->ui.mouse.x || mouse.y != sampler->ui.mouse.y) {
+        sampler->lastActivity = now;
+    }
+    sampler->ui.mouse = mouse;
+}
 
-    // Spawn shimmer pool (one slot per item)
-    SpawnShimmer spawnShimmers[NUM_SCAVENGE_ITEMS];
-    for (int i = 0; i < NUM_SCAVENGE_ITEMS; i++) {
-        spawnShimmers[i].active = false;
-        spawnShimmers[i].timer  = 0.0f;
+// The window changed size; the sim picks it up in order with the input.
+// False if the queue was full and the caller has to try again.
+bool PushResizeEvent(InputQueue *q, int width, int height)
+{
+    return PushInputEvent(q, &(InputEvent){ INPUT_EVENT_RESIZE, 0, { (float)width, (float)height }, 0.0f, GetTime() });
+}
+
+// Keep sampling input until the next frame is due. Sleeps overshoot by up to
+// a scheduler quantum, so the last RENDER_SPIN_MARGIN is spun instead. When
+// not active, sampling is coarser and nothing spins; an idle screen is
+// redrawn as soon as there is input. Minimized, events are polled only every
+// RENDER_MINIMIZED_POLL.
+void WaitForNextFrame(InputSampler *sampler, InputQueue *q, double frameDeadline, PresentMode mode)
+{
+    bool   active = (mode == PRESENT_ACTIVE);
+    double period = active ? INPUT_SAMPLE_PERIOD :
+                    (mode == PRESENT_MINIMIZED) ? RENDER_MINIMIZED_POLL : INPUT_IDLE_SAMPLE_PERIOD;
+    double spin   = active ? RENDER_SPIN_MARGIN : 0.0;
+    double since  = sampler->lastActivity;
+    for (double now = GetTime(); now < frameDeadline - spin; now = GetTime()) {
+        double wait = fmin(period, frameDeadline - spin - now);
+        nanosleep(&(struct timespec){ 0, (long)(wait * 1e9) }, NULL);
+        PollInputEvents();
+        SampleInput(sampler, q);
+        if (mode == PRESENT_IDLE && sampler->lastActivity != since) return;
     }
+    while (GetTime() < frameDeadline) { }
+    PollInputEvents();
+    SampleInput(sampler, q);
+}
 
-    // Full-inventory message
-    float fullMsgTimer = 0.0f;
+// Minimized beats unfocused beats idle. Idle needs a modal screen up, its
+// feedback animations finished and no input for RENDER_IDLE_DELAY. Those
+// screens change on input, which wakes the wait at once; anything the sim
+// changes behind them shows at the next RENDER_IDLE_HZ redraw.
+PresentMode ChoosePresentMode(const UiModel *ui, const UiFeedback *feedback, const InputSampler *sampler)
+{
+    if (IsWindowMinimized()) return PRESENT_MINIMIZED;
+    if (!IsWindowFocused()) return PRESENT_UNFOCUSED;
+
+    bool modal   = ui->dataLogViewerOpen || ui->tradeScreenOpen || ui->inventoryOpen ||
+                   ui->workbenchState == WB_OPEN;
+    bool settled = feedback->tokenAnimTimer <= 0.0f && feedback->pickupFlashTimer <= 0.0f &&
+                   feedback->fullMsgTimer <= 0.0f;
+    if (modal && settled && GetTime() - sampler->lastActivity > RENDER_IDLE_DELAY) return PRESENT_IDLE;
+    return PRESENT_ACTIVE;
+}
 
-    // Inventory screen toggle
-    bool inventoryOpen = false;
-    int  inventoryTab  = 0;    // 0 = ITEMS, 1 = LOGS
+// Frame rate for a present mode (0 = uncapped)
+int PresentHz(PresentMode mode, int targetHz)
+{
+    switch (mode) {
+    case PRESENT_IDLE:      return RENDER_IDLE_HZ;
+    case PRESENT_UNFOCUSED: return (targetHz > 0 && targetHz < RENDER_UNFOCUSED_HZ) ? targetHz : RENDER_UNFOCUSED_HZ;
+    default:                return targetHz;
+    }
+}
 
-    // Animation timers
-    float walkTimer   = 0.0f;   // increments when moving, used for walk bob
-    float breathTimer = 0.0f;   // always increments, used for idle breathing (3s cycle)
-    float pulseTimer  = 0.0f;   // always increments, used for workbench/gate pulses
+// ---------------------------------------------------------------------------
+// Frame pacing  — the render rate is independent of the sim tick. Each frame
+// draws the last two snapshots blended by how far the clock is past the
+// newer tick, so motion stays smooth at any refresh rate (one tick behind).
+// ---------------------------------------------------------------------------
+int FrameCapHz(FrameCap cap)
+{
+    switch (cap) {
+    case FRAME_CAP_DISPLAY: {
+        int refresh = GetMonitorRefreshRate(GetCurrentMonitor());
+        return (refresh > 0 ? refresh : RENDER_FALLBACK_HZ + RENDER_VRR_MARGIN) - RENDER_VRR_MARGIN;
+    }
+    case FRAME_CAP_60:       return 60;
+    case FRAME_CAP_120:      return 120;
+    case FRAME_CAP_144:      return 144;
+    case FRAME_CAP_240:      return 240;
+    case FRAME_CAP_UNCAPPED: return 0;
+    default:                 return RENDER_FALLBACK_HZ;
+    }
+}
 
-    // --- Day/night cycle ---
-    float dayTimer = 45.0f;     // start at roughly "noon-ish"
-    float dayPhase = dayTimer / DAY_DURATION;
+// Record when this frame started against its deadline, and return the next
+// deadline. A frame more than one interval late restarts the cadence rather
+// than rushing the ones after it.
+double PaceFrame(FramePacing *pacing, double frameDeadline, int targetHz)
+{
+    double now = GetTime();
+    if (pacing->lastFrame > 0.0 && targetHz == pacing->targetHz) {
+        double intervalMs = (now - pacing->lastFrame) * 1000.0;
+        double expectMs   = targetHz > 0 ? 1000.0 / targetHz : pacing->intervalMs;
+        double jitterMs   = fabs(intervalMs - expectMs);
+        pacing->intervalMs  = pacing->intervalMs * 0.95 + intervalMs * 0.05;
+        pacing->jitterMs    = pacing->jitterMs * 0.95 + jitterMs * 0.05;
+        pacing->lateMs      = pacing->lateMs * 0.95 + fmax(0.0, now - frameDeadline) * 1000.0 * 0.05;
+        pacing->maxJitterMs = fmax(pacing->maxJitterMs * 0.999, jitterMs);
+    } else {
+        // First frame, or the cap changed: start the averages over
+        *pacing = (FramePacing){ .targetHz = targetHz, .intervalMs = targetHz > 0 ? 1000.0 / targetHz : 0.0 };
+        frameDeadline = now;
+    }
+    pacing->lastFrame = now;
+    if (targetHz <= 0) return now;
+    double next = frameDeadline + 1.0 / targetHz;
+    return (next < now) ? now : next;
+}
 
-    // --- Pickup flash ---
-    float pickupFlashTimer = 0.0f;
-    float pickupFlashMax   = 0.2f;
+// How far to draw from prevCamera/prevPlayerPos toward the snapshot's own
+// state: 0 when the tick has just started, 1 a full tick period later
+float SnapshotBlend(const RenderSnapshot *snap, double now)
+{
+    return Clamp((float)((now - snap->tickTime) * SIM_TICK_HZ), 0.0f, 1.0f);
+}
 
-    // --- Directional facing ---
-    Vector2 facing = { 0.0f, 1.0f };   // default facing down
-    Vector2 prevMovement = { 0.0f, 0.0f };
+// Clicks and ESC presses gathered since the last call
+UiInput TakeUiInput(InputSampler *sampler)
+{
+    UiInput ui = sampler->ui;
+    sampler->ui.count = 0;
+    return ui;
+}
 
-    // --- Footprints ---
-    Footprint footprints[MAX_FOOTPRINTS];
-    for (int i = 0; i < MAX_FOOTPRINTS; i++) footprints[i].active = false;
-    int footprintHead = 0;
-    Vector2 lastFootprintPos = playerPos;
+// Build this tick's input from the queued events, oldest first. A repeated
+// press or click stops the drain and is held for the next tick, and so is a
+// release of a key pressed this tick, so even a tap shorter than a tick is
+// seen down for one tick.
+InputFrame TakeInput(InputReader *reader, InputQueue *q)
+{
+    InputFrame frame = { 0 };
+    frame.down = reader->down;
+    InputEvent ev;
+    while (reader->held ? (ev = reader->heldEvent, reader->held = false, true) : PopInputEvent(q, &ev)) {
+        unsigned int bit = 1u << ev.action;
+        bool repeat = (ev.type == INPUT_EVENT_KEY_DOWN && (frame.pressed & bit)) ||
+                      (ev.type == INPUT_EVENT_KEY_UP && (frame.pressed & bit)) ||
+                      (ev.type == INPUT_EVENT_CLICK && frame.clicked);
+        if (repeat) {
+            reader->held      = true;
+            reader->heldEvent = ev;
+            break;
+        }
+        if (ev.type != INPUT_EVENT_RESIZE) reader->mouse = ev.pos;
+        switch (ev.type) {
+        case INPUT_EVENT_KEY_DOWN:
+            frame.down    |= bit;
+            frame.pressed |= bit;
+            if (frame.time == 0.0) frame.time = ev.time;
+            break;
+        case INPUT_EVENT_KEY_UP:
+            frame.down &= ~bit;
+            break;
+        case INPUT_EVENT_CLICK:
+            frame.clicked = true;
+            frame.mouse   = ev.pos;
+            if (frame.time == 0.0) frame.time = ev.time;
+            break;
+        case INPUT_EVENT_WHEEL:
+            frame.wheel += ev.wheel;
+            break;
+        case INPUT_EVENT_RESIZE:
+            frame.resize = ev.pos;
+            break;
+        }
+    }
+    reader->down = frame.down;
+    if (!frame.clicked) frame.mouse = reader->mouse;
+    return frame;
+}
 
-    // --- Dust puffs ---
-    DustPuff dustPuffs[MAX_DUST_PUFFS];
-    for (int i = 0; i < MAX_DUST_PUFFS; i++) dustPuffs[i].active = false;
-    int dustPuffHead = 0;
-    float dustTimer = 0.0f;
-    bool wasMoving = false;
+static bool InputDown(const InputFrame *in, InputAction a)
+{
+    return (in->down >> a) & 1u;
+}
 
-    // --- Wind lines ---
-    WindLine windLines[MAX_WIND_LINES];
-    for (int i = 0; i < MAX_WIND_LINES; i++) windLines[i].active = false;
-    float windSpawnTimer = 0.0f;
-    float windSpawnInterval = (float)GetRandomValue(200, 800) / 100.0f;
+static bool InputPressed(const InputFrame *in, InputAction a)
+{
+    return (in->pressed >> a) & 1u;
+}
 
-    // --- Parallax dunes (initialized once) ---
-    ParallaxDune parallaxDunes[NUM_PARALLAX_DUNES];
-    for (int i = 0; i < NUM_PARALLAX_DUNES; i++) {
-        parallaxDunes[i].x              = (float)GetRandomValue(-200, screenWidth);
-        parallaxDunes[i].y              = (float)GetRandomValue(20, 120);
-        parallaxDunes[i].width          = (float)GetRandomValue(300, 600);
-        parallaxDunes[i].height         = (float)GetRandomValue(30, 70);
-        parallaxDunes[i].topLeftOffsetX  = (float)GetRandomValue(40, 100);
-        parallaxDunes[i].topRightOffsetX = (float)GetRandomValue(40, 100);
-    }
+// ---------------------------------------------------------------------------
+// Logger  — LogMessage claims a ring slot with a CAS on head, copies the
+// format pointer and raw arguments into it, and publishes it through the
+// slot's sequence number; formatting happens on the writer thread. Filtered
+// calls cost two relaxed loads.
+// ---------------------------------------------------------------------------
+static Logger logger;
 
-    // --- Sandstorm system ---
-    StormState stormState = STORM_CALM;
-    float stormTimer     = (float)GetRandomValue(6000, 12000) / 100.0f; // 60-120s until first storm
-    float stormDuration  = 0.0f;
-    float stormPhase     = 0.0f;   // 0..1 progress through current state
-    float stormMsgAlpha  = 0.0f;
-    float stormSpeedMult = 1.0f;
+static const char *LOG_LEVEL_NAMES[] = { "ALL", "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL", "NONE" };
+static const char *LOG_CATEGORY_NAMES[LOGCAT_COUNT] = { "game", "world", "sim" };
 
-    StormParticle stormParticles[MAX_STORM_PARTICLES];
-    for (int i = 0; i < MAX_STORM_PARTICLES; i++) {
-        stormParticles[i].x      = (float)GetRandomValue(0, screenWidth);
-        stormParticles[i].y      = (float)GetRandomValue(0, screenHeight);
-        stormParticles[i].speed  = (float)GetRandomValue(300, 700);
-        stormParticles[i].alpha  = (float)GetRandomValue(60, 120);
-        stormParticles[i].length = (float)GetRandomValue(20, 80);
-        stormParticles[i].size   = (float)GetRandomValue(10, 30) / 10.0f;
+static double LogClock(void)
+{
+    struct timespec ts;
+    clock_gettime(LOG_CLOCK, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Integer argument size, from the length modifier
+typedef enum {
+    LOG_LEN_INT,                // none, 'h', 'hh' (promoted to int)
+    LOG_LEN_LONG,               // 'l'
+    LOG_LEN_LLONG,              // 'll'
+    LOG_LEN_SIZE,               // 'z'
+    LOG_LEN_MAX,                // 'j'
+    LOG_LEN_PTRDIFF,            // 't'
+} LogArgLength;
+
+// Length of the printf conversion spec at fmt (just past its '%'), and its
+// integer argument size. Flags, fixed widths and precisions, the modifiers
+// above and the conversions d i c u o x X f F e E g G a A s p are supported;
+// anything else ('*' widths, 'L', 'n', ...) ends argument capture, and the
+// rest of the format is written out verbatim.
+static int LogSpecLength(const char *fmt, LogArgLength *length)
+{
+    int n = 0;
+    while (fmt[n] == '-' || fmt[n] == '+' || fmt[n] == ' ' || fmt[n] == '#' ||
+           fmt[n] == '.' || (fmt[n] >= '0' && fmt[n] <= '9')) n++;
+    *length = LOG_LEN_INT;
+    switch (fmt[n]) {
+    case 'h': n += (fmt[n + 1] == 'h') ? 2 : 1; break;
+    case 'l':
+        if (fmt[n + 1] == 'l') { *length = LOG_LEN_LLONG; n += 2; }
+        else                   { *length = LOG_LEN_LONG;  n += 1; }
+        break;
+    case 'z': *length = LOG_LEN_SIZE;    n++; break;
+    case 'j': *length = LOG_LEN_MAX;     n++; break;
+    case 't': *length = LOG_LEN_PTRDIFF; n++; break;
+    default: break;
     }
+    return n + 1;
+}
 
-    // Main game loop
-    while (!WindowShouldClose()) {
-        float deltaTime = GetFrameTime();
+static bool LogIsSigned(char conv)  { return conv == 'd' || conv == 'i' || conv == 'c'; }
+static bool LogIsInteger(char conv) { return LogIsSigned(conv) || conv == 'u' || conv == 'o' || conv == 'x' || conv == 'X'; }
+static bool LogIsDouble(char conv)
+{
+    return conv == 'f' || conv == 'F' || conv == 'e' || conv == 'E' ||
+           conv == 'g' || conv == 'G' || conv == 'a' || conv == 'A';
+}
 
-        // Always advance breath and pulse timers
-        breathTimer += deltaTime;
-        pulseTimer  += deltaTime;
+static long long LogReadInt(va_list *ap, LogArgLength length, bool isSigned)
+{
+    switch (length) {
+    case LOG_LEN_LONG:    return isSigned ? va_arg(*ap, long)      : (long long)va_arg(*ap, unsigned long);
+    case LOG_LEN_LLONG:   return isSigned ? va_arg(*ap, long long) : (long long)va_arg(*ap, unsigned long long);
+    case LOG_LEN_SIZE:    return (long long)va_arg(*ap, size_t);
+    case LOG_LEN_MAX:     return isSigned ? (long long)va_arg(*ap, intmax_t) : (long long)va_arg(*ap, uintmax_t);
+    case LOG_LEN_PTRDIFF: return (long long)va_arg(*ap, ptrdiff_t);
+    default:              return isSigned ? va_arg(*ap, int)       : (long long)va_arg(*ap, unsigned int);
+    }
+}
 
-        // --- Day/night cycle ---
-        dayTimer += deltaTime;
-        if (dayTimer >= DAY_DURATION) dayTimer -= DAY_DURATION;
-        dayPhase = dayTimer / DAY_DURATION;
-        bool isNight = (dayPhase > 0.75f || dayPhase < 0.05f);
+static int LogFormatInt(char *buf, int size, const char *spec, LogArgLength length, bool isSigned, long long v)
+{
+    switch (length) {
+    case LOG_LEN_LONG:    return isSigned ? snprintf(buf, size, spec, (long)v) : snprintf(buf, size, spec, (unsigned long)v);
+    case LOG_LEN_LLONG:   return isSigned ? snprintf(buf, size, spec, v)       : snprintf(buf, size, spec, (unsigned long long)v);
+    case LOG_LEN_SIZE:    return snprintf(buf, size, spec, (size_t)v);
+    case LOG_LEN_MAX:     return isSigned ? snprintf(buf, size, spec, (intmax_t)v) : snprintf(buf, size, spec, (uintmax_t)v);
+    case LOG_LEN_PTRDIFF: return snprintf(buf, size, spec, (ptrdiff_t)v);
+    default:              return isSigned ? snprintf(buf, size, spec, (int)v)  : snprintf(buf, size, spec, (unsigned int)v);
+    }
+}
 
-        // Dynamic shadow offsets (rotate through the day)
-        float shadowOffsetX = cosf(dayPhase * 2.0f * PI) * 8.0f;
-        float shadowOffsetY = 6.0f;
-        if (isNight) { shadowOffsetX = 0.0f; shadowOffsetY = 0.0f; }
+void LogMessage(int level, LogCategory category, const char *fmt, ...)
+{
+    if (level < atomic_load_explicit(&logger.minLevel, memory_order_relaxed) ||
+        !((atomic_load_explicit(&logger.categoryMask, memory_order_relaxed) >> category) & 1u)) {
+        return;
+    }
 
-        // Token anim timer
-        if (tokenAnimTimer > 0.0f) {
-            tokenAnimTimer -= deltaTime;
-            if (tokenAnimTimer < 0.0f) tokenAnimTimer = 0.0f;
+    // Claim a slot (bounded MPMC ring, single consumer)
+    unsigned pos = atomic_load_explicit(&logger.head, memory_order_relaxed);
+    LogRecord *rec;
+    for (;;) {
+        rec = &logger.records[pos & (LOG_RING_SIZE - 1)];
+        int diff = (int)(atomic_load_explicit(&rec->seq, memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&logger.head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&logger.dropped[category], 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&logger.head, memory_order_relaxed);
         }
+    }
 
-        // Toggle inventory (only when workbench and trade screen are closed)
-        if (IsKeyPressed(KEY_TAB) && workbenchState == WB_CLOSED && !tradeScreenOpen) {
-            inventoryOpen = !inventoryOpen;
-        }
-        if (IsKeyPressed(KEY_ESCAPE) && inventoryOpen) {
-            inventoryOpen = false;
-        }
-        // Close trade screen on ESC (handled also in DrawTradeScreenUI, but catch here too)
-        if (IsKeyPressed(KEY_ESCAPE) && tradeScreenOpen) {
-            tradeScreenOpen    = false;
-            selectedTradeSlot  = -1;
-        }
+    rec->level    = level;
+    rec->category = category;
+    rec->time     = LogClock() - logger.startTime;
+    rec->fmt      = fmt;
+
+    // Capture arguments by conversion type; they are formatted later
+    va_list ap;
+    va_start(ap, fmt);
+    int n = 0;
+    for (const char *c = fmt; *c && n < LOG_MAX_ARGS; c++) {
+        if (*c != '%') continue;
+        if (c[1] == '%') { c++; continue; }
+        LogArgLength length;
+        c += LogSpecLength(c + 1, &length);
+        if (LogIsInteger(*c))     rec->args[n++].i = LogReadInt(&ap, length, LogIsSigned(*c));
+        else if (LogIsDouble(*c)) rec->args[n++].f = va_arg(ap, double);
+        else if (*c == 's')       rec->args[n++].s = va_arg(ap, const char *);
+        else if (*c == 'p')       rec->args[n++].p = va_arg(ap, const void *);
+        else break;               // unsupported: later arguments cannot be located
+    }
+    va_end(ap);
+    rec->numArgs = n;
+    atomic_store_explicit(&rec->seq, pos + 1, memory_order_release);
+}
 
-        // Workbench repair timer (advance while repairing)
-        if (workbenchState == WB_REPAIRING) {
-            repairTimer += deltaTime;
-            if (repairTimer >= 2.0f) {
-                // Repair complete
-                if (repairSlot >= 0 && repairSlot < maxInventory &&
-                    inventory[repairSlot].occupied) {
-                    // Apply bonus using baseRepairBonus (matching type adds +0.1)
-                    ItemCategory repCat  = ITEM_TYPES[inventory[repairSlot].typeIndex].category;
-                    ItemCategory sacCat  = ITEM_TYPES[inventory[sacrificeSlot].typeIndex].category;
-                    float bonus = (repCat == sacCat) ? (baseRepairBonus + 0.1f) : baseRepairBonus;
-                    inventory[repairSlot].condition += bonus;
-                    if (inventory[repairSlot].condition > 1.0f)
-                        inventory[repairSlot].condition = 1.0f;
-                }
-                // Destroy sacrifice
-                if (sacrificeSlot >= 0 && sacrificeSlot < maxInventory) {
-                    inventory[sacrificeSlot].occupied = false;
-                    inventory[sacrificeSlot].condition = 0.0f;
-                }
-                repairSlot    = -1;
-                sacrificeSlot = -1;
-                repairDone    = true;
-                workbenchState = WB_OPEN;
-                // Trigger pickup flash
-                pickupFlashTimer = pickupFlashMax;
-            }
+// Expand a record's format with its captured arguments
+static void FormatLogRecord(const LogRecord *rec, char *buf, int size)
+{
+    int len = 0, n = 0;
+    for (const char *c = rec->fmt; *c && len < size - 1; ) {
+        if (*c != '%' || c[1] == '%' || n >= rec->numArgs) {
+            buf[len++] = *c;
+            c += (*c == '%' && c[1] == '%') ? 2 : 1;
+            continue;
         }
+        LogArgLength length;
+        int specLen = LogSpecLength(c + 1, &length) + 1;
+        char conv = c[specLen - 1];
+        char spec[16];
+        if (specLen >= (int)sizeof(spec)) specLen = (int)sizeof(spec) - 1;
+        memcpy(spec, c, specLen);
+        spec[specLen] = '\0';
+        LogArg a = rec->args[n++];
+        int w;
+        if (LogIsInteger(conv))     w = LogFormatInt(buf + len, size - len, spec, length, LogIsSigned(conv), a.i);
+        else if (LogIsDouble(conv)) w = snprintf(buf + len, size - len, spec, a.f);
+        else if (conv == 's')       w = snprintf(buf + len, size - len, spec, a.s ? a.s : "(null)");
+        else                        w = snprintf(buf + len, size - len, spec, a.p);
+        len += (w < size - len) ? w : size - 1 - len;
+        c += specLen;
+    }
+    buf[len] = '\0';
+}
 
-        // --- Sandstorm state machine ---
-        stormTimer -= deltaTime;
-        if (stormState == STORM_CALM && stormTimer <= 0.0f) {
-            stormState    = STORM_BUILDING;
-            stormDuration = 5.0f;
-            stormTimer    = stormDuration;
-            stormPhase    = 0.0f;
-            printf("SANDSTORM building...\n");
-        } else if (stormState == STORM_BUILDING) {
-            stormPhase = 1.0f - (stormTimer / stormDuration);
-            stormMsgAlpha = stormPhase;
-            if (stormTimer <= 0.0f) {
-                stormState    = STORM_ACTIVE;
-                stormDuration = (float)GetRandomValue(2000, 3000) / 100.0f;
-                stormTimer    = stormDuration;
-                stormPhase    = 0.0f;
-                stormSpeedMult = 0.7f;
-                printf("SANDSTORM\n");
-            }
-        } else if (stormState == STORM_ACTIVE) {
-            stormPhase = stormTimer / stormDuration;
-            stormMsgAlpha = 0.0f;
-            if (stormTimer <= 0.0f) {
-                stormState    = STORM_FADING;
-                stormDuration = 5.0f;
-                stormTimer    = stormDuration;
-                stormPhase    = 0.0f;
-            }
-        } else if (stormState == STORM_FADING) {
-            stormPhase = stormTimer / stormDuration;
-            stormSpeedMult = 0.7f + (1.0f - stormPhase) * 0.3f;
-            if (stormTimer <= 0.0f) {
-                stormState    = STORM_CALM;
-                stormTimer    = (float)GetRandomValue(6000, 12000) / 100.0f;
-                stormPhase    = 0.0f;
-                stormSpeedMult = 1.0f;
-                stormMsgAlpha  = 0.0f;
-            }
-        }
-
-        if (!inventoryOpen && workbenchState == WB_CLOSED && !tradeScreenOpen && !dataLogViewerOpen) {
-            // Player movement with WASD
-            Vector2 movement = { 0 };
-            if (IsKeyDown(KEY_W)) movement.y -= 1;
-            if (IsKeyDown(KEY_S)) movement.y += 1;
-            if (IsKeyDown(KEY_A)) movement.x -= 1;
-            if (IsKeyDown(KEY_D)) movement.x += 1;
+// Write out every published record; returns how many there were
+static int DrainLog(void)
+{
+    int count = 0;
+    for (;;) {
+        LogRecord *rec = &logger.records[logger.tail & (LOG_RING_SIZE - 1)];
+        if (atomic_load_explicit(&rec->seq, memory_order_acquire) != logger.tail + 1) break;
+        char msg[256];
+        FormatLogRecord(rec, msg, sizeof(msg));
+        fprintf(logger.out, "[%9.3f] %-5s %-5s %s\n", rec->time,
+                LOG_LEVEL_NAMES[rec->level], LOG_CATEGORY_NAMES[rec->category], msg);
+        atomic_store_explicit(&rec->seq, logger.tail + LOG_RING_SIZE, memory_order_release);
+        logger.tail++;
+        count++;
+    }
+    if (count > 0) fflush(logger.out);
+    return count;
+}
 
-            bool isMoving = (movement.x != 0 || movement.y != 0);
+static void *LogWriterMain(void *arg)
+{
+    (void)arg;
+    while (!atomic_load(&logger.quit)) {
+        if (DrainLog() == 0) nanosleep(&(struct timespec){ 0, LOG_IDLE_SLEEP_NS }, NULL);
+    }
+    DrainLog();
+    return NULL;
+}
 
-            // Normalize diagonal movement
-            if (isMoving) {
-                float length = sqrtf(movement.x * movement.x + movement.y * movement.y);
-                movement.x /= length;
-                movement.y /= length;
-                walkTimer += deltaTime * 6.0f;  // speed_factor = 6 -> ~1Hz bob at normal speed
+void InitLogger(FILE *out, int minLevel)
+{
+    for (unsigned i = 0; i < LOG_RING_SIZE; i++) atomic_init(&logger.records[i].seq, i);
+    atomic_init(&logger.head, 0);
+    logger.tail = 0;
+    atomic_init(&logger.minLevel, minLevel);
+    atomic_init(&logger.categoryMask, (1u << LOGCAT_COUNT) - 1);
+    for (int c = 0; c < LOGCAT_COUNT; c++) atomic_init(&logger.dropped[c], 0);
+    atomic_init(&logger.quit, false);
+    logger.startTime = LogClock();
+    logger.out = out;
+    pthread_create(&logger.thread, NULL, LogWriterMain, NULL);
+}
 
-                // Track facing direction
-                facing.x = movement.x;
-                facing.y = movement.y;
+// Flush what is queued, stop the writer and report any dropped records
+void ShutdownLogger(void)
+{
+    atomic_store(&logger.quit, true);
+    pthread_join(logger.thread, NULL);
+    for (int c = 0; c < LOGCAT_COUNT; c++) {
+        unsigned dropped = atomic_load(&logger.dropped[c]);
+        if (dropped > 0) fprintf(logger.out, "log: %u %s records dropped\n", dropped, LOG_CATEGORY_NAMES[c]);
+    }
+    fflush(logger.out);
+}
 
-                // Dust puffs: on start of movement or direction change
-                bool dirChanged = (movement.x != prevMovement.x || movement.y != prevMovement.y);
-                if (!wasMoving || dirChanged) {
-                    // Spawn a bigger dust puff
-                    DustPuff *dp = &dustPuffs[dustPuffHead % MAX_DUST_PUFFS];
-                    dp->position = playerPos;
-                    dp->timer    = 0.4f;
-                    dp->maxTimer = 0.4f;
-                    dp->radius   = 12.0f;
-                    dp->active   = true;
-                    dustPuffHead++;
-                }
+void SetLogCategory(LogCategory category, bool enabled)
+{
+    if (enabled) atomic_fetch_or(&logger.categoryMask, 1u << category);
+    else         atomic_fetch_and(&logger.categoryMask, ~(1u << category));
+}
 
-                // Continuous small dust puffs while moving
-                dustTimer += deltaTime;
-                if (dustTimer >= 0.15f) {
-                    dustTimer = 0.0f;
-                    DustPuff *dp = &dustPuffs[dustPuffHead % MAX_DUST_PUFFS];
-                    dp->position = playerPos;
-                    dp->timer    = 0.3f;
-                    dp->maxTimer = 0.3f;
-                    dp->radius   = 6.0f;
-                    dp->active   = true;
-                    dustPuffHead++;
-                }
+// ---------------------------------------------------------------------------
+// Item table  — parsed once at startup from ITEM_DEFS_PATH, one type per
+// '|'-separated line (see assets/items.txt). Ids are found through an
+// open-addressing index of their hashes; sprites are packed into one atlas.
+// ---------------------------------------------------------------------------
+static ItemTable itemTable;
 
-                // Footprints: when moved more than 15px from last footprint
-                float distFromLast = Vector2Distance(playerPos, lastFootprintPos);
-                if (distFromLast >= 15.0f) {
-                    Footprint *fp = &footprints[footprintHead % MAX_FOOTPRINTS];
-                    fp->position = playerPos;
-                    fp->alpha    = 120.0f;
-                    fp->timer    = 4.0f;
-                    fp->active   = true;
-                    footprintHead++;
-                    lastFootprintPos = playerPos;
-                }
-            } else {
-                dustTimer = 0.0f;
-            }
+// Used when the data file is missing or holds no usable type
+static const char DEFAULT_ITEM_DEFS[] =
+    "circuit | Circuit Board | ELECTRONICS | 6B7B6B | assets/sprites/item_circuit.png | 0.10 | 1 | 1\n"
+    "wire    | Wire Bundle   | ELECTRONICS | B87333 | assets/sprites/item_wire.png    | 0.10 | 1 | 1\n"
+    "battery | Battery Cell  | POWER       | 8B3A3A | assets/sprites/item_battery.png | 0.10 | 1 | 1\n"
+    "lens    | Lens Array    | OPTICS      | 87CEEB | assets/sprites/item_lens.png    | 0.10 | 1 | 1\n"
+    "metal   | Metal Plating | STRUCTURAL  | A8A8A8 | assets/sprites/item_metal.png   | 0.10 | 1 | 1\n";
 
-            wasMoving     = isMoving;
-            prevMovement  = movement;
+_Static_assert((unsigned long long)ITEM_MAX_TYPES * ITEM_MAX_WEIGHT <= 0xFFFFFFFFull,
+               "spawn weights must sum within ItemTable.spawnTotal");
 
-            // Apply movement (with storm speed multiplier)
-            float effectiveSpeed = PLAYER_SPEED * stormSpeedMult;
-            playerPos.x += movement.x * effectiveSpeed * deltaTime;
-            playerPos.y += movement.y * effectiveSpeed * deltaTime;
+enum { ITEM_FIELD_ID, ITEM_FIELD_NAME, ITEM_FIELD_CATEGORY, ITEM_FIELD_COLOR, ITEM_FIELD_SPRITE,
+       ITEM_FIELD_REPAIR, ITEM_FIELD_TOKENS, ITEM_FIELD_WEIGHT, ITEM_FIELD_COUNT };
 
-            // Keep player within world bounds
-            if (playerPos.x < 0)            playerPos.x = 0;
-            if (playerPos.x > WORLD_WIDTH)  playerPos.x = WORLD_WIDTH;
-            if (playerPos.y < 0)            playerPos.y = 0;
-            if (playerPos.y > WORLD_HEIGHT) playerPos.y = WORLD_HEIGHT;
+// Helper: FNV-1a string hash
+static unsigned int HashString(const char *s)
+{
+    unsigned int h = 2166136261u;
+    while (*s) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
 
-            // Smooth camera follow
-            camera.target = Vector2Lerp(camera.target, playerPos, 0.1f);
+// Helper: trim spaces and tabs in place
+static char *TrimField(char *s)
+{
+    while (*s == ' ' || *s == '\t') s++;
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+    *end = '\0';
+    return s;
+}
 
-            // Update particles
-            UpdateParticles(particles, NUM_PARTICLES, deltaTime);
+// Index of the type with this id, or -1
+int FindItemType(const ItemTable *table, const char *id)
+{
+    unsigned int slot = HashString(id) & table->indexMask;
+    while (table->index[slot] != 0) {
+        int t = table->index[slot] - 1;
+        if (strcmp(table->types[t].id, id) == 0) return t;
+        slot = (slot + 1) & table->indexMask;
+    }
+    return -1;
+}
 
-            // Pickup effect timer
-            if (pickupEffect.active) {
-                pickupEffect.timer -= deltaTime;
-                if (pickupEffect.timer <= 0.0f) {
-                    pickupEffect.active = false;
-                }
-            }
+// Spawn a type with probability proportional to its weight; with equal
+// weights this is the same draw as RngRange(rng, 0, count - 1)
+int RandomItemType(const ItemTable *table, WorldRng *rng)
+{
+    unsigned int r = RngNext(rng) % table->spawnTotal;
+    int lo = 0, hi = table->count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (table->spawnCumulative[mid] > r) hi = mid;
+        else                                 lo = mid + 1;
+    }
+    return lo;
+}
 
-            // Pickup flash timer
-            if (pickupFlashTimer > 0.0f) {
-                pickupFlashTimer -= deltaTime;
-                if (pickupFlashTimer < 0.0f) pickupFlashTimer = 0.0f;
-            }
+// Parse one line into def; false if it is malformed
+static bool ParseItemLine(char *line, ItemTypeDef *def, const char **category)
+{
+    int n = 1;
+    for (const char *p = line; *p; p++) n += (*p == '|');
+    if (n != ITEM_FIELD_COUNT) return false;
+
+    char *field[ITEM_FIELD_COUNT];
+    char *p = line;
+    for (int i = 0; i < ITEM_FIELD_COUNT; i++) {
+        char *bar = strchr(p, '|');
+        if (bar) *bar = '\0';
+        field[i] = TrimField(p);
+        if (bar) p = bar + 1;
+    }
+    if (*field[ITEM_FIELD_ID] == '\0' || *field[ITEM_FIELD_NAME] == '\0' ||
+        *field[ITEM_FIELD_CATEGORY] == '\0' || strlen(field[ITEM_FIELD_COLOR]) != 6) {
+        return false;
+    }
 
-            // Full message timer
-            if (fullMsgTimer > 0.0f) {
-                fullMsgTimer -= deltaTime;
-                if (fullMsgTimer < 0.0f) fullMsgTimer = 0.0f;
-            }
+    char *endColor, *endRepair, *endTokens, *endWeight;
+    unsigned long rgb = strtoul(field[ITEM_FIELD_COLOR], &endColor, 16);
+    float repair      = strtof(field[ITEM_FIELD_REPAIR], &endRepair);
+    long tokens       = strtol(field[ITEM_FIELD_TOKENS], &endTokens, 10);
+    long weight       = strtol(field[ITEM_FIELD_WEIGHT], &endWeight, 10);
+    if (*endColor != '\0' || *endRepair != '\0' || *endTokens != '\0' || *endWeight != '\0' ||
+        endRepair == field[ITEM_FIELD_REPAIR] || endTokens == field[ITEM_FIELD_TOKENS] ||
+        endWeight == field[ITEM_FIELD_WEIGHT] || !(repair >= 0.0f && repair <= 1.0f) ||
+        tokens < 0 || tokens > ITEM_MAX_TOKENS || weight < 0 || weight > ITEM_MAX_WEIGHT) {
+        return false;
+    }
 
-            // E key: check gate proximity, workbench proximity, then item pickup
-            if (IsKeyPressed(KEY_E)) {
-                // Check gate proximity (70px)
-                Vector2 gatePos = { GATE_X, GATE_Y };
-                float gateDist  = Vector2Distance(playerPos, gatePos);
-                // Check workbench proximity (60px)
-                Vector2 wbPos = { WORKBENCH_X, WORKBENCH_Y };
-                float wbDist  = Vector2Distance(playerPos, wbPos);
-                bool nearItem = false;
-                for (int i = 0; i < NUM_SCAVENGE_ITEMS; i++) {
-                    if (!worldItems[i].active) continue;
-                    if (Vector2Distance(playerPos, worldItems[i].position) <= PICKUP_RADIUS) {
-                        nearItem = true;
-                        break;
-                    }
-                }
-                // Gate takes priority if near enough and no workbench open
-                if (!nearItem && gateDist <= GATE_INTERACT_RADIUS && workbenchState == WB_CLOSED) {
-                    tradeScreenOpen   = true;
-                    selectedTradeSlot = -1;
-                } else if (!nearItem && wbDist <= 60.0f && workbenchState == WB_CLOSED) {
-                    // Open workbench
-                    workbenchState = WB_OPEN;
-                    repairSlot     = -1;
-                    sacrificeSlot  = -1;
-                    repairDone     = false;
-                } else {
-                    // Normal item pickup
-                    for (int i = 0; i < NUM_SCAVENGE_ITEMS; i++) {
-                        if (!worldItems[i].active) continue;
-                        float dist = Vector2Distance(playerPos, worldItems[i].position);
-                        if (dist <= PICKUP_RADIUS) {
-                            int invCount = CountInventory(inventory, maxInventory);
-                            if (invCount < maxInventory) {
-                                AddToInventory(inventory, worldItems[i].typeIndex,
-                                               worldItems[i].condition, maxInventory);
-                                worldItems[i].active = false;
-                                worldItems[i].respawnTimer = 60.0f + (float)GetRandomValue(0, 30);
-                                pickupEffect.position = worldItems[i].position;
-                                pickupEffect.timer    = PICKUP_EFFECT_DURATION;
-                                pickupEffect.active   = true;
-                                pickupFlashTimer      = pickupFlashMax;
-                            } else {
-                                fullMsgTimer = FULL_MSG_DURATION;
-                            }
-                            break; // only pick up one item per press
-                        }
-                    }
-                    // If near workbench and no item, open it
-                    if (!nearItem && wbDist <= 60.0f && workbenchState == WB_CLOSED) {
-                        workbenchState = WB_OPEN;
-                        repairSlot     = -1;
-                        sacrificeSlot  = -1;
-                        repairDone     = false;
-                    }
-                }
-            }
+    *def = (ItemTypeDef){
+        .id          = field[ITEM_FIELD_ID],
+        .name        = field[ITEM_FIELD_NAME],
+        .color       = { (unsigned char)(rgb >> 16), (unsigned char)(rgb >> 8), (unsigned char)rgb, 255 },
+        .spritePath  = field[ITEM_FIELD_SPRITE],
+        .repairBonus = repair,
+        .tradeTokens = (int)tokens,
+        .spawnWeight = (int)weight,
+    };
+    *category = field[ITEM_FIELD_CATEGORY];
+    return true;
+}
+
+// Parse text (taken over by the table, MemAlloc'd) into table. Bad and
+// duplicate lines are skipped with a warning that names no string from text,
+// since a failed table is freed before the logger formats it; false if no
+// type spawns.
+static bool ParseItemTable(ItemTable *table, char *text, const char *source)
+{
+    memset(table, 0, sizeof(*table));
+    table->text = text;
+
+    int lines = 1;
+    for (const char *p = text; *p; p++) lines += (*p == '\n');
+    if (lines > ITEM_MAX_TYPES) lines = ITEM_MAX_TYPES;
+    unsigned int slots = 16;
+    while (slots < 2u * (unsigned int)lines) slots <<= 1;
+    table->capacity        = lines;
+    table->types           = calloc((size_t)lines, sizeof(ItemTypeDef));
+    table->categories      = calloc((size_t)lines, sizeof(const char *));
+    table->spawnCumulative = calloc((size_t)lines, sizeof(unsigned int));
+    table->index           = calloc(slots, sizeof(int));
+    table->indexMask       = slots - 1;
+    if (!table->types || !table->categories || !table->spawnCumulative || !table->index) return false;
+
+    int lineNo = 0;
+    for (char *line = text; line != NULL; ) {
+        char *next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+        lineNo++;
+        line = TrimField(line);
+        if (*line == '\0' || *line == '#') { line = next; continue; }
+
+        ItemTypeDef def;
+        const char *category;
+        if (table->count >= table->capacity) {
+            LogMessage(LOG_WARNING, LOGCAT_GAME, "%s:%d: more than %d item types, rest ignored",
+                       source, lineNo, ITEM_MAX_TYPES);
+            break;
+        }
+        if (!ParseItemLine(line, &def, &category)) {
+            LogMessage(LOG_WARNING, LOGCAT_GAME, "%s:%d: malformed item line skipped", source, lineNo);
+            line = next;
+            continue;
+        }
+        if (FindItemType(table, def.id) >= 0) {
+            LogMessage(LOG_WARNING, LOGCAT_GAME, "%s:%d: duplicate item id skipped", source, lineNo);
+            line = next;
+            continue;
         }
 
-        // --- Update footprints ---
-        for (int i = 0; i < MAX_FOOTPRINTS; i++) {
-            if (!footprints[i].active) continue;
-            footprints[i].timer -= deltaTime;
-            footprints[i].alpha = (footprints[i].timer / 4.0f) * 120.0f;
-            if (footprints[i].timer <= 0.0f) {
-                footprints[i].active = false;
-            }
+        // Categories are few; interning them is a scan at load time only
+        def.category = -1;
+        for (int c = 0; c < table->numCategories; c++) {
+            if (strcmp(table->categories[c], category) == 0) { def.category = c; break; }
+        }
+        if (def.category < 0) {
+            def.category = table->numCategories;
+            table->categories[table->numCategories++] = category;
         }
+        def.categoryName = category;
+
+        int t = table->count++;
+        table->types[t] = def;
+        table->spawnTotal += (unsigned int)def.spawnWeight;
+        table->spawnCumulative[t] = table->spawnTotal;
+        unsigned int slot = HashString(def.id) & table->indexMask;
+        while (table->index[slot] != 0) slot = (slot + 1) & table->indexMask;
+        table->index[slot] = t + 1;
+        table->hash = HashUint(table->hash ^ HashString(def.id)) ^ (unsigned int)def.spawnWeight;
+        line = next;
+    }
+    return table->count > 0 && table->spawnTotal > 0;
+}
 
-        // --- Update dust puffs ---
-        for (int i = 0; i < MAX_DUST_PUFFS; i++) {
-            if (!dustPuffs[i].active) continue;
-            dustPuffs[i].timer -= deltaTime;
-            if (dustPuffs[i].timer <= 0.0f) {
-                dustPuffs[i].active = false;
-            }
+// Load the item types from path, or the built-in defaults if it is missing
+// or unusable. Must run before the sim or the chunk workers start.
+void LoadItemTable(ItemTable *table, const char *path)
+{
+    char *text = LoadFileText(path);
+    if (text != NULL) {
+        if (ParseItemTable(table, text, path)) {
+            LogMessage(LOG_INFO, LOGCAT_GAME, "%d item types in %d categories from %s",
+                       table->count, table->numCategories, path);
+            return;
         }
+        FreeItemTable(table);
+        LogMessage(LOG_WARNING, LOGCAT_GAME, "%s has no item that can spawn, using built-in items", path);
+    } else {
+        LogMessage(LOG_WARNING, LOGCAT_GAME, "%s not found, using built-in items", path);
+    }
+    text = MemAlloc(sizeof(DEFAULT_ITEM_DEFS));
+    memcpy(text, DEFAULT_ITEM_DEFS, sizeof(DEFAULT_ITEM_DEFS));
+    if (!ParseItemTable(table, text, "built-in items")) {
+        LogMessage(LOG_FATAL, LOGCAT_GAME, "No memory for the item table");
+        abort();
+    }
+}
+
+// Free the table; its strings may still be referenced by queued log records,
+// so this runs after ShutdownLogger
+void FreeItemTable(ItemTable *table)
+{
+    MemFree(table->text);
+    free(table->types);
+    free((void *)table->categories);
+    free(table->spawnCumulative);
+    free(table->index);
+    memset(table, 0, sizeof(*table));
+}
 
-        // --- Update item respawn timers ---
-        for (int i = 0; i < NUM_SCAVENGE_ITEMS; i++) {
-            if (worldItems[i].active) continue;
-            if (worldItems[i].respawnTimer <= 0.0f) continue;
-            worldItems[i].respawnTimer -= deltaTime;
-            if (worldItems[i].respawnTimer <= 0.0f) {
-                worldItems[i].respawnTimer = 0.0f;
-                // Pick a new position outside the village (>200px from world center)
-                float wx, wy;
-                float cx = WORLD_WIDTH  / 2.0f;
-                float cy = WORLD_HEIGHT / 2.0f;
-                do {
-                    wx = 100.0f + (float)GetRandomValue(0, WORLD_WIDTH  - 200);
-                    wy = 100.0f + (float)GetRandomValue(0, WORLD_HEIGHT - 200);
-                } while (fabsf(wx - cx) < 200.0f && fabsf(wy - cy) < 200.0f);
-                worldItems[i].position  = (Vector2){ wx, wy };
-                worldItems[i].typeIndex = GetRandomValue(0, NUM_ITEM_TYPES - 1);
-                worldItems[i].condition = 0.3f + (float)GetRandomValue(0, 600) / 1000.0f;
-                worldItems[i].active    = true;
-                // Trigger shimmer at new position (reuse slot i)
-                spawnShimmers[i].position = worldItems[i].position;
-                spawnShimmers[i].timer    = 1.0f;
-                spawnShimmers[i].active   = true;
+// Scale every item sprite to ITEM_SPRITE_PX on its long side and shelf-pack
+// them into one texture, filling in each type's atlasRect. Types sharing a
+// sprite path share a rect; missing sprites, and any that do not fit, keep a
+// zero rect and are drawn as dots. Main thread, after InitWindow.
+Texture2D BuildItemAtlas(ItemTable *table)
+{
+    Image atlas = GenImageColor(ITEM_ATLAS_WIDTH, ITEM_ATLAS_MAX_H, BLANK);
+    int *seen = calloc(table->indexMask + 1, sizeof(int));     // sprite path hash -> type + 1
+    int x = 0, y = 0, shelfH = 0, packed = 0;
+
+    for (int t = 0; t < table->count; t++) {
+        ItemTypeDef *def = &table->types[t];
+        if (def->spritePath[0] == '\0') continue;
+
+        unsigned int slot = HashString(def->spritePath) & table->indexMask;
+        int shared = -1;
+        while (seen && seen[slot] != 0) {
+            if (strcmp(table->types[seen[slot] - 1].spritePath, def->spritePath) == 0) {
+                shared = seen[slot] - 1;
+                break;
             }
+            slot = (slot + 1) & table->indexMask;
+        }
+        if (shared >= 0) {
+            def->atlasRect = table->types[shared].atlasRect;
+            continue;
         }
+        if (seen) seen[slot] = t + 1;
 
-        // --- Update spawn shimmer timers ---
-        for (int i = 0; i < NUM_SCAVENGE_ITEMS; i++) {
-            if (!spawnShimmers[i].active) continue;
-            spawnShimmers[i].timer -= deltaTime;
-            if (spawnShimmers[i].timer <= 0.0f) {
-                spawnShimmers[i].timer  = 0.0f;
-                spawnShimmers[i].active = false;
-            }
+        Image img = LoadImage(def->spritePath);
+        if (img.data == NULL) {
+            LogMessage(LOG_WARNING, LOGCAT_GAME, "Item '%s': sprite %s not loaded", def->id, def->spritePath);
+            continue;
+        }
+        int longSide = (img.width > img.height) ? img.width : img.height;
+        if (longSide > ITEM_SPRITE_PX) {
+            ImageResize(&img, img.width * ITEM_SPRITE_PX / longSide, img.height * ITEM_SPRITE_PX / longSide);
+        }
+        if (x + img.width > ITEM_ATLAS_WIDTH) {
+            x = 0;
+            y += shelfH + ITEM_ATLAS_PAD;
+            shelfH = 0;
         }
+        if (y + img.height > ITEM_ATLAS_MAX_H) {
+            LogMessage(LOG_WARNING, LOGCAT_GAME, "Item atlas full: '%s' drawn as a dot", def->id);
+            UnloadImage(img);
+            continue;
+        }
+        def->atlasRect = (Rectangle){ (float)x, (float)y, (float)img.width, (float)img.height };
+        ImageDraw(&atlas, img, (Rectangle){ 0, 0, (float)img.width, (float)img.height }, def->atlasRect, WHITE);
+        x += img.width + ITEM_ATLAS_PAD;
+        if (img.height > shelfH) shelfH = img.height;
+        packed++;
+        UnloadImage(img);
+    }
+    free(seen);
+
+    Texture2D tex = { 0 };
+    if (packed > 0) {
+        ImageCrop(&atlas, (Rectangle){ 0, 0, ITEM_ATLAS_WIDTH, (float)(y + shelfH) });
+        tex = LoadTextureFromImage(atlas);
+        SetTextureFilter(tex, TEXTURE_FILTER_BILINEAR);
+        LogMessage(LOG_INFO, LOGCAT_GAME, "Item atlas: %d sprites, %dx%d", packed, tex.width, tex.height);
+    }
+    UnloadImage(atlas);
+    return tex;
+}
 
-        // --- Update wind lines ---
-        windSpawnTimer += deltaTime;
-        // During storm building: double spawn frequency
-        float effectiveWindInterval = windSpawnInterval;
-        if (stormState == STORM_BUILDING || stormState == STORM_ACTIVE) {
-            effectiveWindInterval *= 0.5f;
+// ---------------------------------------------------------------------------
+// Event and command queues  — lock-free SPSC rings. The producer fills a slot
+// and then publishes it with a release store of head; the consumer reads it
+// after an acquire load of head and frees it with a release store of tail.
+// A full ring drops the push rather than blocking either thread.
+// ---------------------------------------------------------------------------
+void InitEventQueue(EventQueue *q)
+{
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->dropped = 0;
+}
+
+bool PushEvent(EventQueue *q, const GameEvent *ev)
+{
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head - tail == EVENT_QUEUE_SIZE) {
+        q->dropped++;
+        return false;
+    }
+    q->events[head & (EVENT_QUEUE_SIZE - 1)] = *ev;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool PopEvent(EventQueue *q, GameEvent *out)
+{
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (tail == head) return false;
+    *out = q->events[tail & (EVENT_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+void InitCommandQueue(CommandQueue *q)
+{
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+}
+
+bool PushCommand(CommandQueue *q, UiCommandType type, int arg, double time)
+{
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head - tail == COMMAND_QUEUE_SIZE) return false;
+    q->commands[head & (COMMAND_QUEUE_SIZE - 1)] = (UiCommand){ type, arg, time };
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool PopCommand(CommandQueue *q, UiCommand *out)
+{
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (tail == head) return false;
+    *out = q->commands[tail & (COMMAND_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+// Publish a gameplay event to every consumer (sim thread only)
+static void EmitEvent(SimThread *sim, GameEvent ev)
+{
+    PushEvent(&sim->uiEvents, &ev);
+    PushEvent(&sim->telemetry, &ev);
+}
+
+static bool TradeableSlot(const UiModel *ui, int slot)
+{
+    return slot >= 0 && slot < ui->maxInventory &&
+           ui->inventory[slot].occupied && ui->inventory[slot].condition >= 0.8f;
+}
+
+// Apply one UI request to the sim's model, if it is still valid
+static void ApplyUiCommand(SimThread *sim, UiModel *ui, UiCommand cmd)
+{
+    switch (cmd.type) {
+    case UI_CMD_SELECT_TAB:
+        if (cmd.arg == 0 || cmd.arg == 1) ui->inventoryTab = cmd.arg;
+        break;
+    case UI_CMD_OPEN_LOG:
+        if (cmd.arg >= 0 && cmd.arg < ui->dataLogsPurchased) {
+            ui->dataLogViewerOpen  = true;
+            ui->dataLogViewerIndex = cmd.arg;
         }
-        if (windSpawnTimer >= effectiveWindInterval) {
-            windSpawnTimer = 0.0f;
-            windSpawnInterval = (float)GetRandomValue(200, 800) / 100.0f;
-            // Find inactive slot
-            for (int i = 0; i < MAX_WIND_LINES; i++) {
-                if (!windLines[i].active) {
-                    windLines[i].y      = (float)GetRandomValue(0, screenHeight);
-                    windLines[i].x      = (float)screenWidth + 10.0f;
-                    windLines[i].speed  = (float)GetRandomValue(400, 800);
-                    windLines[i].alpha  = 60.0f;
-                    windLines[i].length = (float)GetRandomValue(60, 200);
-                    windLines[i].active = true;
-                    break;
-                }
-            }
+        break;
+    case UI_CMD_CLOSE_LOG:
+        ui->dataLogViewerOpen = false;
+        break;
+    case UI_CMD_PICK_WORKBENCH_SLOT: {
+        // Click an item: unassign it, or fill the repair slot, then the sacrifice slot
+        int i = cmd.arg;
+        if (ui->workbenchState != WB_OPEN || i < 0 || i >= ui->maxInventory ||
+            !ui->inventory[i].occupied) break;
+        if (ui->repairSlot == i) {
+            ui->repairSlot = -1;
+        } else if (ui->sacrificeSlot == i) {
+            ui->sacrificeSlot = -1;
+        } else if (ui->repairSlot == -1) {
+            ui->repairSlot = i;
+        } else if (ui->sacrificeSlot == -1) {
+            ui->sacrificeSlot = i;
         }
-        for (int i = 0; i < MAX_WIND_LINES; i++) {
-            if (!windLines[i].active) continue;
-            windLines[i].x -= windLines[i].speed * deltaTime;
-            // Fade alpha based on horizontal position
-            float progress = 1.0f - ((windLines[i].x + windLines[i].length) / (float)(screenWidth + windLines[i].length + 10));
-            windLines[i].alpha = 60.0f * (1.0f - progress);
-            if (windLines[i].x + windLines[i].length < 0) {
-                windLines[i].active = false;
-            }
+        break;
+    }
+    case UI_CMD_START_REPAIR:
+        if (ui->workbenchState == WB_OPEN && ui->repairSlot >= 0 && ui->sacrificeSlot >= 0 &&
+            ui->inventory[ui->repairSlot].occupied && ui->inventory[ui->sacrificeSlot].occupied) {
+            ui->workbenchState = WB_REPAIRING;
+            ui->repairTimer    = 0.0f;
+        }
+        break;
+    case UI_CMD_CLOSE_WORKBENCH:
+        if (ui->workbenchState == WB_OPEN) {
+            ui->workbenchState = WB_CLOSED;
+            ui->repairSlot     = -1;
+            ui->sacrificeSlot  = -1;
+        }
+        break;
+    case UI_CMD_SELECT_TRADE_SLOT:
+        if (ui->tradeScreenOpen && TradeableSlot(ui, cmd.arg)) {
+            ui->selectedTradeSlot = (ui->selectedTradeSlot == cmd.arg) ? -1 : cmd.arg;
+        }
+        break;
+    case UI_CMD_TRADE: {
+        int slot = ui->selectedTradeSlot;
+        if (!ui->tradeScreenOpen || !TradeableSlot(ui, slot)) break;
+        int typeIndex = ui->inventory[slot].typeIndex;
+        ui->inventory[slot].occupied  = false;
+        ui->inventory[slot].condition = 0.0f;
+        ui->tokenCount += itemTable.types[typeIndex].tradeTokens;
+        ui->selectedTradeSlot = -1;
+        EmitEvent(sim, (GameEvent){ .type = EVENT_TRADE_EXECUTED,
+                                    .trade = { typeIndex, ui->tokenCount } });
+        break;
+    }
+    case UI_CMD_BUY: {
+        if (!ui->tradeScreenOpen) break;
+        int cost;
+        if (cmd.arg == UPGRADE_DATA_LOG) {
+            if (ui->dataLogsPurchased >= 5) break;
+            cost = 2 + ui->dataLogsPurchased;
+        } else if (cmd.arg == UPGRADE_REPAIR_TOOLS) {
+            if (ui->toolUpgradePurchased) break;
+            cost = 3;
+        } else if (cmd.arg == UPGRADE_PACK) {
+            if (ui->carryUpgradePurchased) break;
+            cost = 4;
+        } else {
+            break;
+        }
+        if (ui->tokenCount < cost) break;
+        ui->tokenCount -= cost;
+        if (cmd.arg == UPGRADE_DATA_LOG) {
+            // Open the newly purchased log
+            ui->dataLogViewerIndex = ui->dataLogsPurchased;
+            ui->dataLogsPurchased++;
+            ui->dataLogViewerOpen = true;
+        } else if (cmd.arg == UPGRADE_REPAIR_TOOLS) {
+            ui->toolUpgradePurchased = true;
+            ui->baseRepairBonus      = 0.25f;
+        } else {
+            ui->carryUpgradePurchased = true;
+            ui->maxInventory          = 10;
         }
+        EmitEvent(sim, (GameEvent){ .type = EVENT_UPGRADE_PURCHASED,
+                                    .purchase = { (ShopUpgrade)cmd.arg, cost, ui->tokenCount } });
+        break;
+    }
+    case UI_CMD_CLOSE_TRADE:
+        ui->tradeScreenOpen   = false;
+        ui->selectedTradeSlot = -1;
+        break;
+    }
+}
 
-        // --- Update storm particles ---
-        if (stormState == STORM_ACTIVE || stormState == STORM_BUILDING || stormState == STORM_FADING) {
-            for (int i = 0; i < MAX_STORM_PARTICLES; i++) {
-                stormParticles[i].x -= stormParticles[i].speed * deltaTime;
-                if (stormParticles[i].x + stormParticles[i].length < 0) {
-                    stormParticles[i].x = (float)(screenWidth + 10);
-                    stormParticles[i].y = (float)GetRandomValue(0, screenHeight);
-                }
-            }
+// ---------------------------------------------------------------------------
+// UpdateUiFeedback  — render-thread consumer of the sim's events: starts the
+// flashes and animations they trigger, and runs those timers down.
+// ---------------------------------------------------------------------------
+void UpdateUiFeedback(UiFeedback *feedback, EventQueue *events, float dt)
+{
+    feedback->tokenAnimTimer   = fmaxf(0.0f, feedback->tokenAnimTimer - dt);
+    feedback->pickupFlashTimer = fmaxf(0.0f, feedback->pickupFlashTimer - dt);
+    feedback->fullMsgTimer     = fmaxf(0.0f, feedback->fullMsgTimer - dt);
+
+    GameEvent ev;
+    while (PopEvent(events, &ev)) {
+        switch (ev.type) {
+        case EVENT_ITEM_PICKED_UP:
+        case EVENT_REPAIR_COMPLETED:
+            feedback->pickupFlashTimer = feedback->pickupFlashMax;
+            break;
+        case EVENT_INVENTORY_FULL:
+            feedback->fullMsgTimer = FULL_MSG_DURATION;
+            break;
+        case EVENT_TRADE_EXECUTED:
+            feedback->tokenAnimTimer = 0.4f;
+            feedback->tokenAnimDelta = itemTable.types[ev.trade.typeIndex].tradeTokens;
+            break;
+        case EVENT_UPGRADE_PURCHASED:
+            feedback->tokenAnimTimer = 0.4f;
+            feedback->tokenAnimDelta = -ev.purchase.cost;
+            break;
+        case EVENT_STORM_STATE_CHANGED:
+            break;
         }
+    }
+}
 
-        // Drawing
-        BeginDrawing();
-        ClearBackground(COL_SAND_BASE);
+// ---------------------------------------------------------------------------
+// DrainTelemetry  — session stats consumer; also logs storm transitions.
+// ---------------------------------------------------------------------------
+void DrainTelemetry(EventQueue *events, GameStats *stats)
+{
+    GameEvent ev;
+    while (PopEvent(events, &ev)) {
+        switch (ev.type) {
+        case EVENT_ITEM_PICKED_UP:
+            stats->itemsPickedUp++;
+            break;
+        case EVENT_INVENTORY_FULL:
+            break;
+        case EVENT_REPAIR_COMPLETED:
+            stats->repairs++;
+            break;
+        case EVENT_TRADE_EXECUTED:
+            stats->trades++;
+            stats->tokensEarned += itemTable.types[ev.trade.typeIndex].tradeTokens;
+            break;
+        case EVENT_UPGRADE_PURCHASED:
+            stats->purchases++;
+            stats->tokensSpent += ev.purchase.cost;
+            break;
+        case EVENT_STORM_STATE_CHANGED:
+            if (ev.storm.to == STORM_BUILDING) {
+                LogMessage(LOG_INFO, LOGCAT_GAME, "SANDSTORM building...");
+            } else if (ev.storm.to == STORM_ACTIVE) {
+                stats->storms++;
+                LogMessage(LOG_INFO, LOGCAT_GAME, "SANDSTORM");
+            }
+            break;
+        }
+    }
+}
 
-        // Draw parallax background BEFORE BeginMode2D (screen space with parallax offset)
-        DrawParallaxDunes(parallaxDunes, NUM_PARALLAX_DUNES, camera, screenWidth, screenHeight);
+// ---------------------------------------------------------------------------
+// SimMain  — the simulation thread. Owns the world (chunks, streaming, crowd,
+// player, effects) and ticks it at SIM_TICK_HZ from input latched by the
+// render thread, publishing a RenderSnapshot at the end of every tick.
+// ---------------------------------------------------------------------------
+static void *SimMain(void *arg)
+{
+    SimThread *sim = arg;
+    int screenWidth  = sim->screenWidth;     // follows INPUT_EVENT_RESIZE
+    int screenHeight = sim->screenHeight;
 
-        BeginMode2D(camera);
+    // Sim-side randomness (raylib's RNG belongs to the render thread)
+    WorldRng rng = { HashSeed((unsigned long long)time(NULL), 0x53494D00u) | 1u };
 
-        // Draw ground (tiled sprites + dune arcs)
-        DrawGround(groundCircles, NUM_GROUND_CIRCLES, duneLines, NUM_DUNE_LINES,
-                   &spr, tileGrid, camera, screenWidth, screenHeight);
+    // What a save captures of the sim (the world is saved as seed + overlay)
+    SimState state = { 0 };
+    Storm   *storm = &state.storm;
 
-        // Draw terrain accents (dunes/debris above ground, below items)
-        DrawTerrainAccents(terrainAccents, NUM_TERRAIN_ACCENTS, &spr);
+    // Player starting position (center of village)
+    state.playerPos = (Vector2){ VILLAGE_X, VILLAGE_Y };
 
-        // Draw footprints (above ground, below Z)
-        DrawFootprints(footprints, MAX_FOOTPRINTS);
+    // Camera setup
+    Camera2D camera = { 0 };
+    camera.target = state.playerPos;
+    camera.offset = (Vector2){ screenWidth / 2.0f, screenHeight / 2.0f };
+    camera.rotation = 0.0f;
+    camera.zoom = 1.0f;
+    state.targetZoom = 1.0f;
+    float minZoom = MinZoomForScreen(screenWidth, screenHeight);    // keeps the load rect in the cache
+
+    // --- Streamed world: chunks around the camera are generated on demand ---
+    static ChunkCache chunkCache;
+    static ChunkStreamer chunkStreamer;
+    static WorldOverlay worldOverlay;
+    static CollisionWorld collisionWorld;
+    InitCollisionWorld(&collisionWorld);
+    {
+        Rectangle solids[NUM_VILLAGE_BUILDINGS + 2];
+        VillageBuildingRects(solids);
+        GatePillarRects(&solids[NUM_VILLAGE_BUILDINGS]);
+        for (int i = 0; i < NUM_VILLAGE_BUILDINGS + 2; i++) AddCollider(&collisionWorld, solids[i]);
+    }
+    memset(&chunkCache, 0, sizeof(chunkCache));
+    for (int i = 0; i < 4; i++) {
+        chunkCache.seed = (chunkCache.seed << 16) | (unsigned long long)RngRange(&rng, 0, 0xFFFF);
+    }
+    chunkCache.rng.state = HashSeed(chunkCache.seed, 0x52455350u) | 1u;
+    chunkCache.overlay = &worldOverlay;
+    chunkCache.collision = &collisionWorld;
+    static PathFinder pathFinder;
+    Path route = { 0 };
+    static FlowFields flowFields;
+    static ScavengerCrowd scavengers;
+    InitFlowFields(&flowFields);
+    InitScavengers(&scavengers, NUM_SCAVENGERS, chunkCache.seed);
+    SimLod simLod = { 0 };
+    static JobSystem jobSystem;
+    InitJobSystem(&jobSystem);
+    StartChunkStreamer(&chunkStreamer, chunkCache.seed, &jobSystem);
+    Vector2 prevCameraTarget = camera.target;
+
+    // Wait for the chunks around the spawn point so the first frame is complete
+    WaitForChunks(&chunkCache, &chunkStreamer, camera, screenWidth, screenHeight);
 
-        // Draw spawn shimmers (above ground, below items)
-        DrawSpawnShimmers(spawnShimmers, NUM_SCAVENGE_ITEMS);
+    // Create floating particles (drift left-to-right at varying speeds)
+    // They live in a field around the camera and wrap inside it
+    Particle particles[NUM_PARTICLES];
+    for (int i = 0; i < NUM_PARTICLES; i++) {
+        particles[i].position = (Vector2){
+            state.playerPos.x + (float)RngRange(&rng, -PARTICLE_FIELD_HALF_W, PARTICLE_FIELD_HALF_W),
+            state.playerPos.y + (float)RngRange(&rng, -PARTICLE_FIELD_HALF_H, PARTICLE_FIELD_HALF_H)
+        };
+        // Primarily left-to-right drift, small vertical wander
+        float speed = (float)RngRange(&rng, 8, 25);
+        particles[i].velocity = (Vector2){
+            speed,
+            (float)RngRange(&rng, -4, 4)
+        };
+    }
 
-        // Draw world items
-        DrawWorldItems(worldItems, NUM_SCAVENGE_ITEMS, playerPos, camera, pulseTimer,
-                       shadowOffsetX, shadowOffsetY, isNight, &spr);
+    // Initialize city buildings (fix flickering bug - stored once, derived from the seed)
+    CityBuildings cityBuildings;
+    GenerateCityBuildings(&cityBuildings, chunkCache.seed);
+
+    // Minimap (M toggles). Chunks streamed in so far are already flagged dirty.
+    Minimap *minimap = sim->minimap;
+
+    // Autosave every AUTOSAVE_INTERVAL (F10 loads the newest); F3 shows its cost
+    static Autosaver autosaver;
+    InitAutosaver(&autosaver, &jobSystem);
+    bool perfOpen = false;
+    FrameCap frameCap = FRAME_CAP_DISPLAY;
+
+    // Incremental saves: F5 appends to the journal once a base exists
+    static StateJournal journal;
+    InitJournal(&journal);
+    chunkCache.journal = &journal;
+
+    // Per-tick history of the sim state; F7 scrubs back through it
+    static RewindBuffer rewind;
+    if (!InitRewind(&rewind)) LogMessage(LOG_WARNING, LOGCAT_SIM, "No memory for the rewind buffer");
+
+    // Deferrable work, in priority order, run in each frame's leftover budget
+    static FrameScheduler scheduler;
+    DeferredWorld deferredWorld = { &chunkCache, &chunkStreamer, &flowFields, minimap, sim->spr, state.playerPos };
+    InitFrameScheduler(&scheduler);
+    AddDeferredJob(&scheduler, "chunk finalize", DeferredFinalizeChunks, &deferredWorld);
+    AddDeferredJob(&scheduler, "respawn placement", DeferredPlaceRespawns, &deferredWorld);
+    AddDeferredJob(&scheduler, "flow fields", DeferredBuildFlowFields, &deferredWorld);
+    AddDeferredJob(&scheduler, "minimap uploads", DeferredUpdateMinimap, &deferredWorld);
+
+    // Inventory, workbench and trade (the UI screens see the snapshot copy)
+    UiModel *ui = &state.ui;
+    ui->workbenchState     = WB_CLOSED;
+    ui->repairSlot         = -1;
+    ui->sacrificeSlot      = -1;
+    ui->maxInventory       = 8;        // starts at 8, upgrades to 10
+    ui->baseRepairBonus    = 0.2f;     // starts at 0.2, upgrades to 0.25
+    ui->selectedTradeSlot  = -1;
 
-        // Draw village (contains workbench)
-        DrawVillage(pulseTimer, isNight, shadowOffsetX, shadowOffsetY, &spr);
+    // Pickup effect
+    PickupEffect pickupEffect = { 0 };
+    pickupEffect.active = false;
 
-        // Draw city gate
-        DrawCityGate(&cityBuildings, pulseTimer, isNight, spr.city_gate);
+    // Animation timers
+    float walkTimer   = 0.0f;   // increments when moving, used for walk bob
+    float breathTimer = 0.0f;   // always increments, used for idle breathing (3s cycle)
+    float pulseTimer  = 0.0f;   // always increments, used for workbench/gate pulses
 
-        // Draw particles (in world space)
-        DrawParticles(particles, NUM_PARTICLES);
+    // --- Day/night cycle ---
+    state.dayTimer = 45.0f;     // start at roughly "noon-ish"
+    float dayPhase = state.dayTimer / DAY_DURATION;
 
-        // Draw dust puffs (in world space, below Z)
-        DrawDustPuffs(dustPuffs, MAX_DUST_PUFFS);
+    // --- Directional facing ---
+    state.facing = (Vector2){ 0.0f, 1.0f };   // default facing down
+    Vector2 prevMovement = { 0.0f, 0.0f };
 
-        // Draw player (Z)
-        DrawZ(playerPos, walkTimer, breathTimer, facing, shadowOffsetX, shadowOffsetY, &spr);
+    // --- Footprints ---
+    Footprint footprints[MAX_FOOTPRINTS];
+    for (int i = 0; i < MAX_FOOTPRINTS; i++) footprints[i].active = false;
+    int footprintHead = 0;
+    Vector2 lastFootprintPos = state.playerPos;
 
-        // Draw pickup effect (in world space)
-        if (pickupEffect.active) {
-            DrawPickupEffect(&pickupEffect, camera);
-        }
+    // --- Dust puffs ---
+    DustPuff dustPuffs[MAX_DUST_PUFFS];
+    for (int i = 0; i < MAX_DUST_PUFFS; i++) dustPuffs[i].active = false;
+    int dustPuffHead = 0;
+    float dustTimer = 0.0f;
+    bool wasMoving = false;
 
-        // Heat shimmer at world edges
-        DrawHeatShimmer(camera, screenWidth, screenHeight, pulseTimer);
+    // --- Wind lines ---
+    WindLine windLines[MAX_WIND_LINES];
+    for (int i = 0; i < MAX_WIND_LINES; i++) windLines[i].active = false;
+    float windSpawnTimer = 0.0f;
+    float windSpawnInterval = (float)RngRange(&rng, 200, 800) / 100.0f;
 
-        EndMode2D();
+    // --- Sandstorm system ---
+    storm->state     = STORM_CALM;
+    storm->timer     = (float)RngRange(&rng, 6000, 12000) / 100.0f; // 60-120s until first storm
+    storm->speedMult = 1.0f;
 
-        // --- Day/night overlay ---
-        DrawDayNightOverlay(dayPhase, screenWidth, screenHeight);
+    // Sand glider (G): boost eases in, and eases back out whenever streaming
+    // reports missing chunks around the view, so the camera cannot outrun terrain
+    bool  gliderOn     = false;
+    float gliderBoost  = 0.0f;   // 0..1
+    int   chunksMissing = 0;
 
-        // Draw atmosphere overlay (screen space)
-        DrawAtmosphere(camera, screenWidth, screenHeight);
+    StormParticle stormParticles[MAX_STORM_PARTICLES];
+    for (int i = 0; i < MAX_STORM_PARTICLES; i++) {
+        stormParticles[i].x      = (float)RngRange(&rng, 0, screenWidth);
+        stormParticles[i].y      = (float)RngRange(&rng, 0, screenHeight);
+        stormParticles[i].speed  = (float)RngRange(&rng, 300, 700);
+        stormParticles[i].alpha  = (float)RngRange(&rng, 60, 120);
+        stormParticles[i].length = (float)RngRange(&rng, 20, 80);
+        stormParticles[i].size   = (float)RngRange(&rng, 10, 30) / 10.0f;
+    }
 
-        // Draw wind lines (screen space)
-        DrawWindLines(windLines, MAX_WIND_LINES);
+    // Per-tick phase inputs that never change; the rest is set each tick
+    FramePhases framePhases = {
+        .particles = particles, .stormParticles = stormParticles, .stormRng = &rng,
+        .footprints = footprints, .dustPuffs = dustPuffs,
+        .cache = &chunkCache, .lod = &simLod, .crowd = &scavengers, .flow = &flowFields,
+    };
+    static RenderList renderList;
+
+    // Sim loop: fixed tick rate, measured dt, snapshot published every tick
+    double tickPeriod = 1.0 / SIM_TICK_HZ;
+    double lastTick   = GetTime();
+    double nextTick   = lastTick;
+    static InputReader inputReader;
+    double lastInputTime = 0.0;     // newest press or click applied so far
+    double inputToSimMs  = 0.0;
+    int ticksSincePublish = 0;
+    while (!atomic_load(&sim->quit)) {
+        // Minimized window: nothing ticks (every game clock stops) and the
+        // cadence restarts on return, so no time is caught up in one step
+        PresentMode present = (PresentMode)atomic_load_explicit(&sim->present, memory_order_relaxed);
+        if (present == PRESENT_MINIMIZED) {
+            nanosleep(&(struct timespec){ 0, (long)(RENDER_MINIMIZED_POLL * 1e9) }, NULL);
+            lastTick = nextTick = GetTime();
+            continue;
+        }
 
-        // Draw storm overlay (screen space)
-        DrawStormOverlay(stormState, stormPhase, stormParticles, MAX_STORM_PARTICLES,
-                         screenWidth, screenHeight);
+        double tickStart = GetTime();
+        float deltaTime = fminf((float)(tickStart - lastTick), SIM_MAX_DT);
+        lastTick = tickStart;
+        BeginSchedulerFrame(&scheduler);
+        bool particlesDue = false;
+        InputFrame input = TakeInput(&inputReader, &sim->input);
+        // Window resized: the camera recenters, the minimum zoom follows the
+        // window so the load rect still fits the chunk cache, and the storm
+        // and wind fields (screen space) stretch once to the new size; they
+        // spawn inside screenWidth x screenHeight from here on
+        if (input.resize.x > 0.0f && input.resize.y > 0.0f) {
+            float sx = input.resize.x / screenWidth;
+            float sy = input.resize.y / screenHeight;
+            screenWidth   = (int)input.resize.x;
+            screenHeight  = (int)input.resize.y;
+            camera.offset = (Vector2){ screenWidth / 2.0f, screenHeight / 2.0f };
+            minZoom          = MinZoomForScreen(screenWidth, screenHeight);
+            state.targetZoom = fmaxf(state.targetZoom, minZoom);
+            camera.zoom      = fmaxf(camera.zoom, minZoom);
+            for (int i = 0; i < MAX_STORM_PARTICLES; i++) {
+                stormParticles[i].x *= sx;
+                stormParticles[i].y *= sy;
+            }
+            for (int i = 0; i < MAX_WIND_LINES; i++) windLines[i].y *= sy;
+        }
+        Camera2D tickCamera    = camera;           // drawn from these toward this tick's result
+        Vector2  tickPlayerPos = state.playerPos;
+        float    tickWalkTimer = walkTimer;
+        if (input.time > 0.0) {
+            inputToSimMs  = (tickStart - input.time) * 1000.0;
+            lastInputTime = fmax(lastInputTime, input.time);
+        }
+        RenderSnapshot *snap = BeginSnapshot(&sim->snapshots);
+
+        // --- Rewind scrubbing: F7 toggles, F8 jumps to the tick before the
+        // last hitch. The sim state steps through history while the rest of
+        // the world holds still (no time passes, no input gets through). ---
+        bool toHitch = InputPressed(&input, INPUT_REWIND_HITCH) && rewind.hitch >= 0;
+        if (InputPressed(&input, INPUT_REWIND) && rewind.scrubbing) {
+            float secondsBack = GetRewindStatus(&rewind).secondsBack;
+            ResumeFromRewind(&rewind, &state);
+            LogMessage(LOG_INFO, LOGCAT_SIM, "Resumed %.2f s back", (double)secondsBack);
+        } else if ((InputPressed(&input, INPUT_REWIND) || toHitch) && rewind.count > 0) {
+            rewind.scrubbing = true;
+            rewind.cursor    = rewind.count - 1;
+        }
+        if (rewind.scrubbing) {
+            if (toHitch) rewind.cursor = rewind.hitch > 0 ? rewind.hitch - 1 : 0;
+            if (InputDown(&input, INPUT_LEFT)) rewind.cursor--;
+            if (InputDown(&input, INPUT_RIGHT)) rewind.cursor++;
+            if (InputPressed(&input, INPUT_DOWN)) rewind.cursor -= SIM_TICK_HZ;
+            if (InputPressed(&input, INPUT_UP)) rewind.cursor += SIM_TICK_HZ;
+            if (rewind.cursor < 0) rewind.cursor = 0;
+            if (rewind.cursor > rewind.count - 1) rewind.cursor = rewind.count - 1;
+            RewindStateAt(&rewind, rewind.cursor, &state);
+            state.targetZoom = fmaxf(state.targetZoom, minZoom);
+            camera.target    = state.playerPos;
+            camera.zoom      = state.targetZoom;
+            prevCameraTarget = camera.target;
+            route.active     = false;
+            deltaTime = 0.0f;
+            input = (InputFrame){ .pressed = input.pressed & ((1u << INPUT_PERF) | (1u << INPUT_MINIMAP) |
+                                                              (1u << INPUT_FRAME_CAP)),
+                                  .mouse = input.mouse };
+        }
 
-        // Pickup flash (after EndMode2D, before EndDrawing)
-        if (pickupFlashTimer > 0.0f) {
-            float t = pickupFlashTimer / pickupFlashMax;
-            unsigned char flashA = (unsigned char)(t * 40.0f);
-            DrawRectangle(0, 0, screenWidth, screenHeight, (Color){ 255, 240, 200, flashA });
+        // Requests the UI screens made since the last tick (dropped while scrubbing)
+        UiCommand uiCommand;
+        bool tookInput = (input.time > 0.0);
+        while (PopCommand(&sim->commands, &uiCommand)) {
+            if (rewind.scrubbing) continue;
+            ApplyUiCommand(sim, ui, uiCommand);
+            lastInputTime = fmax(lastInputTime, uiCommand.time);
+            tookInput     = true;
         }
 
-        // Sun/moon indicator
-        DrawSunMoon(dayPhase, screenWidth);
+        // Always advance breath and pulse timers
+        breathTimer += deltaTime;
+        pulseTimer  += deltaTime;
 
-        // Storm "wind picking up" hint
-        if (stormState == STORM_BUILDING && stormMsgAlpha > 0.0f) {
-            unsigned char ma = (unsigned char)(stormMsgAlpha * 180.0f);
-            const char *stormMsg = "wind picking up...";
-            int smW = MeasureText(stormMsg, 16);
-            int smX = screenWidth / 2 - smW / 2;
-            DrawText(stormMsg, smX, 56, 16, (Color){ 212, 184, 150, ma });
-        }
+        // --- Day/night cycle ---
+        state.dayTimer += deltaTime;
+        if (state.dayTimer >= DAY_DURATION) state.dayTimer -= DAY_DURATION;
+        dayPhase = state.dayTimer / DAY_DURATION;
+        bool isNight = (dayPhase > 0.75f || dayPhase < 0.05f);
 
-        // HUD: pack count + token indicator
-        DrawHUD(inventory, screenWidth, maxInventory, tokenCount, tokenAnimTimer, tokenAnimDelta);
+        // Dynamic shadow offsets (rotate through the day)
+        float shadowOffsetX = cosf(dayPhase * 2.0f * PI) * 8.0f;
+        float shadowOffsetY = 6.0f;
+        if (isNight) { shadowOffsetX = 0.0f; shadowOffsetY = 0.0f; }
 
-        // Full inventory message
-        if (fullMsgTimer > 0.0f) {
-            float alpha = (fullMsgTimer > 0.3f) ? 1.0f : (fullMsgTimer / 0.3f);
-            unsigned char a  = (unsigned char)(alpha * 220);
-            const char *msg  = "Inventory full - return to workbench";
-            int msgW = MeasureText(msg, 20);
-            int msgX = screenWidth / 2 - msgW / 2;
-            int msgY = screenHeight - 80;
-            DrawRectangle(msgX - 12, msgY - 6, msgW + 24, 32, (Color){ 26, 26, 46, a });
-            DrawRectangleLines(msgX - 12, msgY - 6, msgW + 24, 32,
+        // Toggle inventory (only when workbench and trade screen are closed)
+        if (InputPressed(&input, INPUT_INVENTORY) && ui->workbenchState == WB_CLOSED && !ui->tradeScreenOpen) {
+            ui->inventoryOpen = !ui->inventoryOpen;
+        }
+        if (InputPressed(&input, INPUT_BACK) && ui->inventoryOpen) {
+            ui->inventoryOpen = false;
+        }
+        // Close trade screen on ESC (handled also in DrawTradeScreenUI, but catch here too)
+        if (InputPressed(&input, INPUT_BACK) && ui->tradeScreenOpen) {
+            ui->tradeScreenOpen    = false;
+            ui->selectedTradeSlot  = -1;
+        }
+
+        // Workbench repair timer (advance while repairing)
+        if (ui->workbenchState == WB_REPAIRING) {
+            ui->repairTimer += deltaTime;
+            if (ui->repairTimer >= 2.0f) {
+                // Repair complete
+                if (ui->repairSlot >= 0 && ui->repairSlot < ui->maxInventory &&
+                    ui->inventory[ui->repairSlot].occupied) {
+                    // Apply bonus using baseRepairBonus (a matching category adds the type's repair bonus)
+                    InventorySlot *rep = &ui->inventory[ui->repairSlot];
+                    const ItemTypeDef *repDef = &itemTable.types[rep->typeIndex];
+                    int repCat = repDef->category;
+                    int sacCat = itemTable.types[ui->inventory[ui->sacrificeSlot].typeIndex].category;
+                    float bonus = (repCat == sacCat) ? (ui->baseRepairBonus + repDef->repairBonus) : ui->baseRepairBonus;
+                    rep->condition += bonus;
+                    if (rep->condition > 1.0f) rep->condition = 1.0f;
+                    EmitEvent(sim, (GameEvent){ .type = EVENT_REPAIR_COMPLETED,
+                                                .repair = { rep->typeIndex, rep->condition, repCat == sacCat } });
+                }
+                // Destroy sacrifice
+                if (ui->sacrificeSlot >= 0 && ui->sacrificeSlot < ui->maxInventory) {
+                    ui->inventory[ui->sacrificeSlot].occupied = false;
+                    ui->inventory[ui->sacrificeSlot].condition = 0.0f;
+                }
+                ui->repairSlot    = -1;
+                ui->sacrificeSlot = -1;
+                ui->repairDone    = true;
+                ui->workbenchState = WB_OPEN;
+            }
+        }
+
+        // --- Sandstorm state machine ---
+        storm->timer -= deltaTime;
+        StormState prevStormState = storm->state;
+        if (storm->state == STORM_CALM && storm->timer <= 0.0f) {
+            storm->state    = STORM_BUILDING;
+            storm->duration = 5.0f;
+            storm->timer    = storm->duration;
+            storm->phase    = 0.0f;
+        } else if (storm->state == STORM_BUILDING) {
+            storm->phase = 1.0f - (storm->timer / storm->duration);
+            storm->msgAlpha = storm->phase;
+            if (storm->timer <= 0.0f) {
+                storm->state    = STORM_ACTIVE;
+                storm->duration = (float)RngRange(&rng, 2000, 3000) / 100.0f;
+                storm->timer    = storm->duration;
+                storm->phase    = 0.0f;
+                storm->speedMult = 0.7f;
+            }
+        } else if (storm->state == STORM_ACTIVE) {
+            storm->phase = storm->timer / storm->duration;
+            storm->msgAlpha = 0.0f;
+            if (storm->timer <= 0.0f) {
+                storm->state    = STORM_FADING;
+                storm->duration = 5.0f;
+                storm->timer    = storm->duration;
+                storm->phase    = 0.0f;
+            }
+        } else if (storm->state == STORM_FADING) {
+            storm->phase = storm->timer / storm->duration;
+            storm->speedMult = 0.7f + (1.0f - storm->phase) * 0.3f;
+            if (storm->timer <= 0.0f) {
+                storm->state    = STORM_CALM;
+                storm->timer    = (float)RngRange(&rng, 6000, 12000) / 100.0f;
+                storm->phase    = 0.0f;
+                storm->speedMult = 1.0f;
+                storm->msgAlpha  = 0.0f;
+            }
+        }
+        if (storm->state != prevStormState) {
+            EmitEvent(sim, (GameEvent){ .type = EVENT_STORM_STATE_CHANGED,
+                                        .storm = { prevStormState, storm->state } });
+        }
+
+        if (!ui->inventoryOpen && ui->workbenchState == WB_CLOSED && !ui->tradeScreenOpen && !ui->dataLogViewerOpen) {
+            // Player movement with WASD
+            Vector2 movement = { 0 };
+            if (InputDown(&input, INPUT_UP)) movement.y -= 1;
+            if (InputDown(&input, INPUT_DOWN)) movement.y += 1;
+            if (InputDown(&input, INPUT_LEFT)) movement.x -= 1;
+            if (InputDown(&input, INPUT_RIGHT)) movement.x += 1;
+
+            // Click-to-move (not through the minimap), H: home to the
+            // workbench, C: walk to the city gate. Any WASD input takes over.
+            Vector2 mouse = input.mouse;
+            bool overMinimap = minimap->open &&
+                               CheckCollisionPointRec(mouse, MinimapRect(screenWidth, screenHeight));
+            if (input.clicked && !overMinimap) {
+                PlanPath(&route, &pathFinder, &chunkCache, state.playerPos, GetScreenToWorld2D(mouse, camera));
+            }
+            if (InputPressed(&input, INPUT_HOME)) {
+                PlanPath(&route, &pathFinder, &chunkCache, state.playerPos, (Vector2){ WORKBENCH_X, WORKBENCH_Y });
+            }
+            if (InputPressed(&input, INPUT_GATE)) {
+                PlanPath(&route, &pathFinder, &chunkCache, state.playerPos, (Vector2){ GATE_X, GATE_Y });
+            }
+            if (movement.x != 0 || movement.y != 0) {
+                route.active = false;
+            } else if (route.active) {
+                float stepLen = PLAYER_SPEED * storm->speedMult *
+                                (1.0f + (GLIDER_SPEED_MULT - 1.0f) * gliderBoost) * deltaTime;
+                FollowPath(&route, &pathFinder, &collisionWorld, state.playerPos, stepLen, &movement);
+            }
+
+            bool isMoving = (movement.x != 0 || movement.y != 0);
+
+            // Normalize diagonal movement
+            if (isMoving) {
+                float length = sqrtf(movement.x * movement.x + movement.y * movement.y);
+                movement.x /= length;
+                movement.y /= length;
+                walkTimer += deltaTime * 6.0f;  // speed_factor = 6 -> ~1Hz bob at normal speed
+
+                // Track facing direction
+                state.facing.x = movement.x;
+                state.facing.y = movement.y;
+
+                // Dust puffs: on start of movement or direction change
+                // (a tolerance, so path steering's small corrections don't count)
+                bool dirChanged = Vector2DotProduct(movement, prevMovement) < 0.99f;
+                if (!wasMoving || dirChanged) {
+                    // Spawn a bigger dust puff
+                    DustPuff *dp = &dustPuffs[dustPuffHead % MAX_DUST_PUFFS];
+                    dp->position = state.playerPos;
+                    dp->timer    = 0.4f;
+                    dp->maxTimer = 0.4f;
+                    dp->radius   = 12.0f;
+                    dp->active   = true;
+                    dustPuffHead++;
+                }
+
+                // Continuous small dust puffs while moving
+                dustTimer += deltaTime;
+                if (dustTimer >= 0.15f) {
+                    dustTimer = fmodf(dustTimer, 0.15f);
+                    DustPuff *dp = &dustPuffs[dustPuffHead % MAX_DUST_PUFFS];
+                    dp->position = state.playerPos;
+                    dp->timer    = 0.3f;
+                    dp->maxTimer = 0.3f;
+                    dp->radius   = 6.0f;
+                    dp->active   = true;
+                    dustPuffHead++;
+                }
+
+                // Footprints: when moved more than 15px from last footprint
+                float distFromLast = Vector2Distance(state.playerPos, lastFootprintPos);
+                if (distFromLast >= 15.0f) {
+                    Footprint *fp = &footprints[footprintHead % MAX_FOOTPRINTS];
+                    fp->position = state.playerPos;
+                    fp->alpha    = 120.0f;
+                    fp->timer    = 4.0f;
+                    fp->active   = true;
+                    footprintHead++;
+                    lastFootprintPos = state.playerPos;
+                }
+            } else {
+                dustTimer = 0.0f;
+            }
+
+            wasMoving     = isMoving;
+            prevMovement  = movement;
+
+            // Glider boost
+            if (InputPressed(&input, INPUT_GLIDER)) gliderOn = !gliderOn;
+            if (gliderOn && chunksMissing == 0) {
+                gliderBoost = fminf(1.0f, gliderBoost + GLIDER_ACCEL * deltaTime);
+            } else {
+                gliderBoost = fmaxf(0.0f, gliderBoost - GLIDER_BRAKE * deltaTime);
+            }
+
+            // Apply movement (with storm speed multiplier and glider boost)
+            float effectiveSpeed = PLAYER_SPEED * storm->speedMult *
+                                   (1.0f + (GLIDER_SPEED_MULT - 1.0f) * gliderBoost);
+            state.playerPos = MoveCircle(&collisionWorld, state.playerPos,
+                                   Vector2Scale(movement, effectiveSpeed * deltaTime), PLAYER_RADIUS);
+
+            // Smooth camera follow
+            camera.target = Vector2Lerp(camera.target, state.playerPos, 1.0f - expf(-CAMERA_FOLLOW * deltaTime));
+
+            // Particles follow the camera; updated with the other phases below
+            particlesDue = true;
+
+            // Pickup effect timer
+            if (pickupEffect.active) {
+                pickupEffect.timer -= deltaTime;
+                if (pickupEffect.timer <= 0.0f) {
+                    pickupEffect.active = false;
+                }
+            }
+
+            // E key: check gate proximity, workbench proximity, then item pickup
+            if (InputPressed(&input, INPUT_INTERACT)) {
+                // Check gate proximity (70px)
+                Vector2 gatePos = { GATE_X, GATE_Y };
+                float gateDist  = Vector2Distance(state.playerPos, gatePos);
+                // Check workbench proximity (60px)
+                Vector2 wbPos = { WORKBENCH_X, WORKBENCH_Y };
+                float wbDist  = Vector2Distance(state.playerPos, wbPos);
+                // Items within pickup range can only live in the player's chunk or a neighbour
+                int pcx = WorldToChunk(state.playerPos.x);
+                int pcy = WorldToChunk(state.playerPos.y);
+                bool nearItem = false;
+                for (int c = 0; c < MAX_LOADED_CHUNKS && !nearItem; c++) {
+                    Chunk *ch = &chunkCache.chunks[c];
+                    if (!ch->loaded || abs(ch->cx - pcx) > 1 || abs(ch->cy - pcy) > 1) continue;
+                    for (int i = 0; i < ch->numItems; i++) {
+                        if (!ch->items[i].active) continue;
+                        if (Vector2Distance(state.playerPos, ch->items[i].position) <= PICKUP_RADIUS) {
+                            nearItem = true;
+                            break;
+                        }
+                    }
+                }
+                // Gate takes priority if near enough and no workbench open
+                if (!nearItem && gateDist <= GATE_INTERACT_RADIUS && ui->workbenchState == WB_CLOSED) {
+                    ui->tradeScreenOpen   = true;
+                    ui->selectedTradeSlot = -1;
+                } else if (!nearItem && wbDist <= 60.0f && ui->workbenchState == WB_CLOSED) {
+                    // Open workbench
+                    ui->workbenchState = WB_OPEN;
+                    ui->repairSlot     = -1;
+                    ui->sacrificeSlot  = -1;
+                    ui->repairDone     = false;
+                } else {
+                    // Normal item pickup
+                    bool pickedUp = false;
+                    for (int c = 0; c < MAX_LOADED_CHUNKS && !pickedUp; c++) {
+                        Chunk *ch = &chunkCache.chunks[c];
+                        if (!ch->loaded || abs(ch->cx - pcx) > 1 || abs(ch->cy - pcy) > 1) continue;
+                        for (int i = 0; i < ch->numItems; i++) {
+                            WorldItem *item = &ch->items[i];
+                            if (!item->active) continue;
+                            float dist = Vector2Distance(state.playerPos, item->position);
+                            if (dist <= PICKUP_RADIUS) {
+                                int invCount = CountInventory(ui->inventory, ui->maxInventory);
+                                if (invCount < ui->maxInventory) {
+                                    AddToInventory(ui->inventory, item->typeIndex,
+                                                   item->condition, ui->maxInventory);
+                                    item->active = false;
+                                    item->respawnTimer = 60.0f + (float)RngRange(&rng, 0, 30);
+                                    ch->modifiedMask |= (unsigned char)(1u << i);
+                                    ch->journalMask  |= (unsigned char)(1u << i);
+                                    ch->minimapDirty  = true;
+                                    pickupEffect.position = item->position;
+                                    pickupEffect.timer    = PICKUP_EFFECT_DURATION;
+                                    pickupEffect.active   = true;
+                                    EmitEvent(sim, (GameEvent){ .type = EVENT_ITEM_PICKED_UP,
+                                                                .pickup = { item->typeIndex, item->condition,
+                                                                            item->position } });
+                                } else {
+                                    EmitEvent(sim, (GameEvent){ .type = EVENT_INVENTORY_FULL });
+                                }
+                                pickedUp = true;
+                                break; // only pick up one item per press
+                            }
+                        }
+                    }
+                    // If near workbench and no item, open it
+                    if (!nearItem && wbDist <= 60.0f && ui->workbenchState == WB_CLOSED) {
+                        ui->workbenchState = WB_OPEN;
+                        ui->repairSlot     = -1;
+                        ui->sacrificeSlot  = -1;
+                        ui->repairDone     = false;
+                    }
+                }
+            }
+        }
+
+        bool uiBlocking = ui->inventoryOpen || ui->workbenchState != WB_CLOSED ||
+                          ui->tradeScreenOpen || ui->dataLogViewerOpen;
+        snap->ui = *ui;
+
+        // --- Sim LOD: advance the clock and centre the rings on the view ---
+        simLod.tick++;
+        simLod.clock += deltaTime;
+        simLod.view   = CameraView(camera, screenWidth, screenHeight);
+
+        // --- Flag stale flow fields (rebuilt as deferred work) ---
+        UpdateFlowFields(&flowFields, &chunkCache, deltaTime);
+
+        // --- Parallel update phases: particles, effect pools, item timers, scavengers ---
+        framePhases.dt                 = deltaTime;
+        framePhases.particleCenter     = camera.target;
+        framePhases.particleFieldScale = 1.0f / camera.zoom;
+        framePhases.screenWidth        = screenWidth;
+        framePhases.screenHeight       = screenHeight;
+        RunUpdatePhases(&jobSystem, &framePhases, particlesDue,
+                        storm->state == STORM_ACTIVE || storm->state == STORM_BUILDING ||
+                        storm->state == STORM_FADING);
+
+        // --- Update wind lines ---
+        windSpawnTimer += deltaTime;
+        // During storm building: double spawn frequency
+        float effectiveWindInterval = windSpawnInterval;
+        if (storm->state == STORM_BUILDING || storm->state == STORM_ACTIVE) {
+            effectiveWindInterval *= 0.5f;
+        }
+        if (windSpawnTimer >= effectiveWindInterval) {
+            windSpawnTimer = 0.0f;
+            windSpawnInterval = (float)RngRange(&rng, 200, 800) / 100.0f;
+            // Find inactive slot
+            for (int i = 0; i < MAX_WIND_LINES; i++) {
+                if (!windLines[i].active) {
+                    windLines[i].y      = (float)RngRange(&rng, 0, screenHeight);
+                    windLines[i].x      = (float)screenWidth + 10.0f;
+                    windLines[i].speed  = (float)RngRange(&rng, 400, 800);
+                    windLines[i].alpha  = 60.0f;
+                    windLines[i].length = (float)RngRange(&rng, 60, 200);
+                    windLines[i].active = true;
+                    break;
+                }
+            }
+        }
+        for (int i = 0; i < MAX_WIND_LINES; i++) {
+            if (!windLines[i].active) continue;
+            windLines[i].x -= windLines[i].speed * deltaTime;
+            // Fade alpha based on horizontal position
+            float progress = 1.0f - ((windLines[i].x + windLines[i].length) / (float)(screenWidth + windLines[i].length + 10));
+            windLines[i].alpha = 60.0f * (1.0f - progress);
+            if (windLines[i].x + windLines[i].length < 0) {
+                windLines[i].active = false;
+            }
+        }
+
+        if (InputPressed(&input, INPUT_MINIMAP)) minimap->open = !minimap->open;
+        if (InputPressed(&input, INPUT_PERF)) perfOpen = !perfOpen;
+        if (InputPressed(&input, INPUT_FRAME_CAP)) frameCap = (frameCap + 1) % FRAME_CAP_COUNT;
+
+        // --- Game save / load (F5 / F9) ---
+        // A save appends the changes since the last flush to the journal; the
+        // full base is only rewritten when there is none yet or it grew large
+        if (InputPressed(&input, INPUT_SAVE)) {
+            double saveStart = GetTime();
+            if (journal.attached && journal.fileSize <= JOURNAL_COMPACT_BYTES &&
+                FlushJournal(&journal, &chunkCache, &state)) {
+                LogMessage(LOG_INFO, LOGCAT_WORLD, "Game saved to %s (%.2f ms, journal %lld bytes)",
+                           JOURNAL_PATH, (GetTime() - saveStart) * 1000.0, journal.fileSize);
+            } else if (CompactJournal(&journal, &state, &chunkCache)) {
+                LogMessage(LOG_INFO, LOGCAT_WORLD, "Game saved to %s (%.2f ms)",
+                           GAME_SAVE_PATH, (GetTime() - saveStart) * 1000.0);
+            } else {
+                LogMessage(LOG_ERROR, LOGCAT_WORLD, "Saving %s failed", GAME_SAVE_PATH);
+            }
+        }
+        bool loadAutosave = InputPressed(&input, INPUT_LOAD_AUTOSAVE);
+        if (InputPressed(&input, INPUT_LOAD) || loadAutosave) {
+            double loadStart = GetTime();
+            SimState loadedState;
+            unsigned long long loadedSeed;
+            WorldOverlay loadedOverlay = { 0 };
+            int autosaveSlot = -1;
+            unsigned int journalId = 0;
+            long long journalSize = 0;
+            int replayed = 0;
+            bool loaded = loadAutosave ?
+                (autosaveSlot = LoadNewestAutosave(&loadedState, &loadedSeed, &loadedOverlay)) >= 0 :
+                LoadGame(GAME_SAVE_PATH, &loadedState, &loadedSeed, &loadedOverlay, &journalId);
+            if (loaded && !loadAutosave) {
+                replayed = ReplayJournal(JOURNAL_PATH, journalId, &loadedState, &loadedOverlay, &journalSize);
+            }
+            if (loaded) {
+                double loadMs = (GetTime() - loadStart) * 1000.0;
+
+                // Progress, clocks and storm come back as saved; open screens
+                // and a repair in progress do not
+                state = loadedState;
+                ui->workbenchState    = WB_CLOSED;
+                ui->repairSlot        = -1;
+                ui->sacrificeSlot     = -1;
+                ui->repairTimer       = 0.0f;
+                ui->tradeScreenOpen   = false;
+                ui->selectedTradeSlot = -1;
+                ui->dataLogViewerOpen = false;
+                ui->inventoryOpen     = false;
+                state.targetZoom = fmaxf(state.targetZoom, minZoom);
+                camera.target    = state.playerPos;
+                camera.zoom      = state.targetZoom;
+                prevCameraTarget = camera.target;
+                lastFootprintPos = state.playerPos;
+
+                // Restart streaming on the loaded seed; every chunk regenerates
+                // and picks its diff back up from the overlay on install
+                StopChunkStreamer(&chunkStreamer);
+                FreeWorldOverlay(&worldOverlay);
+                worldOverlay = loadedOverlay;
+                ClearChunkCache(&chunkCache);
+                route.active = false;
+                chunkCache.seed = loadedSeed;
+                chunkCache.rng.state = HashSeed(chunkCache.seed, 0x52455350u) | 1u;
+                StartChunkStreamer(&chunkStreamer, chunkCache.seed, &jobSystem);
+                GenerateCityBuildings(&cityBuildings, chunkCache.seed);
+                ClearMinimap(minimap);
+                WaitForChunks(&chunkCache, &chunkStreamer, camera, screenWidth, screenHeight);
+
+                // Later saves extend the loaded base's journal; an autosave has
+                // none, so the journal stays detached until the next F5
+                AttachJournal(&journal, journalId, journalSize, &state);
+                ResetRewind(&rewind);
+                if (loadAutosave) {
+                    LogMessage(LOG_INFO, LOGCAT_WORLD, "Autosave slot %d loaded in %.2f ms (seed %llx, %d changed chunks)",
+                               autosaveSlot, loadMs, loadedSeed, worldOverlay.count);
+                } else {
+                    LogMessage(LOG_INFO, LOGCAT_WORLD, "Game loaded from %s in %.2f ms (seed %llx, %d changed chunks, %d journal records)",
+                               GAME_SAVE_PATH, loadMs, loadedSeed, worldOverlay.count, replayed > 0 ? replayed : 0);
+                }
+            } else if (loadAutosave) {
+                LogMessage(LOG_WARNING, LOGCAT_WORLD, "No valid autosave to load");
+            } else {
+                LogMessage(LOG_WARNING, LOGCAT_WORLD, "No valid save loaded from %s", GAME_SAVE_PATH);
+            }
+        }
+
+        // --- Autosave: a snapshot copy here, the write on a pool worker ---
+        UpdateAutosave(&autosaver, &state, &chunkCache, deltaTime);
+
+        // --- State journal: append what changed every JOURNAL_FLUSH_INTERVAL ---
+        journal.flushTimer -= deltaTime;
+        if (journal.attached && journal.flushTimer <= 0.0f) {
+            if (!FlushJournal(&journal, &chunkCache, &state)) {
+                LogMessage(LOG_WARNING, LOGCAT_WORLD, "Appending to %s failed", JOURNAL_PATH);
+            } else if (journal.fileSize > JOURNAL_COMPACT_BYTES) {
+                double compactStart = GetTime();
+                if (CompactJournal(&journal, &state, &chunkCache)) {
+                    LogMessage(LOG_INFO, LOGCAT_WORLD, "Journal compacted into %s (%.2f ms)",
+                               GAME_SAVE_PATH, (GetTime() - compactStart) * 1000.0);
+                }
+            }
+        }
+
+        // --- Zoom (mouse wheel), eased in log space so steps feel even ---
+        if (!uiBlocking) {
+            float wheel = input.wheel;
+            if (wheel != 0.0f) {
+                state.targetZoom = Clamp(state.targetZoom * expf(wheel * ZOOM_WHEEL_STEP), minZoom, ZOOM_MAX);
+            }
+        }
+        if (camera.zoom != state.targetZoom) {
+            float k = 1.0f - expf(-ZOOM_SMOOTHING * deltaTime);
+            camera.zoom = expf(Lerp(logf(camera.zoom), logf(state.targetZoom), k));
+            if (fabsf(camera.zoom - state.targetZoom) < 0.0005f) camera.zoom = state.targetZoom;
+        }
+
+        // --- Stream world chunks around the camera ---
+        Vector2 cameraVelocity = { 0 };
+        if (deltaTime > 0.0f) {
+            cameraVelocity = Vector2Scale(Vector2Subtract(camera.target, prevCameraTarget),
+                                          1.0f / deltaTime);
+        }
+        prevCameraTarget = camera.target;
+        chunksMissing = UpdateChunkStreaming(&chunkCache, &chunkStreamer, camera, cameraVelocity,
+                                             screenWidth, screenHeight);
+
+        // --- Deferrable work in this tick's slack ---
+        deferredWorld.playerPos = state.playerPos;
+        RunDeferredJobs(&scheduler);
+
+        // While the render thread is throttled it draws at most every
+        // SIM_THROTTLED_PUBLISH ticks; input still gets an answer next tick
+        bool publish = (present == PRESENT_ACTIVE) || tookInput || ++ticksSincePublish >= SIM_THROTTLED_PUBLISH;
+
+        // --- Cull what is in view (chunks, scavengers) ---
+        Rectangle view = CameraView(camera, screenWidth, screenHeight);
+        if (publish) BuildRenderList(&renderList, &jobSystem, &chunkCache, &scavengers, view);
+
+        // --- Rewind history: this tick's state, delta-encoded ---
+        if (!rewind.scrubbing) RecordRewind(&rewind, &state, (float)((GetTime() - tickStart) * 1000.0));
+
+        // --- Publish what the render thread draws ---
+        if (publish) {
+            snap->valid          = true;
+            snap->camera         = camera;
+            snap->playerPos      = state.playerPos;
+            snap->facing         = state.facing;
+            snap->walkTimer      = walkTimer;
+            snap->breathTimer    = breathTimer;
+            snap->pulseTimer     = pulseTimer;
+            snap->dayPhase       = dayPhase;
+            snap->isNight        = isNight;
+            snap->shadowOffsetX  = shadowOffsetX;
+            snap->shadowOffsetY  = shadowOffsetY;
+            snap->stormState     = storm->state;
+            snap->stormPhase     = storm->phase;
+            snap->stormMsgAlpha  = storm->msgAlpha;
+            snap->pickupEffect   = pickupEffect;
+            snap->route          = route;
+            snap->cityBuildings  = cityBuildings;
+            snap->gliderOn       = gliderOn;
+            snap->chunksMissing  = chunksMissing;
+            snap->minimapOpen    = minimap->open;
+            snap->perfOpen       = perfOpen;
+            snap->frameCap       = frameCap;
+            snap->tickTime       = tickStart;
+            bool jumped = Vector2Distance(tickPlayerPos, state.playerPos) > RENDER_SNAP_DIST ||
+                          Vector2Distance(tickCamera.target, camera.target) > RENDER_SNAP_DIST;
+            snap->prevCamera     = jumped ? camera : tickCamera;
+            snap->prevPlayerPos  = jumped ? state.playerPos : tickPlayerPos;
+            snap->prevWalkTimer  = jumped ? walkTimer : tickWalkTimer;
+            snap->perf = (PerfStats){
+                .tickMs = scheduler.workMs, .deferredMs = scheduler.spentMs,
+                .autosaveCopyUs = autosaver.copyUs, .autosave = autosaver.last,
+                .autosaveBusy = autosaver.pending, .autosaveFailures = autosaver.failures,
+                .rewindFrames = rewind.count, .rewindBytes = RewindBytes(&rewind),
+                .rewindRecordUs = rewind.recordUs, .inputToSimMs = inputToSimMs,
+            };
+            snap->inputTime = lastInputTime;
+            snap->rewind = GetRewindStatus(&rewind);
+            memcpy(snap->stormParticles, stormParticles, sizeof(stormParticles));
+            memcpy(snap->windLines, windLines, sizeof(windLines));
+            memcpy(snap->footprints, footprints, sizeof(footprints));
+            memcpy(snap->dustPuffs, dustPuffs, sizeof(dustPuffs));
+            memcpy(snap->particles, particles, sizeof(particles));
+            snap->numChunks = renderList.numChunks;
+            for (int k = 0; k < renderList.numChunks; k++) {
+                snap->chunks[k] = chunkCache.chunks[renderList.chunks[k]];
+            }
+            snap->numScavengers = renderList.numScavengers;
+            for (int k = 0; k < renderList.numScavengers; k++) {
+                int i = renderList.scavengers[k];
+                snap->scavengers[k] = (ScavengerSprite){ scavengers.x[i], scavengers.y[i], scavengers.cargo[i] };
+            }
+            PublishSnapshot(&sim->snapshots);
+            ticksSincePublish = 0;
+        }
+        EndSchedulerFrame(&scheduler);
+
+        // Sleep to the next tick; after a long stall, restart the cadence
+        nextTick += tickPeriod;
+        double now = GetTime();
+        if (nextTick < now) nextTick = now;
+        else nanosleep(&(struct timespec){ 0, (long)((nextTick - now) * 1e9) }, NULL);
+    }
+
+    StopAutosaver(&autosaver);
+    FlushJournal(&journal, &chunkCache, &state);
+    CloseJournal(&journal);
+    FreeRewind(&rewind);
+    StopChunkStreamer(&chunkStreamer);
+    ShutdownJobSystem(&jobSystem);
+    FreeWorldOverlay(&worldOverlay);
+    return NULL;
+}
+
+// Start the sim thread and wait for its first snapshot (the spawn area is
+// streamed in before that), so the first rendered frame is complete
+void StartSimThread(SimThread *sim, Minimap *minimap, Sprites *spr, int screenWidth, int screenHeight)
+{
+    InitSnapshotBuffer(&sim->snapshots);
+    InitInputQueue(&sim->input);
+    InitCommandQueue(&sim->commands);
+    InitEventQueue(&sim->uiEvents);
+    InitEventQueue(&sim->telemetry);
+    sim->minimap      = minimap;
+    sim->spr          = spr;
+    sim->screenWidth  = screenWidth;
+    sim->screenHeight = screenHeight;
+    atomic_init(&sim->quit, false);
+    atomic_init(&sim->present, PRESENT_ACTIVE);
+    pthread_create(&sim->thread, NULL, SimMain, sim);
+    while (!(atomic_load(&sim->snapshots.middle) & SNAPSHOT_FRESH)) {
+        nanosleep(&(struct timespec){ 0, 1000000 }, NULL);
+    }
+}
+
+void StopSimThread(SimThread *sim)
+{
+    atomic_store(&sim->quit, true);
+    pthread_join(sim->thread, NULL);
+    if (sim->uiEvents.dropped > 0 || sim->telemetry.dropped > 0) {
+        LogMessage(LOG_WARNING, LOGCAT_SIM, "Event queues dropped %u UI / %u telemetry events",
+                   sim->uiEvents.dropped, sim->telemetry.dropped);
+    }
+    if (sim->input.dropped > 0) {
+        LogMessage(LOG_WARNING, LOGCAT_SIM, "Input queue dropped %u events", sim->input.dropped);
+    }
+}
+
+int main(void)
+{
+    int screenWidth = 1280;             // screen units; follow the window (see the resize check)
+    int screenHeight = 720;
+
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE | FLAG_WINDOW_HIGHDPI);
+    InitWindow(screenWidth, screenHeight, "Above the Clouds");
+    SetWindowMinSize(WINDOW_MIN_WIDTH, WINDOW_MIN_HEIGHT);
+    InitLogger(stdout, LOG_INFO);
+    SetTargetFPS(0);    // paced by WaitForNextFrame, which samples input while it waits
+
+    // --- Load all sprites ---
+    Sprites spr = { 0 };
+    spr.z_down    = LoadTexture("assets/sprites/z_down.png");
+    spr.z_up      = LoadTexture("assets/sprites/z_up.png");
+    spr.z_left    = LoadTexture("assets/sprites/z_left.png");
+    spr.z_right   = LoadTexture("assets/sprites/z_right.png");
+    spr.building[0] = LoadTexture("assets/sprites/building_1.png");
+    spr.building[1] = LoadTexture("assets/sprites/building_2.png");
+    spr.building[2] = LoadTexture("assets/sprites/building_3.png");
+    spr.building[3] = LoadTexture("assets/sprites/building_4.png");
+    spr.building[4] = LoadTexture("assets/sprites/building_5.png");
+    LoadItemTable(&itemTable, ITEM_DEFS_PATH);     // before the sim and chunk workers start
+    spr.itemAtlas = BuildItemAtlas(&itemTable);
+    spr.ground[0] = LoadTexture("assets/sprites/ground_1.png");
+    spr.ground[1] = LoadTexture("assets/sprites/ground_2.png");
+    spr.ground[2] = LoadTexture("assets/sprites/ground_3.png");
+    SetTextureFilter(spr.ground[0], TEXTURE_FILTER_BILINEAR);
+    SetTextureFilter(spr.ground[1], TEXTURE_FILTER_BILINEAR);
+    SetTextureFilter(spr.ground[2], TEXTURE_FILTER_BILINEAR);
+    for (int i = 0; i < 3; i++) {
+        spr.groundAvg[i] = GroundAverageColor(TextFormat("assets/sprites/ground_%d.png", i + 1));
+    }
+    spr.dune[0]   = LoadTexture("assets/sprites/dune_1.png");
+    spr.dune[1]   = LoadTexture("assets/sprites/dune_2.png");
+    spr.dune[2]   = LoadTexture("assets/sprites/dune_3.png");
+    spr.debris1   = LoadTexture("assets/sprites/debris_1.png");
+    spr.city_gate = LoadTexture("assets/sprites/city_gate.png");
+    SetTextureFilter(spr.city_gate, TEXTURE_FILTER_BILINEAR);
+
+    // Render-only background
+    ParallaxDune parallaxDunes[NUM_PARALLAX_DUNES];
+    for (int i = 0; i < NUM_PARALLAX_DUNES; i++) {
+        parallaxDunes[i].x              = (float)GetRandomValue(-200, screenWidth);
+        parallaxDunes[i].y              = (float)GetRandomValue(20, 120);
+        parallaxDunes[i].width          = (float)GetRandomValue(300, 600);
+        parallaxDunes[i].height         = (float)GetRandomValue(30, 70);
+        parallaxDunes[i].topLeftOffsetX  = (float)GetRandomValue(40, 100);
+        parallaxDunes[i].topRightOffsetX = (float)GetRandomValue(40, 100);
+    }
+
+    // Minimap texture (blocks arrive from the sim thread)
+    static Minimap minimap;
+    InitMinimap(&minimap);
+
+    // The sim runs on its own thread; this one polls input, uploads minimap
+    // blocks and draws the newest snapshot
+    static SimThread sim;
+    StartSimThread(&sim, &minimap, &spr, screenWidth, screenHeight);
+    UiFeedback feedback = { .tokenAnimDelta = 1, .pickupFlashMax = 0.2f };
+    GameStats stats = { 0 };
+    static InputSampler sampler;
+    InputLatency latency = { 0 };
+    FramePacing pacing = { 0 };
+    FrameCap frameCap = FRAME_CAP_DISPLAY;
+    int targetHz = FrameCapHz(frameCap);
+    PresentMode present = PRESENT_ACTIVE;
+    UiLayouts layouts = { 0 };
+    int frameHz = targetHz;             // targetHz, or lower while throttled
+    bool resizePending = false;         // the sim has not been sent the current size yet
+    double nextFrame = GetTime();
+
+    while (!WindowShouldClose()) {
+        // Minimized: draw nothing and only poll until the window is back
+        if (present == PRESENT_MINIMIZED) {
+            WaitForNextFrame(&sampler, &sim.input, GetTime() + RENDER_MINIMIZED_POLL, present);
+            if (IsWindowMinimized()) continue;
+            present = PRESENT_ACTIVE;
+            atomic_store(&sim.present, present);
+            LogMessage(LOG_INFO, LOGCAT_GAME, "Window restored: sim resumed");
+            frameHz   = targetHz;
+            nextFrame = GetTime();
+            pacing.lastFrame = 0.0;     // the gap is not a pacing sample
+        }
+        nextFrame = PaceFrame(&pacing, nextFrame, frameHz);
+
+        // Window resized: everything sized from the screen is recomputed here,
+        // once. The sim gets the new size in order with the input; if the
+        // input queue is full it is retried every frame until it gets through.
+        if (GetScreenWidth() != screenWidth || GetScreenHeight() != screenHeight) {
+            float sx = (float)GetScreenWidth() / screenWidth;
+            for (int i = 0; i < NUM_PARALLAX_DUNES; i++) parallaxDunes[i].x *= sx;
+            screenWidth   = GetScreenWidth();
+            screenHeight  = GetScreenHeight();
+            resizePending = true;
+            Vector2 dpi = GetWindowScaleDPI();
+            LogMessage(LOG_INFO, LOGCAT_GAME, "Window %dx%d (DPI scale %.2f)", screenWidth, screenHeight, (double)dpi.x);
+        }
+        if (resizePending) resizePending = !PushResizeEvent(&sim.input, screenWidth, screenHeight);
+
+        FlushMinimapUploads(&minimap);
+        RenderSnapshot *snap = AcquireSnapshot(&sim.snapshots);
+        const UiModel *ui = &snap->ui;
+        UpdateUiLayouts(&layouts, ui->maxInventory, screenWidth, screenHeight);
+
+        // Camera and player are drawn between the last two ticks
+        float blend = SnapshotBlend(snap, GetTime());
+        Camera2D camera = snap->camera;
+        camera.target = Vector2Lerp(snap->prevCamera.target, snap->camera.target, blend);
+        camera.zoom   = Lerp(snap->prevCamera.zoom, snap->camera.zoom, blend);
+        Vector2 playerPos = Vector2Lerp(snap->prevPlayerPos, snap->playerPos, blend);
+        float walkTimer   = Lerp(snap->prevWalkTimer, snap->walkTimer, blend);
+        UpdateUiFeedback(&feedback, &sim.uiEvents, GetFrameTime());
+        DrainTelemetry(&sim.telemetry, &stats);
+
+        // UI clicks and ESC go through the layouts before anything is drawn;
+        // the sim applies the resulting commands at the start of its next tick
+        UiInput uiInput = TakeUiInput(&sampler);
+        uiInput.mouse = GetMousePosition();
+        HitTestUi(ui, &layouts, &uiInput, &sim.commands, &feedback);
+
+        // Drawing
+        BeginDrawing();
+        ClearBackground(COL_SAND_BASE);
+
+        // Draw parallax background BEFORE BeginMode2D (screen space with parallax offset)
+        DrawParallaxDunes(parallaxDunes, NUM_PARALLAX_DUNES, camera, screenWidth, screenHeight);
+
+        BeginMode2D(camera);
+
+        // Draw ground (tiled sprites + dune arcs)
+        DrawGround(snap->chunks, snap->numChunks, &spr, camera, screenWidth, screenHeight);
+
+        // Only chunks overlapping the view are drawn (pad covers sprite overhang)
+        Rectangle view = CameraView(camera, screenWidth, screenHeight);
+
+        // Draw terrain accents (dunes/debris above ground, below items)
+        for (int c = 0; c < snap->numChunks; c++) {
+            Chunk *ch = &snap->chunks[c];
+            if (!ChunkInView(ch, view, 64.0f)) continue;
+            DrawTerrainAccents(ch->accents, ch->numAccents, &spr, camera.zoom);
+        }
+
+        // Draw footprints (above ground, below Z)
+        DrawFootprints(snap->footprints, MAX_FOOTPRINTS);
+
+        // Draw spawn shimmers (above ground, below items)
+        for (int c = 0; c < snap->numChunks && camera.zoom >= LOD_EFFECTS_MIN_ZOOM; c++) {
+            Chunk *ch = &snap->chunks[c];
+            if (!ChunkInView(ch, view, 32.0f)) continue;
+            DrawSpawnShimmers(ch->shimmers, ch->numItems);
+        }
+
+        // Draw world items
+        for (int c = 0; c < snap->numChunks; c++) {
+            Chunk *ch = &snap->chunks[c];
+            if (!ChunkInView(ch, view, 64.0f)) continue;
+            DrawWorldItems(ch->items, ch->numItems, playerPos, camera, snap->pulseTimer,
+                           snap->shadowOffsetX, snap->shadowOffsetY, snap->isNight, &spr);
+        }
+
+        // Draw village (contains workbench)
+        DrawVillage(snap->pulseTimer, snap->isNight, snap->shadowOffsetX, snap->shadowOffsetY, &spr);
+
+        // Draw city gate
+        DrawCityGate(&snap->cityBuildings, snap->pulseTimer, snap->isNight, spr.city_gate);
+
+        // Scavenger crowd
+        DrawScavengers(snap->scavengers, snap->numScavengers, camera.zoom);
+
+        // Draw particles (in world space)
+        DrawParticles(snap->particles, NUM_PARTICLES, camera.zoom);
+
+        // Draw dust puffs (in world space, below Z)
+        DrawDustPuffs(snap->dustPuffs, MAX_DUST_PUFFS);
+
+        // Click-to-move route
+        DrawPathRoute(&snap->route, playerPos, camera.zoom, snap->pulseTimer);
+
+        // Draw player (Z)
+        DrawZ(playerPos, walkTimer, snap->breathTimer, snap->facing,
+              snap->shadowOffsetX, snap->shadowOffsetY, &spr);
+
+        // Zoomed out: ring the player so Z stays findable in the overview
+        if (camera.zoom < LOD_MARKER_MAX_ZOOM) {
+            DrawRing(playerPos, 8.0f / camera.zoom, 10.0f / camera.zoom, 0.0f, 360.0f, 24, COL_Z_SCARF);
+        }
+
+        // Draw pickup effect (in world space)
+        if (snap->pickupEffect.active) {
+            DrawPickupEffect(&snap->pickupEffect, camera);
+        }
+
+        // Heat shimmer out in the deep desert
+        DrawHeatShimmer(camera, screenWidth, screenHeight, snap->pulseTimer);
+
+        EndMode2D();
+
+        // --- Day/night overlay ---
+        DrawDayNightOverlay(snap->dayPhase, screenWidth, screenHeight);
+
+        // Draw atmosphere overlay (screen space)
+        DrawAtmosphere(camera, screenWidth, screenHeight);
+
+        // Draw wind lines (screen space)
+        DrawWindLines(snap->windLines, MAX_WIND_LINES);
+
+        // Draw storm overlay (screen space)
+        DrawStormOverlay(snap->stormState, snap->stormPhase, snap->stormParticles, MAX_STORM_PARTICLES,
+                         screenWidth, screenHeight);
+
+        // Pickup flash (after EndMode2D, before EndDrawing)
+        if (feedback.pickupFlashTimer > 0.0f) {
+            float t = feedback.pickupFlashTimer / feedback.pickupFlashMax;
+            unsigned char flashA = (unsigned char)(t * 40.0f);
+            DrawRectangle(0, 0, screenWidth, screenHeight, (Color){ 255, 240, 200, flashA });
+        }
+
+        // Sun/moon indicator
+        DrawSunMoon(snap->dayPhase, screenWidth);
+
+        // Storm "wind picking up" hint
+        if (snap->stormState == STORM_BUILDING && snap->stormMsgAlpha > 0.0f) {
+            unsigned char ma = (unsigned char)(snap->stormMsgAlpha * 180.0f);
+            const char *stormMsg = "wind picking up...";
+            int smW = MeasureText(stormMsg, 16);
+            int smX = screenWidth / 2 - smW / 2;
+            DrawText(stormMsg, smX, 56, 16, (Color){ 212, 184, 150, ma });
+        }
+
+        // HUD: pack count + token indicator
+        DrawHUD(snap->ui.inventory, screenWidth, snap->ui.maxInventory, snap->ui.tokenCount,
+                feedback.tokenAnimTimer, feedback.tokenAnimDelta);
+
+        // Perf overlay (F3, below the sun/moon arc)
+        if (snap->perfOpen) {
+            DrawPerfOverlay(&snap->perf, &latency, &pacing, GetFPS(), GetFrameTime());
+        }
+        if (snap->rewind.scrubbing) DrawRewindBanner(&snap->rewind, screenWidth);
+
+        // Minimap (bottom-right)
+        if (snap->minimapOpen) {
+            DrawMinimap(&minimap, playerPos, snap->facing, screenWidth, screenHeight, snap->pulseTimer);
+        }
+
+        // Glider indicator
+        if (snap->gliderOn) {
+            const char *gliderMsg = (snap->chunksMissing > 0) ? "GLIDER - waiting for terrain" : "GLIDER";
+            DrawText(gliderMsg, 20, screenHeight - 36, 16,
+                     (snap->chunksMissing > 0) ? COL_UI_DIM : COL_UI_HEADER);
+        }
+
+        // Full inventory message
+        if (feedback.fullMsgTimer > 0.0f) {
+            float alpha = (feedback.fullMsgTimer > 0.3f) ? 1.0f : (feedback.fullMsgTimer / 0.3f);
+            unsigned char a  = (unsigned char)(alpha * 220);
+            const char *msg  = "Inventory full - return to workbench";
+            int msgW = MeasureText(msg, 20);
+            int msgX = screenWidth / 2 - msgW / 2;
+            int msgY = screenHeight - 80;
+            DrawRectangle(msgX - 12, msgY - 6, msgW + 24, 32, (Color){ 26, 26, 46, a });
+            DrawRectangleLines(msgX - 12, msgY - 6, msgW + 24, 32,
                                (Color){ 212, 165, 116, a });
             DrawText(msg, msgX, msgY, 20, (Color){ 212, 165, 116, a });
         }
 
-        // Inventory screen overlay
-        if (inventoryOpen) {
-            DrawInventoryScreen(inventory, maxInventory,
-                                &inventoryTab, dataLogsPurchased,
-                                &dataLogViewerOpen, &dataLogViewerIndex);
-        }
+        // UI screens only draw the snapshot's model (clicks were hit-tested above)
+
+        // Inventory screen overlay
+        if (ui->inventoryOpen) {
+            DrawInventoryScreen(ui, &layouts, uiInput.mouse);
+        }
+
+        // Workbench UI overlay
+        if (ui->workbenchState != WB_CLOSED) {
+            DrawWorkbenchUI(ui, &layouts);
+        }
+
+        // Trade screen overlay
+        if (ui->tradeScreenOpen) {
+            DrawTradeScreenUI(ui, &feedback, &layouts, uiInput.mouse);
+        }
+
+        // Data log viewer overlay (can be opened from trade screen or independently)
+        if (ui->dataLogViewerOpen) {
+            DrawDataLogViewer(ui->dataLogViewerIndex, &layouts, uiInput.mouse);
+        }
+
+        EndDrawing();
+        SampleInput(&sampler, &sim.input);
+
+        // Click-to-response: the first frame on screen that answers a press
+        if (snap->inputTime > latency.lastTime) {
+            latency.lastTime = snap->inputTime;
+            latency.lastMs   = (GetTime() - snap->inputTime) * 1000.0;
+            latency.avgMs    = (latency.count == 0) ? latency.lastMs : latency.avgMs * 0.9 + latency.lastMs * 0.1;
+            latency.maxMs    = fmax(latency.maxMs, latency.lastMs);
+            latency.count++;
+        }
+
+        if (snap->frameCap != frameCap) {
+            frameCap = snap->frameCap;
+            targetHz = FrameCapHz(frameCap);
+            LogMessage(LOG_INFO, LOGCAT_GAME, "Frame cap %d Hz (0 = uncapped)", targetHz);
+        }
+
+        // Throttle while unfocused, idle or minimized; the sim follows
+        PresentMode nextPresent = ChoosePresentMode(ui, &feedback, &sampler);
+        if (nextPresent != present) {
+            present = nextPresent;
+            atomic_store(&sim.present, present);
+            if (present == PRESENT_MINIMIZED) {
+                LogMessage(LOG_INFO, LOGCAT_GAME, "Window minimized: sim paused");
+                continue;
+            }
+        }
+        if (PresentHz(present, targetHz) != frameHz) {
+            frameHz   = PresentHz(present, targetHz);
+            nextFrame = (frameHz > 0) ? pacing.lastFrame + 1.0 / frameHz : GetTime();
+        }
+        WaitForNextFrame(&sampler, &sim.input, nextFrame, present);
+    }
+
+    StopSimThread(&sim);
+    LogMessage(LOG_INFO, LOGCAT_GAME, "Session: %d items picked up, %d repairs, %d trades, %d purchases, %d storms",
+               stats.itemsPickedUp, stats.repairs, stats.trades, stats.purchases, stats.storms);
+
+    // --- Unload all sprites ---
+    UnloadTexture(spr.z_down);
+    UnloadTexture(spr.z_up);
+    UnloadTexture(spr.z_left);
+    UnloadTexture(spr.z_right);
+    for (int i = 0; i < 5; i++) UnloadTexture(spr.building[i]);
+    UnloadTexture(spr.itemAtlas);
+    for (int i = 0; i < 3; i++) UnloadTexture(spr.ground[i]);
+    for (int i = 0; i < 3; i++) UnloadTexture(spr.dune[i]);
+    UnloadTexture(spr.debris1);
+    UnloadTexture(spr.city_gate);
+    UnloadTexture(minimap.texture);
+
+    CloseWindow();
+    ShutdownLogger();
+    FreeItemTable(&itemTable);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// GenerateChunk  — fill one chunk deterministically from (seed, cx, cy).
+// Ground tone and dune height come from fBm gradient noise, dune crests are
+// traced along ridged noise, and debris clusters where the density noise is
+// high, so neighbouring chunks join into continuous structure.
+// ---------------------------------------------------------------------------
+void GenerateChunk(Chunk *chunk, int cx, int cy, unsigned long long seed)
+{
+    WorldRng rng = { HashChunkCoords(seed, cx, cy) };
+    unsigned int noiseSeed = HashSeed(seed, 0x4E4F4953u);
+    float originX = (float)cx * CHUNK_SIZE;
+    float originY = (float)cy * CHUNK_SIZE;
+    Vector2 villageCenter = { VILLAGE_X, VILLAGE_Y };
+
+    chunk->cx           = cx;
+    chunk->cy           = cy;
+    chunk->loaded       = true;
+    chunk->modifiedMask = 0;
+    chunk->journalMask  = 0;
+
+    // Noise fields for the whole chunk, one sample per 16px cell
+    float heightGrid[CHUNK_CELLS * CHUNK_CELLS];
+    float ridgeGrid[CHUNK_CELLS * CHUNK_CELLS];
+    float debrisGrid[CHUNK_CELLS * CHUNK_CELLS];
+    FillNoiseGrid(heightGrid, originX, originY, NOISE_HEIGHT_WAVELENGTH, 2, false, noiseSeed);
+    FillNoiseGrid(ridgeGrid,  originX, originY, NOISE_RIDGE_WAVELENGTH,  1, true,  noiseSeed ^ 0x52494447u);
+    FillNoiseGrid(debrisGrid, originX, originY, NOISE_DEBRIS_WAVELENGTH, 1, false, noiseSeed ^ 0x44454252u);
+
+    for (int y = 0; y < CHUNK_CELLS; y++) {
+        for (int x = 0; x < CHUNK_CELLS; x++) {
+            float h = 0.5f + 0.5f * heightGrid[y * CHUNK_CELLS + x];
+            if (h < 0.0f) h = 0.0f;
+            if (h > 1.0f) h = 1.0f;
+            chunk->height[y][x] = (unsigned char)(h * 255.0f);
+        }
+    }
+
+    // Ground tiles: sand tone band from the height at each tile center
+    int cellsPerTile = CHUNK_CELLS / CHUNK_TILES;
+    for (int ty = 0; ty < CHUNK_TILES; ty++) {
+        for (int tx = 0; tx < CHUNK_TILES; tx++) {
+            int h = chunk->height[ty * cellsPerTile + cellsPerTile / 2][tx * cellsPerTile + cellsPerTile / 2];
+            chunk->tiles[ty][tx] = (unsigned char)(h < 107 ? 0 : (h < 148 ? 1 : 2));
+        }
+    }
+
+    // Dune crests: start at the strongest ridge cells and walk along the crest
+    // (perpendicular to the ridge gradient) for up to DUNE_SEGMENTS steps
+    chunk->numDunes = 0;
+    bool ridgeUsed[CHUNK_CELLS / 8][CHUNK_CELLS / 8] = { { false } };  // one crest per 128px block
+    for (int pass = 0; pass < CHUNK_MAX_DUNES; pass++) {
+        int best = -1;
+        float bestVal = DUNE_RIDGE_THRESHOLD;
+        for (int i = 0; i < CHUNK_CELLS * CHUNK_CELLS; i++) {
+            int bx = (i % CHUNK_CELLS) / 8, by = (i / CHUNK_CELLS) / 8;
+            if (ridgeUsed[by][bx] || ridgeGrid[i] <= bestVal) continue;
+            best = i;
+            bestVal = ridgeGrid[i];
+        }
+        if (best < 0) break;
+        int bcx = (best % CHUNK_CELLS) / 8, bcy = (best / CHUNK_CELLS) / 8;
+        for (int by = bcy - 2; by <= bcy + 2; by++) {
+            for (int bx = bcx - 2; bx <= bcx + 2; bx++) {
+                if (bx >= 0 && by >= 0 && bx < CHUNK_CELLS / 8 && by < CHUNK_CELLS / 8) ridgeUsed[by][bx] = true;
+            }
+        }
+
+        DuneLine *dune = &chunk->dunes[chunk->numDunes];
+        Vector2 p = {
+            originX + ((best % CHUNK_CELLS) + 0.5f) * CHUNK_CELL_SIZE,
+            originY + ((best / CHUNK_CELLS) + 0.5f) * CHUNK_CELL_SIZE
+        };
+        Vector2 prevDir = { 0 };
+        dune->numPts = 0;
+        dune->pts[dune->numPts++] = p;
+        for (int step = 0; step < DUNE_SEGMENTS; step++) {
+            float e  = (float)CHUNK_CELL_SIZE;
+            float gx = SampleNoiseGrid(ridgeGrid, originX, originY, p.x + e, p.y) -
+                       SampleNoiseGrid(ridgeGrid, originX, originY, p.x - e, p.y);
+            float gy = SampleNoiseGrid(ridgeGrid, originX, originY, p.x, p.y + e) -
+                       SampleNoiseGrid(ridgeGrid, originX, originY, p.x, p.y - e);
+            Vector2 dir = Vector2Normalize((Vector2){ -gy, gx });
+            if (dir.x == 0.0f && dir.y == 0.0f) break;
+            if (Vector2DotProduct(dir, prevDir) < 0.0f) dir = Vector2Scale(dir, -1.0f);
+            p = Vector2Add(p, Vector2Scale(dir, DUNE_STEP));
+            if (p.x < originX || p.y < originY ||
+                p.x > originX + CHUNK_SIZE || p.y > originY + CHUNK_SIZE) break;
+            if (SampleNoiseGrid(ridgeGrid, originX, originY, p.x, p.y) < DUNE_RIDGE_THRESHOLD - 0.1f) break;
+            dune->pts[dune->numPts++] = p;
+            prevDir = dir;
+        }
+        dune->width = 2.0f + (bestVal - DUNE_RIDGE_THRESHOLD) / (1.0f - DUNE_RIDGE_THRESHOLD);
+        if (dune->numPts >= 3) chunk->numDunes++;
+    }
+
+    // Items: a few per chunk, never on top of the village (100px)
+    chunk->numItems = 0;
+    int wantItems = RngRange(&rng, 2, CHUNK_MAX_ITEMS);
+    for (int attempt = 0; attempt < 16 && chunk->numItems < wantItems; attempt++) {
+        Vector2 pos = {
+            originX + 50.0f + (float)RngRange(&rng, 0, CHUNK_SIZE - 100),
+            originY + 50.0f + (float)RngRange(&rng, 0, CHUNK_SIZE - 100)
+        };
+        if (Vector2Distance(pos, villageCenter) < 100.0f) continue;
+        WorldItem *item = &chunk->items[chunk->numItems];
+        item->position     = pos;
+        item->typeIndex    = RandomItemType(&itemTable, &rng);
+        item->condition    = 0.3f + (RngRange(&rng, 0, 600) / 1000.0f);
+        item->active       = true;
+        item->respawnTimer = 0.0f;
+        chunk->shimmers[chunk->numItems].active = false;
+        chunk->shimmers[chunk->numItems].timer  = 0.0f;
+        chunk->numItems++;
+    }
+
+    // Terrain accents: candidates are kept with probability equal to the local
+    // debris density, so debris clusters in fields and open sand stays open.
+    // Debris sprite in dense spots, dune sprites on high sand elsewhere.
+    chunk->numAccents = 0;
+    for (int attempt = 0; attempt < 24 && chunk->numAccents < CHUNK_MAX_ACCENTS; attempt++) {
+        Vector2 pos = {
+            originX + 80.0f + (float)RngRange(&rng, 0, CHUNK_SIZE - 160),
+            originY + 80.0f + (float)RngRange(&rng, 0, CHUNK_SIZE - 160)
+        };
+        float density = SampleNoiseGrid(debrisGrid, originX, originY, pos.x, pos.y);
+        float height  = SampleNoiseGrid(heightGrid, originX, originY, pos.x, pos.y);
+        if ((float)RngRange(&rng, 0, 999) / 1000.0f >= density) continue;
+        if (Vector2Distance(pos, villageCenter) < VILLAGE_CLEAR_RADIUS) continue;
+        bool tooClose = false;
+        for (int j = 0; j < chunk->numItems; j++) {
+            if (Vector2Distance(pos, chunk->items[j].position) < 80.0f) {
+                tooClose = true;
+                break;
+            }
+        }
+        if (tooClose) continue;
+        int sprite;
+        if (density > 0.35f || height < 0.0f) sprite = 3;
+        else sprite = height > 0.3f ? 2 : RngRange(&rng, 0, 1);
+        chunk->accents[chunk->numAccents].pos       = pos;
+        chunk->accents[chunk->numAccents].spriteIdx = sprite;
+        chunk->numAccents++;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// FindChunk  — loaded chunk at (cx, cy), or NULL
+// ---------------------------------------------------------------------------
+Chunk *FindChunk(ChunkCache *cache, int cx, int cy)
+{
+    for (int i = 0; i < MAX_LOADED_CHUNKS; i++) {
+        Chunk *ch = &cache->chunks[i];
+        if (ch->loaded && ch->cx == cx && ch->cy == cy) return ch;
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// InstallChunk  — copy a generated chunk into a free or least-recently-used
+// slot. Chunks touched this frame are never evicted.
+// ---------------------------------------------------------------------------
+Chunk *InstallChunk(ChunkCache *cache, const Chunk *generated)
+{
+    Chunk *victim = NULL;
+    for (int i = 0; i < MAX_LOADED_CHUNKS; i++) {
+        Chunk *cand = &cache->chunks[i];
+        if (!cand->loaded) { victim = cand; break; }
+        if (cand->lastUsedFrame == cache->frame) continue;
+        if (victim == NULL || cand->lastUsedFrame < victim->lastUsedFrame) victim = cand;
+    }
+    if (victim == NULL) return NULL;  // every slot is in view this frame
+
+    // Finish deferred placements, then keep the player's changes to the
+    // evicted chunk in the overlay
+    for (int i = 0; victim->loaded && i < victim->numItems; i++) {
+        if (victim->pendingRespawn & (1u << i)) PlaceRespawnedItem(victim, i, &cache->rng);
+    }
+    if (victim->loaded && victim->modifiedMask != 0) {
+        RecordChunkDiff(cache->overlay, victim);
+    }
+    if (victim->loaded && victim->journalMask != 0 && cache->journal != NULL) {
+        JournalChunkItems(cache->journal, victim);
+    }
+    if (victim->loaded) {
+        for (int i = 0; i < victim->numColliders; i++) {
+            RemoveCollider(cache->collision, victim->colliders[i]);
+        }
+    }
+
+    *victim = *generated;
+    victim->loaded        = true;
+    victim->lastUsedFrame = cache->frame;
+    victim->minimapDirty  = true;
+    victim->simTime       = -1.0;
+    victim->pendingRespawn = 0;
+    ApplyChunkDiff(cache->overlay, victim);
+
+    // Debris accents are solid
+    victim->numColliders = 0;
+    for (int i = 0; i < victim->numAccents; i++) {
+        if (victim->accents[i].spriteIdx != 3) continue;
+        Vector2 p = victim->accents[i].pos;
+        int id = AddCollider(cache->collision,
+                             (Rectangle){ p.x - DEBRIS_COLLIDER_W / 2.0f, p.y - DEBRIS_COLLIDER_H / 2.0f,
+                                          DEBRIS_COLLIDER_W, DEBRIS_COLLIDER_H });
+        if (id >= 0) victim->colliders[victim->numColliders++] = (short)id;
+    }
+    return victim;
+}
+
+// ---------------------------------------------------------------------------
+// ClearChunkCache  — drop every loaded chunk (and its colliders)
+// ---------------------------------------------------------------------------
+void ClearChunkCache(ChunkCache *cache)
+{
+    for (int c = 0; c < MAX_LOADED_CHUNKS; c++) {
+        Chunk *ch = &cache->chunks[c];
+        if (!ch->loaded) continue;
+        for (int i = 0; i < ch->numColliders; i++) {
+            RemoveCollider(cache->collision, ch->colliders[i]);
+        }
+        ch->loaded = false;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Collision world  — static AABB colliders in a spatial hash of grid cells.
+// A collider is referenced from every cell its box overlaps; movers query
+// only the cells under their own bounds, so cost per mover is independent
+// of how many colliders exist.
+// ---------------------------------------------------------------------------
+static int CollisionCellHome(int x, int y)
+{
+    return (int)(HashChunkCoords(0, x, y) & (COLLISION_HASH_SIZE - 1));
+}
+
+// Slot holding cell (x, y), or the empty slot where it would go
+static int CollisionCellSlot(CollisionWorld *world, int x, int y)
+{
+    int i = CollisionCellHome(x, y);
+    while (world->cells[i].count != 0 && (world->cells[i].x != x || world->cells[i].y != y)) {
+        i = (i + 1) & (COLLISION_HASH_SIZE - 1);
+    }
+    return i;
+}
+
+// Empty a slot, shifting later entries of the probe run back so lookups
+// never stop early at the hole
+static void CollisionCellErase(CollisionWorld *world, int hole)
+{
+    world->cells[hole].count = 0;
+    int j = hole;
+    for (;;) {
+        j = (j + 1) & (COLLISION_HASH_SIZE - 1);
+        if (world->cells[j].count == 0) return;
+        int home = CollisionCellHome(world->cells[j].x, world->cells[j].y);
+        bool stays = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (stays) continue;
+        world->cells[hole] = world->cells[j];
+        world->cells[j].count = 0;
+        hole = j;
+    }
+}
+
+static void CollisionCellRange(Rectangle box, int *x0, int *y0, int *x1, int *y1)
+{
+    *x0 = (int)floorf(box.x / COLLISION_CELL_SIZE);
+    *y0 = (int)floorf(box.y / COLLISION_CELL_SIZE);
+    *x1 = (int)floorf((box.x + box.width)  / COLLISION_CELL_SIZE);
+    *y1 = (int)floorf((box.y + box.height) / COLLISION_CELL_SIZE);
+}
+
+void InitCollisionWorld(CollisionWorld *world)
+{
+    memset(world->cells, 0, sizeof(world->cells));
+    for (int i = 0; i < MAX_COLLIDERS; i++) world->colliders[i].nextFree = i + 1;
+    world->colliders[MAX_COLLIDERS - 1].nextFree = -1;
+    world->freeHead = 0;
+}
+
+// Returns the collider id, or -1 if the pool is exhausted. A cell that is
+// already full simply does not reference the new collider.
+int AddCollider(CollisionWorld *world, Rectangle box)
+{
+    int id = world->freeHead;
+    if (id < 0) return -1;
+    world->freeHead = world->colliders[id].nextFree;
+    world->colliders[id].box = box;
+    world->version++;
+
+    int x0, y0, x1, y1;
+    CollisionCellRange(box, &x0, &y0, &x1, &y1);
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            CollisionCell *cell = &world->cells[CollisionCellSlot(world, x, y)];
+            if (cell->count == 0) {
+                cell->x = x;
+                cell->y = y;
+            }
+            if (cell->count < COLLISION_CELL_CAP) cell->ids[cell->count++] = (short)id;
+        }
+    }
+    return id;
+}
+
+void RemoveCollider(CollisionWorld *world, int id)
+{
+    int x0, y0, x1, y1;
+    CollisionCellRange(world->colliders[id].box, &x0, &y0, &x1, &y1);
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            int slot = CollisionCellSlot(world, x, y);
+            CollisionCell *cell = &world->cells[slot];
+            for (int k = 0; k < cell->count; k++) {
+                if (cell->ids[k] != id) continue;
+                cell->ids[k] = cell->ids[--cell->count];
+                break;
+            }
+            if (cell->count == 0) CollisionCellErase(world, slot);
+        }
+    }
+    world->colliders[id].nextFree = world->freeHead;
+    world->freeHead = id;
+    world->version++;
+}
+
+// Would a circle at pos overlap any collider?
+bool PointBlocked(CollisionWorld *world, Vector2 pos, float radius)
+{
+    int x0, y0, x1, y1;
+    CollisionCellRange((Rectangle){ pos.x - radius, pos.y - radius, radius * 2, radius * 2 },
+                       &x0, &y0, &x1, &y1);
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            CollisionCell *cell = &world->cells[CollisionCellSlot(world, x, y)];
+            for (int k = 0; k < cell->count; k++) {
+                Rectangle b = world->colliders[cell->ids[k]].box;
+                float dx = pos.x - Clamp(pos.x, b.x, b.x + b.width);
+                float dy = pos.y - Clamp(pos.y, b.y, b.y + b.height);
+                if (dx * dx + dy * dy < radius * radius) return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Push a circle out of every collider in the cells it overlaps
+static Vector2 ResolveCircle(CollisionWorld *world, Vector2 pos, float radius)
+{
+    int x0, y0, x1, y1;
+    CollisionCellRange((Rectangle){ pos.x - radius, pos.y - radius, radius * 2, radius * 2 },
+                       &x0, &y0, &x1, &y1);
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            CollisionCell *cell = &world->cells[CollisionCellSlot(world, x, y)];
+            for (int k = 0; k < cell->count; k++) {
+                Rectangle b = world->colliders[cell->ids[k]].box;
+                Vector2 closest = { Clamp(pos.x, b.x, b.x + b.width), Clamp(pos.y, b.y, b.y + b.height) };
+                Vector2 d = Vector2Subtract(pos, closest);
+                float distSq = d.x * d.x + d.y * d.y;
+                if (distSq >= radius * radius) continue;
+                if (distSq > 0.0001f) {
+                    float dist = sqrtf(distSq);
+                    pos = Vector2Add(pos, Vector2Scale(d, (radius - dist) / dist));
+                } else {
+                    // Center is inside the box: leave through the nearest side
+                    float l = pos.x - b.x, r = b.x + b.width - pos.x;
+                    float t = pos.y - b.y, bt = b.y + b.height - pos.y;
+                    float m = fminf(fminf(l, r), fminf(t, bt));
+                    if (m == l)      pos.x = b.x - radius;
+                    else if (m == r) pos.x = b.x + b.width + radius;
+                    else if (m == t) pos.y = b.y - radius;
+                    else             pos.y = b.y + b.height + radius;
+                }
+            }
+        }
+    }
+    return pos;
+}
+
+// ---------------------------------------------------------------------------
+// MoveCircle  — move a circular mover by delta, sliding along colliders.
+// The move is split into steps no longer than the radius, so even glider
+// speed cannot tunnel through the thinnest collider.
+// ---------------------------------------------------------------------------
+Vector2 MoveCircle(CollisionWorld *world, Vector2 pos, Vector2 delta, float radius)
+{
+    float len = Vector2Length(delta);
+    int steps = (int)ceilf(len / radius);
+    if (steps < 1) steps = 1;
+    Vector2 step = Vector2Scale(delta, 1.0f / steps);
+    for (int i = 0; i < steps; i++) {
+        pos = ResolveCircle(world, Vector2Add(pos, step), radius);
+    }
+    return pos;
+}
+
+// ---------------------------------------------------------------------------
+// Pathfinding  — jump point search (no corner cutting) over a window of the
+// path grid. The window is rasterized from the collision hash per query
+// (colliders inflated by PLAYER_RADIUS), so scans run over a byte array.
+// ---------------------------------------------------------------------------
+static int PathCell(float v)
+{
+    return (int)floorf(v / PATH_CELL_SIZE);
+}
+
+static Vector2 PathCellCenter(int x, int y)
+{
+    return (Vector2){ (x + 0.5f) * PATH_CELL_SIZE, (y + 0.5f) * PATH_CELL_SIZE };
+}
+
+// Window-local walkability; everything outside the window is a wall
+static bool PathWalkable(PathFinder *pf, int x, int y)
+{
+    return x >= 0 && y >= 0 && x < pf->w && y < pf->h && !pf->blocked[y * pf->w + x];
+}
+
+static void RasterizeWindow(PathFinder *pf, CollisionWorld *world)
+{
+    memset(pf->blocked, 0, (size_t)(pf->w * pf->h));
+    float r = PLAYER_RADIUS;
+    Rectangle area = { pf->originX * (float)PATH_CELL_SIZE - r, pf->originY * (float)PATH_CELL_SIZE - r,
+                       pf->w * (float)PATH_CELL_SIZE + r * 2, pf->h * (float)PATH_CELL_SIZE + r * 2 };
+    int x0, y0, x1, y1;
+    CollisionCellRange(area, &x0, &y0, &x1, &y1);
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            CollisionCell *cell = &world->cells[CollisionCellSlot(world, cx, cy)];
+            for (int k = 0; k < cell->count; k++) {
+                // Mark every path cell whose center lies inside the inflated box
+                Rectangle b = world->colliders[cell->ids[k]].box;
+                int px0 = (int)ceilf((b.x - r) / PATH_CELL_SIZE - 0.5f) - pf->originX;
+                int py0 = (int)ceilf((b.y - r) / PATH_CELL_SIZE - 0.5f) - pf->originY;
+                int px1 = (int)floorf((b.x + b.width  + r) / PATH_CELL_SIZE - 0.5f) - pf->originX;
+                int py1 = (int)floorf((b.y + b.height + r) / PATH_CELL_SIZE - 0.5f) - pf->originY;
+                if (px0 < 0) px0 = 0;
+                if (py0 < 0) py0 = 0;
+                if (px1 > pf->w - 1) px1 = pf->w - 1;
+                if (py1 > pf->h - 1) py1 = pf->h - 1;
+                for (int y = py0; y <= py1; y++) {
+                    memset(&pf->blocked[y * pf->w + px0], 1, (size_t)(px1 - px0 + 1 > 0 ? px1 - px0 + 1 : 0));
+                }
+            }
+        }
+    }
+}
+
+// Nearest walkable window cell to (x, y), searching outward ring by ring
+static bool SnapToWalkable(PathFinder *pf, int *x, int *y)
+{
+    for (int r = 0; r <= 6; r++) {
+        for (int dy = -r; dy <= r; dy++) {
+            for (int dx = -r; dx <= r; dx++) {
+                if (abs(dx) != r && abs(dy) != r) continue;
+                if (PathWalkable(pf, *x + dx, *y + dy)) {
+                    *x += dx;
+                    *y += dy;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+static void PathOpenPush(PathFinder *pf, float f, int node)
+{
+    if (pf->openCount >= PATH_WINDOW_MAX * PATH_WINDOW_MAX) return;
+    int i = pf->openCount++;
+    pf->open[i] = (PathOpenNode){ f, node };
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (pf->open[parent].f <= pf->open[i].f) break;
+        PathOpenNode tmp = pf->open[i];
+        pf->open[i] = pf->open[parent];
+        pf->open[parent] = tmp;
+        i = parent;
+    }
+}
+
+static PathOpenNode PathOpenPop(PathFinder *pf)
+{
+    PathOpenNode top = pf->open[0];
+    pf->open[0] = pf->open[--pf->openCount];
+    int i = 0;
+    for (;;) {
+        int l = i * 2 + 1, r = l + 1, best = i;
+        if (l < pf->openCount && pf->open[l].f < pf->open[best].f) best = l;
+        if (r < pf->openCount && pf->open[r].f < pf->open[best].f) best = r;
+        if (best == i) break;
+        PathOpenNode tmp = pf->open[i];
+        pf->open[i] = pf->open[best];
+        pf->open[best] = tmp;
+        i = best;
+    }
+    return top;
+}
+
+static float OctileDistance(int dx, int dy)
+{
+    dx = abs(dx);
+    dy = abs(dy);
+    return (dx > dy) ? dx + 0.41421356f * dy : dy + 0.41421356f * dx;
+}
+
+// Jump from (x, y), arrived at from (px, py). Returns the jump point as a
+// window node index, or -1. Diagonal steps need both orthogonals open.
+static int JumpPoint(PathFinder *pf, int x, int y, int px, int py, int gx, int gy)
+{
+    int dx = x - px, dy = y - py;
+    for (;;) {
+        if (!PathWalkable(pf, x, y)) return -1;
+        if (x == gx && y == gy) return y * pf->w + x;
+        if (dx != 0 && dy != 0) {
+            if (JumpPoint(pf, x + dx, y, x, y, gx, gy) >= 0 ||
+                JumpPoint(pf, x, y + dy, x, y, gx, gy) >= 0) return y * pf->w + x;
+        } else if (dx != 0) {
+            if ((PathWalkable(pf, x, y - 1) && !PathWalkable(pf, x - dx, y - 1)) ||
+                (PathWalkable(pf, x, y + 1) && !PathWalkable(pf, x - dx, y + 1))) return y * pf->w + x;
+        } else {
+            if ((PathWalkable(pf, x - 1, y) && !PathWalkable(pf, x - 1, y - dy)) ||
+                (PathWalkable(pf, x + 1, y) && !PathWalkable(pf, x + 1, y - dy))) return y * pf->w + x;
+        }
+        if (!PathWalkable(pf, x + dx, y) || !PathWalkable(pf, x, y + dy)) return -1;
+        x += dx;
+        y += dy;
+    }
+}
+
+// Pruned neighbour directions of a node reached from its parent
+static int JumpDirections(PathFinder *pf, int x, int y, int parent, int dirs[8][2])
+{
+    int n = 0;
+    if (parent < 0) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dy == 0) continue;
+                if (!PathWalkable(pf, x + dx, y + dy)) continue;
+                if (dx != 0 && dy != 0 && (!PathWalkable(pf, x + dx, y) || !PathWalkable(pf, x, y + dy))) continue;
+                dirs[n][0] = dx; dirs[n][1] = dy; n++;
+            }
+        }
+        return n;
+    }
+    int ppx = parent % pf->w, ppy = parent / pf->w;
+    int dx = (x > ppx) - (x < ppx), dy = (y > ppy) - (y < ppy);
+    if (dx != 0 && dy != 0) {
+        bool v = PathWalkable(pf, x, y + dy), h = PathWalkable(pf, x + dx, y);
+        if (v) { dirs[n][0] = 0;  dirs[n][1] = dy; n++; }
+        if (h) { dirs[n][0] = dx; dirs[n][1] = 0;  n++; }
+        if (v && h) { dirs[n][0] = dx; dirs[n][1] = dy; n++; }
+    } else if (dx != 0) {
+        bool next = PathWalkable(pf, x + dx, y);
+        bool up = PathWalkable(pf, x, y - 1), down = PathWalkable(pf, x, y + 1);
+        if (next) {
+            dirs[n][0] = dx; dirs[n][1] = 0; n++;
+            if (up)   { dirs[n][0] = dx; dirs[n][1] = -1; n++; }
+            if (down) { dirs[n][0] = dx; dirs[n][1] = 1;  n++; }
+        }
+        if (up)   { dirs[n][0] = 0; dirs[n][1] = -1; n++; }
+        if (down) { dirs[n][0] = 0; dirs[n][1] = 1;  n++; }
+    } else {
+        bool next = PathWalkable(pf, x, y + dy);
+        bool left = PathWalkable(pf, x - 1, y), right = PathWalkable(pf, x + 1, y);
+        if (next) {
+            dirs[n][0] = 0; dirs[n][1] = dy; n++;
+            if (left)  { dirs[n][0] = -1; dirs[n][1] = dy; n++; }
+            if (right) { dirs[n][0] = 1;  dirs[n][1] = dy; n++; }
+        }
+        if (left)  { dirs[n][0] = -1; dirs[n][1] = 0; n++; }
+        if (right) { dirs[n][0] = 1;  dirs[n][1] = 0; n++; }
+    }
+    return n;
+}
+
+// Can the player walk straight from a to b? Checked against the real
+// colliders: the grid is conservative only along cell-to-cell steps.
+static bool PathLineClear(PathFinder *pf, CollisionWorld *world, Vector2 a, Vector2 b)
+{
+    float len = Vector2Distance(a, b);
+    int steps = (int)(len / (PATH_CELL_SIZE * 0.25f)) + 1;
+    for (int i = 0; i <= steps; i++) {
+        Vector2 p = Vector2Lerp(a, b, (float)i / steps);
+        if (!PathWalkable(pf, PathCell(p.x) - pf->originX, PathCell(p.y) - pf->originY)) return false;
+        if (PointBlocked(world, p, PLAYER_RADIUS + 1.0f)) return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// FindPathLocal  — grid path from start to goal (both within one window).
+// Writes world-space waypoints, excluding the start, into out and returns
+// their count; 0 means no path. Results are cached per (start cell, goal
+// cell) until the collision world changes.
+// ---------------------------------------------------------------------------
+int FindPathLocal(PathFinder *pf, CollisionWorld *world, Vector2 start, Vector2 goal,
+                  Vector2 *out, int maxPoints)
+{
+    int sx = PathCell(start.x), sy = PathCell(start.y);
+    int gx = PathCell(goal.x),  gy = PathCell(goal.y);
+
+    for (int i = 0; i < PATH_CACHE_SIZE; i++) {
+        PathCacheEntry *e = &pf->cache[i];
+        if (e->used && e->version == world->version && e->startX == sx && e->startY == sy &&
+            e->goalX == gx && e->goalY == gy && e->count <= maxPoints) {
+            memcpy(out, e->points, sizeof(Vector2) * (size_t)e->count);
+            if (e->goalExact) out[e->count - 1] = goal;
+            return e->count;
+        }
+    }
+
+    // Window around start and goal
+    pf->originX = ((sx < gx) ? sx : gx) - PATH_WINDOW_PAD;
+    pf->originY = ((sy < gy) ? sy : gy) - PATH_WINDOW_PAD;
+    pf->w = abs(gx - sx) + 1 + PATH_WINDOW_PAD * 2;
+    pf->h = abs(gy - sy) + 1 + PATH_WINDOW_PAD * 2;
+    if (pf->w > PATH_WINDOW_MAX || pf->h > PATH_WINDOW_MAX) return 0;
+    RasterizeWindow(pf, world);
+
+    int lsx = sx - pf->originX, lsy = sy - pf->originY;
+    int lgx = gx - pf->originX, lgy = gy - pf->originY;
+    bool goalSnapped = !PathWalkable(pf, lgx, lgy) || PointBlocked(world, goal, PLAYER_RADIUS);
+    if (!SnapToWalkable(pf, &lsx, &lsy) || !SnapToWalkable(pf, &lgx, &lgy)) return 0;
+
+    // A* over jump points
+    unsigned int id = ++pf->searchId;
+    int startNode = lsy * pf->w + lsx, goalNode = lgy * pf->w + lgx;
+    pf->openCount = 0;
+    pf->g[startNode] = 0.0f;
+    pf->parent[startNode] = -1;
+    pf->visit[startNode] = id;
+    PathOpenPush(pf, OctileDistance(lgx - lsx, lgy - lsy), startNode);
+    bool found = false;
+    int expansions = 0;
+    while (pf->openCount > 0 && expansions++ < PATH_MAX_EXPANSIONS) {
+        int node = PathOpenPop(pf).node;
+        if (pf->closed[node] == id) continue;
+        pf->closed[node] = id;
+        if (node == goalNode) { found = true; break; }
+
+        int x = node % pf->w, y = node / pf->w;
+        int dirs[8][2];
+        int n = JumpDirections(pf, x, y, pf->parent[node], dirs);
+        for (int d = 0; d < n; d++) {
+            int jp = JumpPoint(pf, x + dirs[d][0], y + dirs[d][1], x, y, lgx, lgy);
+            if (jp < 0 || pf->closed[jp] == id) continue;
+            int jx = jp % pf->w, jy = jp / pf->w;
+            float g = pf->g[node] + OctileDistance(jx - x, jy - y);
+            if (pf->visit[jp] == id && g >= pf->g[jp]) continue;
+            pf->visit[jp]  = id;
+            pf->g[jp]      = g;
+            pf->parent[jp] = node;
+            PathOpenPush(pf, g + OctileDistance(lgx - jx, lgy - jy), jp);
+        }
+    }
+    if (!found) return 0;
+
+    // Walk back to the start, then reverse into world space
+    Vector2 rev[PATH_MAX_POINTS];
+    int count = 0;
+    for (int node = goalNode; node != startNode && count < PATH_MAX_POINTS; node = pf->parent[node]) {
+        rev[count++] = PathCellCenter(node % pf->w + pf->originX, node / pf->w + pf->originY);
+    }
+    if (count == 0) rev[count++] = goal;
+    if (!goalSnapped) rev[0] = goal;
+
+    // String-pull: from each kept point, skip ahead while the line stays clear
+    int n = 0;
+    Vector2 anchor = start;
+    int i = count - 1;
+    while (i >= 0 && n < maxPoints) {
+        int far = i;
+        while (far > 0 && PathLineClear(pf, world, anchor, rev[far - 1])) far--;
+        out[n++] = rev[far];
+        anchor = rev[far];
+        i = far - 1;
+    }
+
+    PathCacheEntry *e = &pf->cache[pf->cacheNext];
+    pf->cacheNext = (pf->cacheNext + 1) % PATH_CACHE_SIZE;
+    e->used      = true;
+    e->goalExact = !goalSnapped;
+    e->startX    = sx;
+    e->startY    = sy;
+    e->goalX     = gx;
+    e->goalY     = gy;
+    e->version   = world->version;
+    e->count     = n;
+    memcpy(e->points, out, sizeof(Vector2) * (size_t)n);
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// PlanPath  — start following a route to goal. Goals beyond PATH_LOCAL_RANGE
+// are first routed over chunks (A* on a chunk window, loaded chunks cost more
+// the more debris they hold); the chunk path becomes a corridor of
+// waypoints at most PATH_LOCAL_RANGE apart, each refined by JPS on arrival.
+// ---------------------------------------------------------------------------
+static void PlanChunkCorridor(Path *path, PathFinder *pf, ChunkCache *cache,
+                              Vector2 start, Vector2 goal)
+{
+    int scx = WorldToChunk(start.x), scy = WorldToChunk(start.y);
+    int gcx = WorldToChunk(goal.x),  gcy = WorldToChunk(goal.y);
+    int half = PATH_CHUNK_WINDOW / 2;
+    int ox = scx - half, oy = scy - half;
+    int tx = gcx - ox, ty = gcy - oy;
+    if (tx < 0) tx = 0;
+    if (ty < 0) ty = 0;
+    if (tx > PATH_CHUNK_WINDOW - 1) tx = PATH_CHUNK_WINDOW - 1;
+    if (ty > PATH_CHUNK_WINDOW - 1) ty = PATH_CHUNK_WINDOW - 1;
+
+    // Node cost multiplier: 1 for unknown terrain, more for debris-heavy chunks
+    static float cost[PATH_CHUNK_WINDOW * PATH_CHUNK_WINDOW];
+    for (int i = 0; i < PATH_CHUNK_WINDOW * PATH_CHUNK_WINDOW; i++) cost[i] = 1.0f;
+    for (int c = 0; c < MAX_LOADED_CHUNKS; c++) {
+        Chunk *ch = &cache->chunks[c];
+        int lx = ch->cx - ox, ly = ch->cy - oy;
+        if (!ch->loaded || lx < 0 || ly < 0 || lx >= PATH_CHUNK_WINDOW || ly >= PATH_CHUNK_WINDOW) continue;
+        cost[ly * PATH_CHUNK_WINDOW + lx] = 1.0f + 0.25f * ch->numColliders;
+    }
+
+    // The scratch arrays are shared with the grid search (window-sized)
+    unsigned int id = ++pf->searchId;
+    int w = PATH_CHUNK_WINDOW;
+    int startNode = half * w + half, goalNode = ty * w + tx;
+    pf->openCount = 0;
+    pf->g[startNode] = 0.0f;
+    pf->parent[startNode] = -1;
+    pf->visit[startNode] = id;
+    PathOpenPush(pf, OctileDistance(tx - half, ty - half), startNode);
+    while (pf->openCount > 0) {
+        int node = PathOpenPop(pf).node;
+        if (pf->closed[node] == id) continue;
+        pf->closed[node] = id;
+        if (node == goalNode) break;
+        int x = node % w, y = node / w;
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                int nx = x + dx, ny = y + dy;
+                if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= w || ny >= w) continue;
+                int nb = ny * w + nx;
+                if (pf->closed[nb] == id) continue;
+                float g = pf->g[node] + OctileDistance(dx, dy) * cost[nb];
+                if (pf->visit[nb] == id && g >= pf->g[nb]) continue;
+                pf->visit[nb]  = id;
+                pf->g[nb]      = g;
+                pf->parent[nb] = node;
+                PathOpenPush(pf, g + OctileDistance(tx - nx, ty - ny), nb);
+            }
+        }
+    }
+
+    // Chunk centers from start to goal, keeping only turns (and points needed
+    // to stay within PATH_LOCAL_RANGE of the previous waypoint)
+    int chain[PATH_CHUNK_WINDOW * 2];
+    int len = 0;
+    for (int node = goalNode; node >= 0 && node != startNode && len < PATH_CHUNK_WINDOW * 2;
+         node = pf->parent[node]) {
+        chain[len++] = node;
+    }
+    path->corridorCount = 0;
+    path->corridorNext  = 0;
+    Vector2 last = start;
+    for (int i = len - 1; i >= 1 && path->corridorCount < PATH_MAX_CORRIDOR - 1; i--) {
+        int node = chain[i], nextNode = chain[i - 1];
+        Vector2 p    = { (node % w + ox + 0.5f) * CHUNK_SIZE, (node / w + oy + 0.5f) * CHUNK_SIZE };
+        Vector2 pn   = { (nextNode % w + ox + 0.5f) * CHUNK_SIZE, (nextNode / w + oy + 0.5f) * CHUNK_SIZE };
+        Vector2 dIn  = Vector2Subtract(p, last), dOut = Vector2Subtract(pn, p);
+        bool turn    = fabsf(dIn.x * dOut.y - dIn.y * dOut.x) > 1.0f;
+        if (turn || Vector2Distance(last, pn) > PATH_LOCAL_RANGE) {
+            path->corridor[path->corridorCount++] = p;
+            last = p;
+        }
+    }
+    path->corridor[path->corridorCount++] = goal;
+}
+
+bool PlanPath(Path *path, PathFinder *pf, ChunkCache *cache, Vector2 start, Vector2 goal)
+{
+    path->active = false;
+    if (Vector2Distance(start, goal) > PATH_LOCAL_RANGE) {
+        PlanChunkCorridor(path, pf, cache, start, goal);
+    } else {
+        path->corridor[0]   = goal;
+        path->corridorCount = 1;
+        path->corridorNext  = 0;
+    }
+    path->count   = FindPathLocal(pf, cache->collision, start, path->corridor[0],
+                                  path->points, PATH_MAX_POINTS);
+    path->next    = 0;
+    path->version = cache->collision->version;
+    path->active  = path->count > 0;
+    return path->active;
+}
+
+// Any remaining leg segment (from pos on) now crosses a collider?
+static bool PathLegBlocked(Path *path, CollisionWorld *world, Vector2 pos)
+{
+    Vector2 a = pos;
+    for (int i = path->next; i < path->count; i++) {
+        Vector2 b = path->points[i];
+        float len = Vector2Distance(a, b);
+        int steps = (int)(len / (PATH_CELL_SIZE * 0.5f)) + 1;
+        for (int s = 1; s <= steps; s++) {
+            if (PointBlocked(world, Vector2Lerp(a, b, (float)s / steps), PLAYER_RADIUS * 0.75f)) return true;
+        }
+        a = b;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// FollowPath  — steer along the active path. Returns false once arrived (or
+// if the route cannot be repaired). When colliders change, only the current
+// leg is re-checked and, if blocked, re-planned from pos to the leg's end.
+// ---------------------------------------------------------------------------
+bool FollowPath(Path *path, PathFinder *pf, CollisionWorld *world, Vector2 pos,
+                float stepLen, Vector2 *dirOut)
+{
+    if (!path->active) return false;
+
+    if (path->version != world->version) {
+        path->version = world->version;
+        if (PathLegBlocked(path, world, pos)) {
+            path->count = FindPathLocal(pf, world, pos, path->corridor[path->corridorNext],
+                                        path->points, PATH_MAX_POINTS);
+            path->next  = 0;
+            if (path->count == 0) { path->active = false; return false; }
+        }
+    }
+
+    for (;;) {
+        Vector2 target = path->points[path->next];
+        bool lastOfLeg = (path->next == path->count - 1);
+        bool lastOfAll = lastOfLeg && path->corridorNext == path->corridorCount - 1;
+        float dist = Vector2Distance(pos, target);
+        // Corridor waypoints are only guidance, so pass them loosely
+        float reach = lastOfAll ? PATH_ARRIVE_RADIUS
+                    : lastOfLeg ? PATH_CELL_SIZE * 2.0f
+                    : fmaxf(PATH_ARRIVE_RADIUS, stepLen);
+        if (dist > reach) {
+            *dirOut = Vector2Scale(Vector2Subtract(target, pos), 1.0f / dist);
+            return true;
+        }
+        if (lastOfAll) { path->active = false; return false; }
+        if (!lastOfLeg) { path->next++; continue; }
+
+        // Leg done: refine the next corridor waypoint
+        path->corridorNext++;
+        path->count = FindPathLocal(pf, world, pos, path->corridor[path->corridorNext],
+                                    path->points, PATH_MAX_POINTS);
+        path->next  = 0;
+        if (path->count == 0) { path->active = false; return false; }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// DrawPathRoute  (world space) — faint line through the remaining waypoints
+// of the current leg, then the corridor, with a ring at the destination
+// ---------------------------------------------------------------------------
+void DrawPathRoute(Path *path, Vector2 playerPos, float zoom, float pulseTimer)
+{
+    if (!path->active) return;
+    Color col = Fade(COL_Z_SCARF, 0.35f);
+    float thick = 2.0f / zoom;
+    Vector2 a = playerPos;
+    for (int i = path->next; i < path->count; i++) {
+        DrawLineEx(a, path->points[i], thick, col);
+        a = path->points[i];
+    }
+    for (int i = path->corridorNext + 1; i < path->corridorCount; i++) {
+        DrawLineEx(a, path->corridor[i], thick, Fade(col, 0.5f));
+        a = path->corridor[i];
+    }
+    float r = (8.0f + 2.0f * sinf(pulseTimer * 4.0f)) / fminf(zoom, 1.0f);
+    DrawRing(path->corridor[path->corridorCount - 1], r - thick, r, 0.0f, 360.0f, 24, col);
+}
+
+// ---------------------------------------------------------------------------
+// Flow fields  — one per goal, over a FLOW_GRID square around the village.
+// A field is marked stale whenever the colliders change (and the items field
+// on a timer) and rebuilt as deferred work: breadth-first integration and
+// direction assignment run in FLOW_BUILD_SLICE steps within the frame
+// scheduler's slack, and the finished field is swapped in at the end.
+// ---------------------------------------------------------------------------
+static const signed char FLOW_DX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const signed char FLOW_DY[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const Vector2 FLOW_DIR_VEC[8] = {
+    { 1.0f, 0.0f }, { 0.7071f, 0.7071f }, { 0.0f, 1.0f }, { -0.7071f, 0.7071f },
+    { -1.0f, 0.0f }, { -0.7071f, -0.7071f }, { 0.0f, -1.0f }, { 0.7071f, -0.7071f }
+};
+
+void InitFlowFields(FlowFields *ff)
+{
+    memset(ff, 0, sizeof(*ff));
+    ff->originX  = VILLAGE_X - FLOW_GRID * FLOW_CELL_SIZE / 2.0f;
+    ff->originY  = VILLAGE_Y - FLOW_GRID * FLOW_CELL_SIZE / 2.0f;
+    ff->building = -1;
+    ff->rasterVersion = ff->seenVersion = (unsigned int)-1;
+    for (int f = 0; f < NUM_FLOW_FIELDS; f++) {
+        memset(ff->fields[f].dir, FLOW_DIR_NONE, sizeof(ff->fields[f].dir));
+        ff->fields[f].dirty = true;
+    }
+    memset(ff->goalItem, 0xFF, sizeof(ff->goalItem));
+}
+
+// Flow cell containing a world position, or -1 outside the grid
+static int FlowCellAt(FlowFields *ff, float x, float y)
+{
+    int gx = (int)floorf((x - ff->originX) / FLOW_CELL_SIZE);
+    int gy = (int)floorf((y - ff->originY) / FLOW_CELL_SIZE);
+    if (gx < 0 || gy < 0 || gx >= FLOW_GRID || gy >= FLOW_GRID) return -1;
+    return gy * FLOW_GRID + gx;
+}
+
+// Any cell a (slightly inflated) collider overlaps is blocked
+static void RasterizeFlowGrid(FlowFields *ff, CollisionWorld *world)
+{
+    memset(ff->blocked, 0, sizeof(ff->blocked));
+    float span = (float)FLOW_GRID * FLOW_CELL_SIZE;
+    int x0, y0, x1, y1;
+    CollisionCellRange((Rectangle){ ff->originX, ff->originY, span, span }, &x0, &y0, &x1, &y1);
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            CollisionCell *cell = &world->cells[CollisionCellSlot(world, cx, cy)];
+            for (int k = 0; k < cell->count; k++) {
+                Rectangle b = world->colliders[cell->ids[k]].box;
+                int gx0 = (int)floorf((b.x - SCAV_RADIUS - ff->originX) / FLOW_CELL_SIZE);
+                int gy0 = (int)floorf((b.y - SCAV_RADIUS - ff->originY) / FLOW_CELL_SIZE);
+                int gx1 = (int)floorf((b.x + b.width  + SCAV_RADIUS - ff->originX) / FLOW_CELL_SIZE);
+                int gy1 = (int)floorf((b.y + b.height + SCAV_RADIUS - ff->originY) / FLOW_CELL_SIZE);
+                if (gx0 < 0) gx0 = 0;
+                if (gy0 < 0) gy0 = 0;
+                if (gx1 > FLOW_GRID - 1) gx1 = FLOW_GRID - 1;
+                if (gy1 > FLOW_GRID - 1) gy1 = FLOW_GRID - 1;
+                for (int gy = gy0; gy <= gy1; gy++) {
+                    for (int gx = gx0; gx <= gx1; gx++) ff->blocked[gy * FLOW_GRID + gx] = 1;
+                }
+            }
+        }
+    }
+    ff->rasterVersion = world->version;
+}
+
+static void SeedFlowCell(FlowFields *ff, int cell)
+{
+    if (cell < 0 || ff->cost[cell] == 0) return;
+    ff->cost[cell] = 0;
+    ff->queue[ff->tail++] = cell;
+}
+
+// Goal cells: walkable cells whose center lies within radius of a point
+static void SeedFlowArea(FlowFields *ff, Vector2 center, float radius)
+{
+    int c0 = FlowCellAt(ff, center.x - radius, center.y - radius);
+    int c1 = FlowCellAt(ff, center.x + radius, center.y + radius);
+    if (c0 < 0 || c1 < 0) return;
+    for (int gy = c0 / FLOW_GRID; gy <= c1 / FLOW_GRID; gy++) {
+        for (int gx = c0 % FLOW_GRID; gx <= c1 % FLOW_GRID; gx++) {
+            Vector2 p = { ff->originX + (gx + 0.5f) * FLOW_CELL_SIZE, ff->originY + (gy + 0.5f) * FLOW_CELL_SIZE };
+            int cell = gy * FLOW_GRID + gx;
+            if (!ff->blocked[cell] && Vector2Distance(p, center) <= radius) SeedFlowCell(ff, cell);
+        }
+    }
+}
+
+static void StartFlowBuild(FlowFields *ff, ChunkCache *cache, int f)
+{
+    if (ff->rasterVersion != cache->collision->version) RasterizeFlowGrid(ff, cache->collision);
+    int back = 1 - ff->fields[f].front;
+    memset(ff->cost, 0xFF, sizeof(ff->cost));
+    ff->head = ff->tail = 0;
+
+    if (f == FLOW_VILLAGE) {
+        SeedFlowArea(ff, (Vector2){ VILLAGE_X, VILLAGE_Y }, FLOW_VILLAGE_RADIUS);
+    } else if (f == FLOW_GATE) {
+        SeedFlowArea(ff, (Vector2){ GATE_X, GATE_Y }, FLOW_GATE_RADIUS);
+    } else {
+        memset(ff->goalItem[back], 0xFF, sizeof(ff->goalItem[back]));
+        for (int c = 0; c < MAX_LOADED_CHUNKS; c++) {
+            Chunk *ch = &cache->chunks[c];
+            if (!ch->loaded) continue;
+            for (int i = 0; i < ch->numItems; i++) {
+                if (!ch->items[i].active) continue;
+                int cell = FlowCellAt(ff, ch->items[i].position.x, ch->items[i].position.y);
+                if (cell < 0) continue;
+                SeedFlowCell(ff, cell);
+                ff->goalItem[back][cell] = c * CHUNK_MAX_ITEMS + i;
+            }
+        }
+    }
+    ff->building  = f;
+    ff->phase     = 0;
+    ff->dirCursor = 0;
+}
+
+// Advance the current rebuild by up to budget cells; returns cells used
+static int StepFlowBuild(FlowFields *ff, int budget)
+{
+    FlowField *field = &ff->fields[ff->building];
+    int back = 1 - field->front;
+    int used = 0;
+
+    // Integration: 4-neighbour breadth-first distance from the goal cells
+    while (ff->phase == 0 && used < budget) {
+        if (ff->head == ff->tail) { ff->phase = 1; break; }
+        int cell = ff->queue[ff->head++];
+        int gx = cell % FLOW_GRID, gy = cell / FLOW_GRID;
+        unsigned short next = (unsigned short)(ff->cost[cell] + 1);
+        if (gx > 0             && !ff->blocked[cell - 1]         && ff->cost[cell - 1] == 0xFFFF)         { ff->cost[cell - 1] = next;         ff->queue[ff->tail++] = cell - 1; }
+        if (gx < FLOW_GRID - 1 && !ff->blocked[cell + 1]         && ff->cost[cell + 1] == 0xFFFF)         { ff->cost[cell + 1] = next;         ff->queue[ff->tail++] = cell + 1; }
+        if (gy > 0             && !ff->blocked[cell - FLOW_GRID] && ff->cost[cell - FLOW_GRID] == 0xFFFF) { ff->cost[cell - FLOW_GRID] = next; ff->queue[ff->tail++] = cell - FLOW_GRID; }
+        if (gy < FLOW_GRID - 1 && !ff->blocked[cell + FLOW_GRID] && ff->cost[cell + FLOW_GRID] == 0xFFFF) { ff->cost[cell + FLOW_GRID] = next; ff->queue[ff->tail++] = cell + FLOW_GRID; }
+        used++;
+    }
+
+    // Directions: steepest descent over 8 neighbours, no corner cutting.
+    // Blocked and unreached cells point at their cheapest neighbour so
+    // anything pushed into a wall finds its way back out.
+    while (ff->phase == 1 && used < budget) {
+        if (ff->dirCursor == FLOW_CELLS) {
+            field->front = back;
+            ff->building = -1;     // dirty again if the goal or colliders changed mid-build
+            break;
+        }
+        int cell = ff->dirCursor++;
+        int gx = cell % FLOW_GRID, gy = cell / FLOW_GRID;
+        unsigned char dir = FLOW_DIR_NONE;
+        if (ff->cost[cell] == 0) {
+            dir = FLOW_DIR_GOAL;
+        } else {
+            unsigned short best = ff->cost[cell];
+            for (int d = 0; d < 8; d++) {
+                int nx = gx + FLOW_DX[d], ny = gy + FLOW_DY[d];
+                if (nx < 0 || ny < 0 || nx >= FLOW_GRID || ny >= FLOW_GRID) continue;
+                unsigned short nc = ff->cost[ny * FLOW_GRID + nx];
+                if (nc >= best) continue;
+                if ((d & 1) && (ff->blocked[gy * FLOW_GRID + nx] || ff->blocked[ny * FLOW_GRID + gx])) continue;
+                best = nc;
+                dir  = (unsigned char)d;
+            }
+        }
+        field->dir[back][cell] = dir;
+        used++;
+    }
+    return used;
+}
+
+void UpdateFlowFields(FlowFields *ff, ChunkCache *cache, float dt)
+{
+    ff->itemTimer -= dt;
+    if (ff->itemTimer <= 0.0f) {
+        ff->itemTimer = FLOW_ITEM_REFRESH;
+        ff->fields[FLOW_ITEMS].dirty = true;
+    }
+    if (ff->seenVersion != cache->collision->version) {
+        ff->seenVersion = cache->collision->version;
+        for (int f = 0; f < NUM_FLOW_FIELDS; f++) ff->fields[f].dirty = true;
+    }
+}
+
+// Rebuild stale fields, a slice at a time, until the deadline (at least one
+// slice per call). Returns true while a field is still stale or half built.
+bool BuildFlowFields(FlowFields *ff, ChunkCache *cache, double deadline)
+{
+    do {
+        if (ff->building < 0) {
+            int f = 0;
+            while (f < NUM_FLOW_FIELDS && !ff->fields[f].dirty) f++;
+            if (f == NUM_FLOW_FIELDS) return false;
+            StartFlowBuild(ff, cache, f);
+            ff->fields[f].dirty = false;
+        }
+        StepFlowBuild(ff, FLOW_BUILD_SLICE);
+    } while (GetTime() < deadline);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Scavengers  — the crowd is kept sorted by sector, and each sector is
+// simulated at its sim-LOD stride: agents advance by the time since they
+// were last touched, then re-read the flow fields. Frozen sectors cost
+// nothing; their agents catch up in one step when they come back into range.
+// ---------------------------------------------------------------------------
+static int ScavengerSector(float x, float y)
+{
+    float originX = VILLAGE_X - FLOW_GRID * FLOW_CELL_SIZE / 2.0f;
+    float originY = VILLAGE_Y - FLOW_GRID * FLOW_CELL_SIZE / 2.0f;
+    int sx = (int)floorf((x - originX) / SCAV_SECTOR_SIZE);
+    int sy = (int)floorf((y - originY) / SCAV_SECTOR_SIZE);
+    if (sx < 0) sx = 0;
+    if (sy < 0) sy = 0;
+    if (sx > SCAV_SECTORS - 1) sx = SCAV_SECTORS - 1;
+    if (sy > SCAV_SECTORS - 1) sy = SCAV_SECTORS - 1;
+    return sy * SCAV_SECTORS + sx;
+}
+
+static Rectangle ScavengerSectorBounds(int s)
+{
+    float originX = VILLAGE_X - FLOW_GRID * FLOW_CELL_SIZE / 2.0f;
+    float originY = VILLAGE_Y - FLOW_GRID * FLOW_CELL_SIZE / 2.0f;
+    return (Rectangle){ originX + (s % SCAV_SECTORS) * (float)SCAV_SECTOR_SIZE,
+                        originY + (s / SCAV_SECTORS) * (float)SCAV_SECTOR_SIZE,
+                        SCAV_SECTOR_SIZE, SCAV_SECTOR_SIZE };
+}
+
+// Permute one crowd array (elemSize bytes per agent) into sector order
+static void PermuteScavengerArray(ScavengerCrowd *crowd, void *array, size_t elemSize)
+{
+    unsigned char *src = array, *tmp = (unsigned char *)crowd->scratch;
+    for (int k = 0; k < crowd->count; k++) {
+        memcpy(tmp + k * elemSize, src + (size_t)crowd->order[k] * elemSize, elemSize);
+    }
+    memcpy(array, tmp, elemSize * (size_t)crowd->count);
+}
+
+// Counting sort of the crowd by sector
+static void BinScavengers(ScavengerCrowd *crowd)
+{
+    int counts[SCAV_SECTORS * SCAV_SECTORS + 1] = { 0 };
+    for (int i = 0; i < crowd->count; i++) counts[ScavengerSector(crowd->x[i], crowd->y[i]) + 1]++;
+    for (int s = 0; s < SCAV_SECTORS * SCAV_SECTORS; s++) counts[s + 1] += counts[s];
+    memcpy(crowd->sectorStart, counts, sizeof(crowd->sectorStart));
+    for (int i = 0; i < crowd->count; i++) crowd->order[counts[ScavengerSector(crowd->x[i], crowd->y[i])]++] = i;
+
+    PermuteScavengerArray(crowd, crowd->x, sizeof(crowd->x[0]));
+    PermuteScavengerArray(crowd, crowd->y, sizeof(crowd->y[0]));
+    PermuteScavengerArray(crowd, crowd->vx, sizeof(crowd->vx[0]));
+    PermuteScavengerArray(crowd, crowd->vy, sizeof(crowd->vy[0]));
+    PermuteScavengerArray(crowd, crowd->speed, sizeof(crowd->speed[0]));
+    PermuteScavengerArray(crowd, crowd->timer, sizeof(crowd->timer[0]));
+    PermuteScavengerArray(crowd, crowd->state, sizeof(crowd->state[0]));
+    PermuteScavengerArray(crowd, crowd->home, sizeof(crowd->home[0]));
+    PermuteScavengerArray(crowd, crowd->cargo, sizeof(crowd->cargo[0]));
+    PermuteScavengerArray(crowd, crowd->simTime, sizeof(crowd->simTime[0]));
+}
+
+void InitScavengers(ScavengerCrowd *crowd, int count, unsigned long long seed)
+{
+    memset(crowd, 0, sizeof(*crowd));
+    crowd->count = (count < NUM_SCAVENGERS) ? count : NUM_SCAVENGERS;
+    crowd->rng.state = (unsigned int)(HashSeed(seed, 0x53434156u) | 1u);
+    float span = FLOW_GRID * FLOW_CELL_SIZE;
+    for (int i = 0; i < crowd->count; i++) {
+        crowd->x[i]     = VILLAGE_X - span / 2.0f + (float)RngRange(&crowd->rng, 0, (int)span - 1);
+        crowd->y[i]     = VILLAGE_Y - span / 2.0f + (float)RngRange(&crowd->rng, 0, (int)span - 1);
+        crowd->speed[i] = SCAV_SPEED * (0.8f + RngRange(&crowd->rng, 0, 400) / 1000.0f);
+        crowd->timer[i] = (float)RngRange(&crowd->rng, 0, 20000) / 1000.0f;
+        crowd->state[i] = SCAV_WANDER;
+        crowd->home[i]  = (RngRange(&crowd->rng, 0, 4) == 0) ? FLOW_GATE : FLOW_VILLAGE;
+    }
+    BinScavengers(crowd);
+}
+
+static void ScavengerWander(ScavengerCrowd *crowd, int i, float minTime, float maxTime)
+{
+    crowd->state[i] = SCAV_WANDER;
+    crowd->timer[i] = minTime + (maxTime - minTime) * RngRange(&crowd->rng, 0, 1000) / 1000.0f;
+    Vector2 v = FLOW_DIR_VEC[RngRange(&crowd->rng, 0, 7)];
+    crowd->vx[i] = v.x * crowd->speed[i] * 0.5f;
+    crowd->vy[i] = v.y * crowd->speed[i] * 0.5f;
+}
+
+static void ScavengerThink(ScavengerCrowd *crowd, FlowFields *ff, ChunkCache *cache, int i)
+{
+    int cell = FlowCellAt(ff, crowd->x[i], crowd->y[i]);
+    if (cell < 0) {
+        // Strayed off the grid: head straight back toward the village
+        Vector2 d = Vector2Normalize((Vector2){ VILLAGE_X - crowd->x[i], VILLAGE_Y - crowd->y[i] });
+        crowd->vx[i] = d.x * crowd->speed[i];
+        crowd->vy[i] = d.y * crowd->speed[i];
+        return;
+    }
+
+    if (crowd->state[i] == SCAV_WANDER) {
+        if (crowd->timer[i] <= 0.0f) crowd->state[i] = SCAV_SEEK;
+        else if (RngRange(&crowd->rng, 0, 15) == 0) ScavengerWander(crowd, i, crowd->timer[i], crowd->timer[i]);
+        return;
+    }
+
+    FlowField *field = &ff->fields[crowd->state[i] == SCAV_SEEK ? FLOW_ITEMS : crowd->home[i]];
+    unsigned char dir = field->dir[field->front][cell];
+    if (dir == FLOW_DIR_GOAL) {
+        if (crowd->state[i] == SCAV_RETURN) {
+            // Dropped the loot off; rest a while before heading out again
+            crowd->cargo[i] = 0;
+            ScavengerWander(crowd, i, 8.0f, 20.0f);
+            return;
+        }
+        // Reached an item cell: take it if nobody beat us to it
+        int ref = ff->goalItem[field->front][cell];
+        if (ref >= 0) {
+            Chunk *ch = &cache->chunks[ref / CHUNK_MAX_ITEMS];
+            WorldItem *item = &ch->items[ref % CHUNK_MAX_ITEMS];
+            if (ch->loaded && item->active && FlowCellAt(ff, item->position.x, item->position.y) == cell) {
+                crowd->cargo[i] = (unsigned short)(item->typeIndex + 1);
+                crowd->state[i] = SCAV_RETURN;
+                item->active = false;
+                item->respawnTimer = 60.0f + (float)RngRange(&crowd->rng, 0, 30);
+                ch->modifiedMask |= (unsigned char)(1u << (ref % CHUNK_MAX_ITEMS));
+                ch->journalMask  |= (unsigned char)(1u << (ref % CHUNK_MAX_ITEMS));
+                ch->minimapDirty  = true;
+                return;
+            }
+        }
+        ScavengerWander(crowd, i, 2.0f, 5.0f);
+    } else if (dir == FLOW_DIR_NONE) {
+        // No reachable goal right now
+        if (crowd->state[i] == SCAV_SEEK) ScavengerWander(crowd, i, 3.0f, 8.0f);
+        else crowd->vx[i] = crowd->vy[i] = 0.0f;
+    } else {
+        crowd->vx[i] = FLOW_DIR_VEC[dir].x * crowd->speed[i];
+        crowd->vy[i] = FLOW_DIR_VEC[dir].y * crowd->speed[i];
+    }
+}
+
+void UpdateScavengers(ScavengerCrowd *crowd, FlowFields *ff, ChunkCache *cache, const SimLod *lod)
+{
+    if (crowd->count == 0) return;
+
+    // Re-bin once per far-ring period; agents drift only a few px in between
+    if (lod->tick % SIM_LOD_FAR_STRIDE == 0) BinScavengers(crowd);
+
+    double start = GetTime();
+    const int numSectors = SCAV_SECTORS * SCAV_SECTORS;
+    for (int k = 0; k < numSectors; k++) {
+        int s = (crowd->sectorCursor + k) % numSectors;
+        int first = crowd->sectorStart[s], last = crowd->sectorStart[s + 1];
+        if (first == last) continue;
+        if (!crowd->sectorOverdue[s] && !SimLodDue(lod, SimLodStride(lod, ScavengerSectorBounds(s)), s)) continue;
+        crowd->sectorOverdue[s] = false;
+
+        float *x = crowd->x, *y = crowd->y, *timer = crowd->timer;
+        const float *vx = crowd->vx, *vy = crowd->vy;
+        double *simTime = crowd->simTime;
+        for (int i = first; i < last; i++) {
+            float dt = (float)(lod->clock - simTime[i]);
+            float moveDt = fminf(dt, SCAV_CATCHUP_MAX);
+            x[i] += vx[i] * moveDt;
+            y[i] += vy[i] * moveDt;
+            timer[i] -= dt;
+            simTime[i] = lod->clock;
+        }
+        for (int i = first; i < last; i++) ScavengerThink(crowd, ff, cache, i);
+
+        // Out of budget: the sectors left over that were due stay due, and
+        // the next update starts with them; their agents catch up by their
+        // own simTime
+        if ((GetTime() - start) * 1000.0 > SCAV_BUDGET_MS) {
+            for (int j = k + 1; j < numSectors; j++) {
+                int r = (crowd->sectorCursor + j) % numSectors;
+                if (crowd->sectorStart[r] == crowd->sectorStart[r + 1]) continue;
+                if (SimLodDue(lod, SimLodStride(lod, ScavengerSectorBounds(r)), r)) crowd->sectorOverdue[r] = true;
+            }
+            crowd->sectorCursor = (s + 1) % numSectors;
+            break;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// DrawScavengers  (world space) — robed figures carrying their loot; a dot
+// each once they would be only a few pixels tall
+// ---------------------------------------------------------------------------
+void DrawScavengers(const ScavengerSprite *sprites, int count, float zoom)
+{
+    bool dots = (zoom * 14.0f < LOD_POINT_SPRITE_PX);
+    for (int i = 0; i < count; i++) {
+        float x = sprites[i].x, y = sprites[i].y;
+        if (dots) {
+            float s = 2.0f / zoom;
+            DrawRectangleRec((Rectangle){ x - s / 2, y - s / 2, s, s }, COL_SCAV_ROBE);
+            continue;
+        }
+        DrawEllipse((int)x + 2, (int)y + 7, 6.0f, 3.0f, COL_SHADOW);
+        DrawCircleV((Vector2){ x, y }, 6.0f, COL_SCAV_ROBE);
+        DrawCircleV((Vector2){ x, y - 6.0f }, 3.5f, COL_SCAV_HEAD);
+        if (sprites[i].cargo) {
+            DrawCircleV((Vector2){ x + 5.0f, y + 1.0f }, 3.0f, itemTable.types[sprites[i].cargo - 1].color);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Parallel update phases  — bodies run on the job pool each tick. Phases
+// touch disjoint state except that scavengers pick up chunk items, so they
+// are queued behind the item timers. Storm particles run as one job because
+// they share an RNG.
+// ---------------------------------------------------------------------------
+static void ParticlesPhase(void *data, int begin, int end)
+{
+    FramePhases *f = data;
+    UpdateParticles(&f->particles[begin], end - begin, f->particleCenter, f->particleFieldScale, f->dt);
+}
+
+static void StormParticlesPhase(void *data, int begin, int end)
+{
+    FramePhases *f = data;
+    for (int i = begin; i < end; i++) {
+        StormParticle *p = &f->stormParticles[i];
+        p->x -= p->speed * f->dt;
+        if (p->x + p->length < 0) {
+            p->x = (float)(f->screenWidth + 10);
+            p->y = (float)RngRange(f->stormRng, 0, f->screenHeight);
+        }
+    }
+}
+
+static void EffectPoolsPhase(void *data, int begin, int end)
+{
+    (void)begin;
+    (void)end;
+    FramePhases *f = data;
+    for (int i = 0; i < MAX_FOOTPRINTS; i++) {
+        Footprint *fp = &f->footprints[i];
+        if (!fp->active) continue;
+        fp->timer -= f->dt;
+        fp->alpha = (fp->timer / 4.0f) * 120.0f;
+        if (fp->timer <= 0.0f) fp->active = false;
+    }
+    for (int i = 0; i < MAX_DUST_PUFFS; i++) {
+        DustPuff *dp = &f->dustPuffs[i];
+        if (!dp->active) continue;
+        dp->timer -= f->dt;
+        if (dp->timer <= 0.0f) dp->active = false;
+    }
+}
+
+// Item respawn and shimmer timers for chunk slots [begin, end), each chunk
+// advanced at its sim-LOD rate
+static void ItemTimersPhase(void *data, int begin, int end)
+{
+    FramePhases *f = data;
+    const SimLod *lod = f->lod;
+    for (int c = begin; c < end; c++) {
+        Chunk *ch = &f->cache->chunks[c];
+        if (!ch->loaded) continue;
+        if (ch->simTime < 0.0) ch->simTime = lod->clock;
+        Rectangle bounds = { (float)ch->cx * CHUNK_SIZE, (float)ch->cy * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE };
+        if (!SimLodDue(lod, SimLodStride(lod, bounds), c)) continue;
+        float chunkDt = (float)(lod->clock - ch->simTime);
+        ch->simTime = lod->clock;
+        for (int i = 0; i < ch->numItems; i++) {
+            WorldItem *item = &ch->items[i];
+            if (item->active) continue;
+            if (item->respawnTimer <= 0.0f) continue;
+            item->respawnTimer -= chunkDt;
+            if (item->respawnTimer <= 0.0f) {
+                // Placement is deferred work (DeferredPlaceRespawns)
+                item->respawnTimer  = 0.0f;
+                ch->pendingRespawn |= (unsigned char)(1u << i);
+            }
+        }
+        for (int i = 0; i < ch->numItems; i++) {
+            if (!ch->shimmers[i].active) continue;
+            ch->shimmers[i].timer -= chunkDt;
+            if (ch->shimmers[i].timer <= 0.0f) {
+                ch->shimmers[i].timer  = 0.0f;
+                ch->shimmers[i].active = false;
+            }
+        }
+    }
+}
+
+// One job: the crowd shares its RNG and item pickups across all agents
+static void ScavengersPhase(void *data, int begin, int end)
+{
+    (void)begin;
+    (void)end;
+    FramePhases *f = data;
+    UpdateScavengers(f->crowd, f->flow, f->cache, f->lod);
+}
+
+void RunUpdatePhases(JobSystem *js, FramePhases *phases, bool updateParticles, bool updateStorm)
+{
+    JobCounter itemsDone, allDone;
+    InitJobCounter(&itemsDone);
+    InitJobCounter(&allDone);
+    ParallelFor(js, ItemTimersPhase, phases, MAX_LOADED_CHUNKS, 32, &itemsDone);
+    RunJobAfter(js, &itemsDone, ScavengersPhase, phases, 0, 0, &allDone);
+    if (updateParticles) ParallelFor(js, ParticlesPhase, phases, NUM_PARTICLES, 256, &allDone);
+    if (updateStorm) RunJob(js, StormParticlesPhase, phases, 0, MAX_STORM_PARTICLES, &allDone);
+    RunJob(js, EffectPoolsPhase, phases, 0, 0, &allDone);
+    // Both counters live in this frame: wait on each so no worker still holds one
+    WaitForJobs(js, &itemsDone);
+    WaitForJobs(js, &allDone);
+}
+
+// ---------------------------------------------------------------------------
+// BuildRenderList  — cull chunks and scavengers against the view in parallel
+// into per-index flags, then compact serially so draw order stays stable
+// ---------------------------------------------------------------------------
+static void CullChunksPhase(void *data, int begin, int end)
+{
+    RenderList *list = data;
+    for (int c = begin; c < end; c++) {
+        const Chunk *ch = &list->cache->chunks[c];
+        list->chunkVisible[c] = ch->loaded && ChunkInView(ch, list->view, RENDER_CHUNK_PAD);
+    }
+}
+
+static void CullScavengersPhase(void *data, int begin, int end)
+{
+    RenderList *list = data;
+    Rectangle v = list->view;
+    const float *x = list->crowd->x, *y = list->crowd->y;
+    for (int i = begin; i < end; i++) {
+        list->scavengerVisible[i] = x[i] >= v.x - 16 && y[i] >= v.y - 16 &&
+                                    x[i] <= v.x + v.width + 16 && y[i] <= v.y + v.height + 16;
+    }
+}
+
+void BuildRenderList(RenderList *list, JobSystem *js, ChunkCache *cache, ScavengerCrowd *crowd,
+                     Rectangle view)
+{
+    list->view  = view;
+    list->cache = cache;
+    list->crowd = crowd;
+    JobCounter done;
+    InitJobCounter(&done);
+    ParallelFor(js, CullChunksPhase, list, MAX_LOADED_CHUNKS, 64, &done);
+    ParallelFor(js, CullScavengersPhase, list, crowd->count, 1024, &done);
+    WaitForJobs(js, &done);
+
+    list->numChunks = 0;
+    for (int c = 0; c < MAX_LOADED_CHUNKS; c++) {
+        if (list->chunkVisible[c]) list->chunks[list->numChunks++] = c;
+    }
+    list->numScavengers = 0;
+    for (int i = 0; i < crowd->count; i++) {
+        if (list->scavengerVisible[i]) list->scavengers[list->numScavengers++] = i;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Frame scheduler  — cooperative, single-threaded. Each frame the pending
+// jobs share the slack left after FRAME_BUDGET_MS minus the frame's own CPU
+// work (moving average, measured between Begin/EndSchedulerFrame minus the
+// scheduler itself). Jobs run in priority order; one starved for
+// DEFERRED_STARVE_FRAMES gets a minimal slice even without slack.
+// ---------------------------------------------------------------------------
+void InitFrameScheduler(FrameScheduler *sched)
+{
+    memset(sched, 0, sizeof(*sched));
+    sched->workMs = FRAME_BUDGET_MS * 0.5;
+}
+
+void AddDeferredJob(FrameScheduler *sched, const char *name, DeferredFn fn, void *ctx)
+{
+    if (sched->count >= DEFERRED_MAX_JOBS) return;
+    sched->jobs[sched->count++] = (DeferredJob){ name, fn, ctx, 0 };
+}
+
+void BeginSchedulerFrame(FrameScheduler *sched)
+{
+    sched->frameStart = GetTime();
+    sched->spentMs    = 0.0;
+}
+
+void RunDeferredJobs(FrameScheduler *sched)
+{
+    double start    = GetTime();
+    double slackMs  = FRAME_BUDGET_MS - FRAME_SAFETY_MS - sched->workMs;
+    double deadline = start + fmax(slackMs, 0.0) / 1000.0;
+
+    for (int i = 0; i < sched->count; i++) {
+        DeferredJob *job = &sched->jobs[i];
+        double now = GetTime();
+        double jobDeadline = deadline;
+        if (now >= deadline) {
+            // Out of slack: only jobs that have waited too long get a turn
+            // (idle ones too, or they would never notice new work)
+            if (job->skippedFrames < DEFERRED_STARVE_FRAMES) {
+                job->skippedFrames++;
+                continue;
+            }
+            jobDeadline = now + DEFERRED_MIN_SLICE_MS / 1000.0;
+        }
+        job->fn(job->ctx, jobDeadline);
+        job->skippedFrames = 0;
+    }
+    sched->spentMs += (GetTime() - start) * 1000.0;
+}
+
+void EndSchedulerFrame(FrameScheduler *sched)
+{
+    double frameMs = (GetTime() - sched->frameStart) * 1000.0 - sched->spentMs;
+    sched->workMs += (frameMs - sched->workMs) * FRAME_WORK_SMOOTHING;
+}
+
+// Deferred world jobs (ctx is the DeferredWorld), in priority order
+bool DeferredFinalizeChunks(void *ctx, double deadline)
+{
+    DeferredWorld *w = ctx;
+    return FinalizeChunks(w->cache, w->streamer, 0, deadline);
+}
+
+bool DeferredPlaceRespawns(void *ctx, double deadline)
+{
+    DeferredWorld *w = ctx;
+    for (int c = 0; c < MAX_LOADED_CHUNKS; c++) {
+        Chunk *ch = &w->cache->chunks[c];
+        if (!ch->loaded) continue;
+        for (int i = 0; ch->pendingRespawn != 0 && i < ch->numItems; i++) {
+            if (!(ch->pendingRespawn & (1u << i))) continue;
+            if (GetTime() >= deadline) return true;
+            PlaceRespawnedItem(ch, i, &w->cache->rng);
+        }
+    }
+    return false;
+}
+
+bool DeferredBuildFlowFields(void *ctx, double deadline)
+{
+    DeferredWorld *w = ctx;
+    return BuildFlowFields(w->flow, w->cache, deadline);
+}
+
+bool DeferredUpdateMinimap(void *ctx, double deadline)
+{
+    DeferredWorld *w = ctx;
+    if (!w->minimap->open) return false;
+    return UpdateMinimap(w->minimap, w->cache, w->spr, w->playerPos, deadline);
+}
+
+// ---------------------------------------------------------------------------
+// Village and gate footprints, shared by drawing and collision
+// ---------------------------------------------------------------------------
+void VillageBuildingRects(Rectangle out[NUM_VILLAGE_BUILDINGS])
+{
+    // Building rectangles remain IDENTICAL to original (WORKBENCH_X/Y depends on building1)
+    out[0] = (Rectangle){ VILLAGE_X - 100, VILLAGE_Y - 80, 80, 60 };
+    out[1] = (Rectangle){ VILLAGE_X + 40,  VILLAGE_Y - 60, 70, 50 };
+    out[2] = (Rectangle){ VILLAGE_X - 80,  VILLAGE_Y + 40, 60, 55 };
+    out[3] = (Rectangle){ VILLAGE_X + 50,  VILLAGE_Y + 50, 65, 50 };
+}
+
+void GatePillarRects(Rectangle out[2])
+{
+    out[0] = (Rectangle){ GATE_X - 10, GATE_Y - 60, 20, 80 };
+    out[1] = (Rectangle){ GATE_X + 50, GATE_Y - 60, 20, 80 };
+}
+
+// ---------------------------------------------------------------------------
+// GenerateCityBuildings  — city silhouette behind the gate, from the seed
+// ---------------------------------------------------------------------------
+void GenerateCityBuildings(CityBuildings *city, unsigned long long seed)
+{
+    WorldRng rng = { HashSeed(seed, 0x43495459u) | 1u };
+    for (int i = 0; i < NUM_CITY_BUILDINGS; i++) {
+        city->heights[i] = RngRange(&rng, 60, 120);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// World overlay  — sparse per-chunk diffs of player-caused changes
+// ---------------------------------------------------------------------------
+static ChunkDiff *OverlaySlot(ChunkDiff *entries, int capacity, int cx, int cy)
+{
+    unsigned int i = HashChunkCoords(0, cx, cy) & (unsigned int)(capacity - 1);
+    for (;;) {
+        ChunkDiff *d = &entries[i];
+        if (!d->used || (d->cx == cx && d->cy == cy)) return d;
+        i = (i + 1) & (unsigned int)(capacity - 1);
+    }
+}
+
+ChunkDiff *FindChunkDiff(WorldOverlay *overlay, int cx, int cy)
+{
+    if (overlay->capacity == 0) return NULL;
+    ChunkDiff *d = OverlaySlot(overlay->entries, overlay->capacity, cx, cy);
+    return d->used ? d : NULL;
+}
+
+// Insert-or-find; grows the table at 70% load
+static ChunkDiff *AddChunkDiff(WorldOverlay *overlay, int cx, int cy)
+{
+    if ((overlay->count + 1) * 10 > overlay->capacity * 7) {
+        int newCap = overlay->capacity ? overlay->capacity * 2 : OVERLAY_MIN_CAPACITY;
+        ChunkDiff *newEntries = (ChunkDiff *)calloc((size_t)newCap, sizeof(ChunkDiff));
+        if (newEntries == NULL) return NULL;
+        for (int i = 0; i < overlay->capacity; i++) {
+            ChunkDiff *old = &overlay->entries[i];
+            if (old->used) *OverlaySlot(newEntries, newCap, old->cx, old->cy) = *old;
+        }
+        free(overlay->entries);
+        overlay->entries  = newEntries;
+        overlay->capacity = newCap;
+    }
+    ChunkDiff *d = OverlaySlot(overlay->entries, overlay->capacity, cx, cy);
+    if (!d->used) {
+        memset(d, 0, sizeof(*d));
+        d->cx   = cx;
+        d->cy   = cy;
+        d->used = true;
+        overlay->count++;
+    }
+    return d;
+}
+
+void RecordChunkDiff(WorldOverlay *overlay, const Chunk *chunk)
+{
+    if (chunk->modifiedMask == 0) return;
+    ChunkDiff *d = AddChunkDiff(overlay, chunk->cx, chunk->cy);
+    if (d == NULL) return;
+    for (int i = 0; i < chunk->numItems; i++) {
+        if (chunk->modifiedMask & (1u << i)) d->items[i] = chunk->items[i];
+    }
+    d->itemMask |= chunk->modifiedMask;
+}
+
+void ApplyChunkDiff(WorldOverlay *overlay, Chunk *chunk)
+{
+    ChunkDiff *d = FindChunkDiff(overlay, chunk->cx, chunk->cy);
+    if (d == NULL) return;
+    for (int i = 0; i < chunk->numItems; i++) {
+        if (d->itemMask & (1u << i)) chunk->items[i] = d->items[i];
+        // Saved after its timer ran out but before it was placed
+        if (!chunk->items[i].active && chunk->items[i].respawnTimer <= 0.0f) {
+            chunk->pendingRespawn |= (unsigned char)(1u << i);
+        }
+    }
+    chunk->modifiedMask = d->itemMask;
+}
+
+// ---------------------------------------------------------------------------
+// PlaceRespawnedItem  — a timed-out item reappears somewhere else in its chunk
+// ---------------------------------------------------------------------------
+void PlaceRespawnedItem(Chunk *ch, int i, WorldRng *rng)
+{
+    WorldItem *item = &ch->items[i];
+    // Pick a new position inside the same chunk, outside the village
+    // (>200px from village center)
+    float wx, wy;
+    float chunkX = (float)ch->cx * CHUNK_SIZE;
+    float chunkY = (float)ch->cy * CHUNK_SIZE;
+    int tries = 0;
+    do {
+        wx = chunkX + 100.0f + (float)RngRange(rng, 0, CHUNK_SIZE - 200);
+        wy = chunkY + 100.0f + (float)RngRange(rng, 0, CHUNK_SIZE - 200);
+    } while (fabsf(wx - VILLAGE_X) < 200.0f && fabsf(wy - VILLAGE_Y) < 200.0f &&
+             ++tries < 16);
+    item->position     = (Vector2){ wx, wy };
+    item->typeIndex    = RandomItemType(&itemTable, rng);
+    item->condition    = 0.3f + (float)RngRange(rng, 0, 600) / 1000.0f;
+    item->active       = true;
+    item->respawnTimer = 0.0f;
+    ch->modifiedMask  |= (unsigned char)(1u << i);
+    ch->journalMask   |= (unsigned char)(1u << i);
+    ch->pendingRespawn &= (unsigned char)~(1u << i);
+    ch->minimapDirty   = true;
+    // Trigger shimmer at new position (reuse slot i)
+    ch->shimmers[i].position = item->position;
+    ch->shimmers[i].timer    = 1.0f;
+    ch->shimmers[i].active   = true;
+}
+
+void FreeWorldOverlay(WorldOverlay *overlay)
+{
+    free(overlay->entries);
+    memset(overlay, 0, sizeof(*overlay));
+}
+
+// ---------------------------------------------------------------------------
+// SaveGame / LoadGame  — sim state + seed + overlay; untouched chunks regenerate.
+// Layout: SaveHeader (with the section table), then each section at its
+// aligned offset. Sections are raw in-memory records: the overlay is written
+// as its whole hash table, so loading it is one copy with no rehashing.
+// ---------------------------------------------------------------------------
+// FNV-1a over 64-bit words (bytes for the tail), folded to 32 bits
+static unsigned int SaveChecksum(const void *data, size_t size)
+{
+    const unsigned char *p = data;
+    unsigned long long h = 14695981039346656037ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        unsigned long long w;
+        memcpy(&w, p + i, sizeof(w));
+        h = (h ^ w) * 1099511628211ull;
+    }
+    for (; i < size; i++) h = (h ^ p[i]) * 1099511628211ull;
+    return (unsigned int)(h ^ (h >> 32));
+}
+
+static unsigned long long SaveAlign(unsigned long long offset)
+{
+    return (offset + SAVE_SECTION_ALIGN - 1) & ~(unsigned long long)(SAVE_SECTION_ALIGN - 1);
+}
+
+// Fill in the header and section table for these records; returns the file size
+static size_t PlanSave(SaveHeader *header, const void *data[SAVE_SECTION_COUNT], unsigned long long seed,
+                       int overlayCapacity, int overlayCount, unsigned int journalId)
+{
+    unsigned int recordSize[SAVE_SECTION_COUNT] = { sizeof(SimState), sizeof(ChunkDiff) };
+    unsigned int count[SAVE_SECTION_COUNT]      = { 1, (unsigned int)overlayCapacity };
+
+    memset(header, 0, sizeof(*header));     // padding is checksummed too
+    header->magic         = GAME_SAVE_MAGIC;
+    header->version       = GAME_SAVE_VERSION;
+    header->seed          = seed;
+    header->overlayCount  = overlayCount;
+    header->sectionCount  = SAVE_SECTION_COUNT;
+    header->journalId     = journalId;
+    header->itemTableHash = itemTable.hash;
+    unsigned long long offset = SaveAlign(sizeof(*header));
+    for (int i = 0; i < SAVE_SECTION_COUNT; i++) {
+        size_t size = (size_t)recordSize[i] * count[i];
+        header->sections[i] = (SaveSection){
+            .id = (unsigned int)i, .recordSize = recordSize[i], .count = count[i],
+            .checksum = SaveChecksum(data[i], size), .offset = offset,
+        };
+        offset = SaveAlign(offset + size);
+    }
+    header->fileSize = offset;
+    header->checksum = SaveChecksum(header, sizeof(*header));
+    return (size_t)header->fileSize;
+}
+
+// The whole file image (header->fileSize bytes, alignment padding zeroed)
+static void SerializeSave(unsigned char *out, const SaveHeader *header,
+                          const void *data[SAVE_SECTION_COUNT])
+{
+    memset(out, 0, (size_t)header->fileSize);
+    memcpy(out, header, sizeof(*header));
+    for (int i = 0; i < SAVE_SECTION_COUNT; i++) {
+        const SaveSection *sec = &header->sections[i];
+        size_t size = (size_t)sec->recordSize * sec->count;
+        if (size > 0) memcpy(out + sec->offset, data[i], size);
+    }
+}
+
+// head then body go to path.tmp, which is synced and renamed over path, so a
+// crash mid-write leaves the previous file intact
+static bool WriteFileAtomic(const char *path, const void *head, size_t headSize,
+                            const void *body, size_t bodySize)
+{
+    char tmpPath[256];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+    FILE *f = fopen(tmpPath, "wb");
+    if (f == NULL) return false;
+    bool ok = fwrite(head, 1, headSize, f) == headSize &&
+              (bodySize == 0 || fwrite(body, 1, bodySize, f) == bodySize) &&
+              fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    ok = ok && rename(tmpPath, path) == 0;
+    if (!ok) remove(tmpPath);
+    return ok;
+}
+
+// A save reads the overlay, so the state of loaded chunks goes into it first
+static void FoldLoadedChunks(ChunkCache *cache)
+{
+    for (int i = 0; i < MAX_LOADED_CHUNKS; i++) {
+        Chunk *ch = &cache->chunks[i];
+        if (ch->loaded) RecordChunkDiff(cache->overlay, ch);
+    }
+}
+
+bool SaveGame(const char *path, const SimState *state, ChunkCache *cache, unsigned int journalId)
+{
+    FoldLoadedChunks(cache);
+
+    WorldOverlay *overlay = cache->overlay;
+    const void *data[SAVE_SECTION_COUNT] = { state, overlay->entries };
+    SaveHeader header;
+    size_t size = PlanSave(&header, data, cache->seed, overlay->capacity, overlay->count, journalId);
+    unsigned char *image = malloc(size);
+    if (image == NULL) return false;
+    SerializeSave(image, &header, data);
+    bool ok = WriteFileAtomic(path, image, size, NULL, 0);
+    free(image);
+    return ok;
+}
+
+// The header, the section table and every section's bounds and checksum are
+// checked before anything is used; returns the sections in id order
+static const SaveHeader *CheckSave(const unsigned char *base, size_t size,
+                                   const unsigned char *sections[SAVE_SECTION_COUNT])
+{
+    static const unsigned int recordSize[SAVE_SECTION_COUNT] = { sizeof(SimState), sizeof(ChunkDiff) };
+    const SaveHeader *header = (const SaveHeader *)base;
+    if (size < sizeof(SaveHeader) || header->magic != GAME_SAVE_MAGIC ||
+        header->version != GAME_SAVE_VERSION || header->fileSize != size ||
+        header->sectionCount != SAVE_SECTION_COUNT || header->itemTableHash != itemTable.hash) {
+        return NULL;
+    }
+    SaveHeader copy = *header;
+    copy.checksum = 0;
+    if (SaveChecksum(&copy, sizeof(copy)) != header->checksum) return NULL;
+
+    for (int i = 0; i < SAVE_SECTION_COUNT; i++) {
+        const SaveSection *sec = &header->sections[i];
+        unsigned long long bytes = (unsigned long long)sec->recordSize * sec->count;
+        if (sec->id != (unsigned int)i || sec->recordSize != recordSize[i] ||
+            sec->offset % SAVE_SECTION_ALIGN != 0 || sec->offset > size || bytes > size - sec->offset ||
+            SaveChecksum(base + sec->offset, (size_t)bytes) != sec->checksum) {
+            return NULL;
+        }
+        sections[i] = base + sec->offset;
+    }
+
+    // One state record; the overlay is a power-of-two table (or empty)
+    unsigned int capacity = header->sections[SAVE_SECTION_OVERLAY].count;
+    if (header->sections[SAVE_SECTION_STATE].count != 1 || (capacity & (capacity - 1)) != 0 ||
+        header->overlayCount < 0 || (unsigned int)header->overlayCount > capacity) {
+        return NULL;
+    }
+
+    // Lookups probe until a free slot, so the used entries must match the
+    // count and stay within AddChunkDiff's 70% load factor
+    const ChunkDiff *entries = (const ChunkDiff *)sections[SAVE_SECTION_OVERLAY];
+    unsigned int used = 0;
+    for (unsigned int i = 0; i < capacity; i++) used += entries[i].used ? 1u : 0u;
+    if (used != (unsigned int)header->overlayCount || (unsigned long long)used * 10 > (unsigned long long)capacity * 7) {
+        return NULL;
+    }
+    return header;
+}
+
+// Copy the records of a checked save image out (fix-ups only: the overlay
+// table gets a heap copy because it keeps growing after the load)
+static bool RestoreSave(const unsigned char *base, size_t size, SimState *state,
+                        unsigned long long *seed, WorldOverlay *overlay, unsigned int *journalId)
+{
+    const unsigned char *sections[SAVE_SECTION_COUNT];
+    const SaveHeader *header = CheckSave(base, size, sections);
+    if (header == NULL) return false;
+
+    const SaveSection *sec = &header->sections[SAVE_SECTION_OVERLAY];
+    memset(overlay, 0, sizeof(*overlay));
+    if (sec->count > 0) {
+        overlay->entries = (ChunkDiff *)malloc((size_t)sec->count * sizeof(ChunkDiff));
+        if (overlay->entries == NULL) return false;
+        memcpy(overlay->entries, sections[SAVE_SECTION_OVERLAY], (size_t)sec->count * sizeof(ChunkDiff));
+        overlay->capacity = (int)sec->count;
+        overlay->count    = header->overlayCount;
+    }
+    memcpy(state, sections[SAVE_SECTION_STATE], sizeof(*state));
+    *seed = header->seed;
+    if (journalId) *journalId = header->journalId;
+    return true;
+}
+
+// Loads a manual save in place from the mapping, or an autosave after
+// inflating it
+bool LoadGame(const char *path, SimState *state, unsigned long long *seed, WorldOverlay *overlay,
+              unsigned int *journalId)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    const unsigned char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return false;
+
+    bool ok;
+    const PackedSaveHeader *packed = (const PackedSaveHeader *)base;
+    if (size >= sizeof(PackedSaveHeader) && packed->magic == AUTOSAVE_MAGIC) {
+        const unsigned char *data = base + sizeof(PackedSaveHeader);
+        int dataSize = (int)(size - sizeof(PackedSaveHeader));
+        int rawSize = 0;
+        unsigned char *raw = NULL;
+        ok = SaveChecksum(data, (size_t)dataSize) == packed->checksum &&
+             (raw = DecompressData(data, dataSize, &rawSize)) != NULL &&
+             (unsigned long long)rawSize == packed->rawSize &&
+             RestoreSave(raw, (size_t)rawSize, state, seed, overlay, journalId);
+        if (raw) MemFree(raw);
+    } else {
+        ok = RestoreSave(base, size, state, seed, overlay, journalId);
+    }
+    munmap((void *)base, size);
+    return ok;
+}
+
+// Tries the autosave slots newest first, so a damaged latest slot falls back
+// to the one before it. Returns the slot loaded, or -1.
+int LoadNewestAutosave(SimState *state, unsigned long long *seed, WorldOverlay *overlay)
+{
+    int    order[AUTOSAVE_SLOTS];
+    time_t mtime[AUTOSAVE_SLOTS];
+    int    count = 0;
+    char   path[64];
+    for (int slot = 0; slot < AUTOSAVE_SLOTS; slot++) {
+        struct stat st;
+        snprintf(path, sizeof(path), AUTOSAVE_PATH_FMT, slot);
+        if (stat(path, &st) != 0) continue;
+        int i = count++;
+        while (i > 0 && mtime[i - 1] < st.st_mtime) {
+            order[i] = order[i - 1];
+            mtime[i] = mtime[i - 1];
+            i--;
+        }
+        order[i] = slot;
+        mtime[i] = st.st_mtime;
+    }
+    for (int i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), AUTOSAVE_PATH_FMT, order[i]);
+        if (LoadGame(path, state, seed, overlay, NULL)) return order[i];
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Autosave  — the sim thread copies a SaveSnapshot (a memcpy of the state and
+// the overlay table); a background job on the shared pool builds the save
+// image, packs it and writes it atomically, so an autosave never costs a frame
+// ---------------------------------------------------------------------------
+void InitAutosaver(Autosaver *as, JobSystem *pool)
+{
+    memset(as, 0, sizeof(*as));
+    atomic_init(&as->busy, false);
+    as->pool      = pool;
+    as->timer     = AUTOSAVE_INTERVAL;
+    as->last.slot = -1;
+}
+
+static void AutosaveJob(void *data, int begin, int end)
+{
+    (void)begin; (void)end;
+    Autosaver *as = data;
+    SaveSnapshot *snap = &as->snapshot;
+    double start = GetTime();
+
+    const void *sections[SAVE_SECTION_COUNT] = { &snap->state, snap->overlay };
+    SaveHeader header;
+    size_t size = PlanSave(&header, sections, snap->seed, snap->overlayCapacity, snap->overlayCount, 0);
+    unsigned char *image = malloc(size);
+    unsigned char *packedData = NULL;
+    int packedSize = 0;
+    bool ok = false;
+    if (image != NULL) {
+        SerializeSave(image, &header, sections);
+        packedData = CompressData(image, (int)size, &packedSize);
+    }
+    if (packedData != NULL) {
+        PackedSaveHeader packed = { AUTOSAVE_MAGIC, SaveChecksum(packedData, (size_t)packedSize), size };
+        char path[64];
+        snprintf(path, sizeof(path), AUTOSAVE_PATH_FMT, snap->slot);
+        ok = WriteFileAtomic(path, &packed, sizeof(packed), packedData, (size_t)packedSize);
+        MemFree(packedData);
+    }
+    free(image);
+
+    as->result = (AutosaveResult){
+        .ok = ok, .slot = snap->slot, .writeMs = (GetTime() - start) * 1000.0,
+        .rawBytes = size, .packedBytes = (size_t)packedSize,
+    };
+    atomic_store_explicit(&as->busy, false, memory_order_release);
+}
+
+// Snapshot the save state and hand it to the writer; false while the
+// previous autosave is still being written
+bool StartAutosave(Autosaver *as, const SimState *state, ChunkCache *cache)
+{
+    if (atomic_load_explicit(&as->busy, memory_order_acquire)) return false;
+    double start = GetTime();
+    FoldLoadedChunks(cache);
+
+    WorldOverlay *overlay = cache->overlay;
+    SaveSnapshot *snap = &as->snapshot;
+    if (overlay->capacity > snap->overlayAlloc) {
+        ChunkDiff *grown = realloc(snap->overlay, (size_t)overlay->capacity * sizeof(ChunkDiff));
+        if (grown == NULL) return false;
+        snap->overlay      = grown;
+        snap->overlayAlloc = overlay->capacity;
+    }
+    snap->state = *state;
+    snap->seed  = cache->seed;
+    if (overlay->capacity > 0) {
+        memcpy(snap->overlay, overlay->entries, (size_t)overlay->capacity * sizeof(ChunkDiff));
+    }
+    snap->overlayCapacity = overlay->capacity;
+    snap->overlayCount    = overlay->count;
+    snap->slot            = as->nextSlot;
+    as->nextSlot = (as->nextSlot + 1) % AUTOSAVE_SLOTS;
+    as->copyUs   = (GetTime() - start) * 1e6;
+
+    as->pending = true;
+    atomic_store_explicit(&as->busy, true, memory_order_release);
+    RunBackgroundJob(as->pool, AutosaveJob, as);
+    return true;
+}
+
+// Harvest a finished autosave and start the next one when it is due
+void UpdateAutosave(Autosaver *as, const SimState *state, ChunkCache *cache, float dt)
+{
+    if (as->pending && !atomic_load_explicit(&as->busy, memory_order_acquire)) {
+        as->pending = false;
+        as->last    = as->result;
+        if (as->last.ok) {
+            LogMessage(LOG_INFO, LOGCAT_WORLD, "Autosaved to slot %d in %.2f ms (%d KB packed to %d KB)",
+                       as->last.slot, as->last.writeMs,
+                       (int)(as->last.rawBytes / 1024), (int)(as->last.packedBytes / 1024));
+        } else {
+            as->failures++;
+            LogMessage(LOG_ERROR, LOGCAT_WORLD, "Autosave to slot %d failed", as->last.slot);
+        }
+    }
+    as->timer -= dt;
+    if (as->timer <= 0.0f && StartAutosave(as, state, cache)) as->timer = AUTOSAVE_INTERVAL;
+}
+
+// Waits for a write in flight (it has to finish before the pool shuts down)
+void StopAutosaver(Autosaver *as)
+{
+    while (atomic_load_explicit(&as->busy, memory_order_acquire)) {
+        nanosleep(&(struct timespec){ 0, 1000000 }, NULL);
+    }
+    free(as->snapshot.overlay);
+    as->snapshot.overlay      = NULL;
+    as->snapshot.overlayAlloc = 0;
+}
+
+// ---------------------------------------------------------------------------
+// State journal  — item changes and the sim state are appended to
+// game.journal as they happen, so a save costs O(changes since the last one).
+// Loading replays the journal over game.sav; CompactJournal folds the two into
+// a new game.sav once the journal grows past JOURNAL_COMPACT_BYTES.
+// ---------------------------------------------------------------------------
+void InitJournal(StateJournal *j)
+{
+    memset(j, 0, sizeof(*j));
+    j->fd         = -1;
+    j->flushTimer = JOURNAL_FLUSH_INTERVAL;
+}
+
+static void JournalAppend(StateJournal *j, JournalRecordType type, const void *payload, size_t size)
+{
+    size_t need = j->used + sizeof(JournalRecord) + size;
+    if (need > j->capacity) {
+        size_t cap = j->capacity ? j->capacity : JOURNAL_MIN_BUFFER;
+        while (cap < need) cap *= 2;
+        unsigned char *grown = realloc(j->buffer, cap);
+        if (grown == NULL) return;
+        j->buffer   = grown;
+        j->capacity = cap;
+    }
+    JournalRecord rec = { (unsigned int)type, (unsigned int)size, SaveChecksum(payload, size), 0 };
+    memcpy(j->buffer + j->used, &rec, sizeof(rec));
+    memcpy(j->buffer + j->used + sizeof(rec), payload, size);
+    j->used += sizeof(rec) + size;
+    j->pending++;
+}
+
+// Queue the chunk's changed items. While detached there is no journal to
+// extend: the next base save (CompactJournal) holds them anyway.
+void JournalChunkItems(StateJournal *j, Chunk *ch)
+{
+    for (int i = 0; j->attached && i < ch->numItems; i++) {
+        if (!(ch->journalMask & (1u << i))) continue;
+        JournalItem rec = { ch->cx, ch->cy, i, ch->items[i] };
+        JournalAppend(j, JOURNAL_ITEM, &rec, sizeof(rec));
+    }
+    ch->journalMask = 0;
+}
+
+static void DetachJournal(StateJournal *j)
+{
+    if (j->fd >= 0) close(j->fd);
+    j->fd       = -1;
+    j->attached = false;
+    j->used     = 0;
+    j->pending  = 0;
+}
+
+// New journal file holding only its header; returns the fd (appending) or -1
+static int CreateJournalFile(unsigned int journalId)
+{
+    int fd = open(JOURNAL_PATH, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0) return -1;
+    JournalHeader header = { JOURNAL_MAGIC, JOURNAL_VERSION, journalId, 0 };
+    if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) || fsync(fd) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Queue what changed since the last flush and append it to the file
+bool FlushJournal(StateJournal *j, ChunkCache *cache, const SimState *state)
+{
+    j->flushTimer = JOURNAL_FLUSH_INTERVAL;
+    if (!j->attached) return false;
+    for (int c = 0; c < MAX_LOADED_CHUNKS; c++) {
+        Chunk *ch = &cache->chunks[c];
+        if (ch->loaded && ch->journalMask != 0) JournalChunkItems(j, ch);
+    }
+    if (memcmp(state, &j->lastState, sizeof(*state)) != 0) {
+        JournalAppend(j, JOURNAL_STATE, state, sizeof(*state));
+        j->lastState = *state;
+    }
+    if (j->used == 0) return true;
+
+    ssize_t n = write(j->fd, j->buffer, j->used);
+    if (n != (ssize_t)j->used) {
+        // Cut a partial append off again; the buffer is retried next flush
+        if (n > 0 && ftruncate(j->fd, (off_t)j->fileSize) != 0) DetachJournal(j);
+        return false;
+    }
+    j->fileSize += n;
+    j->used      = 0;
+    j->pending   = 0;
+    return true;
+}
+
+// Fold everything into a new game.sav and start an empty journal on it. The
+// base is written first: a crash in between leaves a journal whose id no
+// longer matches, which replay ignores.
+bool CompactJournal(StateJournal *j, const SimState *state, ChunkCache *cache)
+{
+    unsigned int journalId = HashSeed(cache->seed ^ (unsigned long long)time(NULL), j->journalId + 1u) | 1u;
+    DetachJournal(j);
+    for (int c = 0; c < MAX_LOADED_CHUNKS; c++) cache->chunks[c].journalMask = 0;
+    if (!SaveGame(GAME_SAVE_PATH, state, cache, journalId)) return false;
+
+    j->fd = CreateJournalFile(journalId);
+    if (j->fd < 0) return false;
+    j->attached   = true;
+    j->journalId  = journalId;
+    j->fileSize   = sizeof(JournalHeader);
+    j->lastState  = *state;
+    j->flushTimer = JOURNAL_FLUSH_INTERVAL;
+    return true;
+}
+
+// Apply the journal of the base save with this journalId on top of it.
+// Returns the records applied (-1 if the journal belongs to another base) and
+// the length of the valid prefix, which AttachJournal cuts the file back to.
+int ReplayJournal(const char *path, unsigned int journalId, SimState *state, WorldOverlay *overlay,
+                  long long *validSize)
+{
+    *validSize = 0;
+    if (journalId == 0) return -1;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(JournalHeader)) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    const unsigned char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+
+    JournalHeader header;
+    memcpy(&header, base, sizeof(header));
+    if (header.magic != JOURNAL_MAGIC || header.version != JOURNAL_VERSION || header.journalId != journalId) {
+        munmap((void *)base, size);
+        return -1;
+    }
+
+    // Records are packed back to back, so they are copied out, not cast
+    size_t pos = sizeof(header);
+    int applied = 0;
+    while (pos + sizeof(JournalRecord) <= size) {
+        JournalRecord rec;
+        memcpy(&rec, base + pos, sizeof(rec));
+        const unsigned char *payload = base + pos + sizeof(rec);
+        if (rec.size > size - pos - sizeof(rec) || SaveChecksum(payload, rec.size) != rec.checksum) break;
+        if (rec.type == JOURNAL_ITEM && rec.size == sizeof(JournalItem)) {
+            JournalItem item;
+            memcpy(&item, payload, sizeof(item));
+            if (item.index < 0 || item.index >= CHUNK_MAX_ITEMS) break;
+            ChunkDiff *d = AddChunkDiff(overlay, item.cx, item.cy);
+            if (d == NULL) break;
+            d->items[item.index] = item.item;
+            d->itemMask |= (unsigned char)(1u << item.index);
+        } else if (rec.type == JOURNAL_STATE && rec.size == sizeof(SimState)) {
+            memcpy(state, payload, sizeof(*state));
+        } else {
+            break;
+        }
+        pos += sizeof(rec) + rec.size;
+        applied++;
+    }
+    *validSize = (long long)pos;
+    munmap((void *)base, size);
+    return applied;
+}
+
+// Keep appending to the journal of the save just loaded, cut back to its
+// valid prefix (a missing or foreign journal is started afresh). A base with
+// no journalId, such as an autosave, leaves the journal detached until the
+// next F5 writes a base.
+bool AttachJournal(StateJournal *j, unsigned int journalId, long long validSize, const SimState *state)
+{
+    DetachJournal(j);
+    if (journalId == 0) return false;
+    int fd;
+    if (validSize >= (long long)sizeof(JournalHeader)) {
+        fd = open(JOURNAL_PATH, O_WRONLY | O_APPEND);
+        if (fd >= 0 && ftruncate(fd, (off_t)validSize) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        fd = CreateJournalFile(journalId);
+        validSize = sizeof(JournalHeader);
+    }
+    if (fd < 0) return false;
+    j->fd         = fd;
+    j->attached   = true;
+    j->journalId  = journalId;
+    j->fileSize   = validSize;
+    j->lastState  = *state;
+    j->flushTimer = JOURNAL_FLUSH_INTERVAL;
+    return true;
+}
+
+void CloseJournal(StateJournal *j)
+{
+    DetachJournal(j);
+    free(j->buffer);
+    j->buffer   = NULL;
+    j->capacity = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Rewind buffer  — the last REWIND_SECONDS of sim state, one frame per tick.
+// A keyframe every REWIND_KEYFRAME_TICKS stores the whole SimState; the
+// frames in between store only the words that changed (player, clocks and
+// storm: a few dozen bytes), so the full window takes some tens of KB.
+// ---------------------------------------------------------------------------
+#define REWIND_WORDS      (sizeof(SimState) / sizeof(unsigned int))
+#define REWIND_MAX_RECORD (2 * sizeof(SimState) + sizeof(RewindRun))
+_Static_assert(sizeof(SimState) % sizeof(unsigned int) == 0, "SimState is diffed in whole words");
+_Static_assert(REWIND_WORDS <= 0xFFFF, "RewindRun indexes words with 16 bits");
+
+bool InitRewind(RewindBuffer *rw)
+{
+    memset(rw, 0, sizeof(*rw));
+    rw->hitch = -1;
+    rw->data  = malloc(REWIND_DATA_BYTES);
+    return rw->data != NULL;
+}
+
+void ResetRewind(RewindBuffer *rw)
+{
+    rw->first = rw->count = 0;
+    rw->head      = 0;
+    rw->scrubbing = false;
+    rw->hitch     = -1;
+}
+
+static int RewindSlot(const RewindBuffer *rw, int frame)
+{
+    return (rw->first + frame) % REWIND_FRAMES;
+}
+
+static void DropOldestRewindFrame(RewindBuffer *rw)
+{
+    rw->first = (rw->first + 1) % REWIND_FRAMES;
+    rw->count--;
+    if (rw->hitch >= 0) rw->hitch--;
+}
+
+// Write the words of state that differ from base (all of them when base is
+// NULL) as runs; an unchanged word between two changes is carried along,
+// since a new run header would cost as much. Returns the record size.
+static unsigned int EncodeRewindRecord(unsigned char *out, const SimState *state, const SimState *base)
+{
+    unsigned int now[REWIND_WORDS], was[REWIND_WORDS];
+    memcpy(now, state, sizeof(now));
+    if (base != NULL) memcpy(was, base, sizeof(was));
+    unsigned int size = 0;
+    unsigned int i = 0;
+    while (i < REWIND_WORDS) {
+        if (base != NULL && now[i] == was[i]) {
+            i++;
+            continue;
+        }
+        unsigned int start = i;
+        while (i < REWIND_WORDS && (base == NULL || now[i] != was[i] ||
+                                    (i + 1 < REWIND_WORDS && now[i + 1] != was[i + 1]))) {
+            i++;
+        }
+        RewindRun run = { (unsigned short)start, (unsigned short)(i - start) };
+        memcpy(out + size, &run, sizeof(run));
+        memcpy(out + size + sizeof(run), &now[start], run.count * sizeof(unsigned int));
+        size += sizeof(run) + run.count * sizeof(unsigned int);
+    }
+    return size;
+}
+
+static void ApplyRewindRecord(SimState *state, const unsigned char *record, unsigned int size)
+{
+    unsigned char *bytes = (unsigned char *)state;
+    for (unsigned int pos = 0; pos < size; ) {
+        RewindRun run;
+        memcpy(&run, record + pos, sizeof(run));
+        memcpy(bytes + run.start * sizeof(unsigned int), record + pos + sizeof(run),
+               run.count * sizeof(unsigned int));
+        pos += sizeof(run) + run.count * sizeof(unsigned int);
+    }
+}
+
+// Append the state at the end of a tick, dropping the oldest frames to make
+// room (by count, or where the byte ring wraps onto them)
+void RecordRewind(RewindBuffer *rw, const SimState *state, float tickMs)
+{
+    if (rw->data == NULL) return;
+    double start = GetTime();
+
+    if (rw->count == REWIND_FRAMES) DropOldestRewindFrame(rw);
+    unsigned int at = rw->head;
+    if (at + REWIND_MAX_RECORD > REWIND_DATA_BYTES) {
+        // Frames left in the skipped tail are from the previous lap: the oldest
+        while (rw->count > 0 && rw->frames[rw->first].offset >= at) DropOldestRewindFrame(rw);
+        at = 0;
+    }
+    while (rw->count > 0) {
+        const RewindFrame *oldest = &rw->frames[rw->first];
+        if (oldest->offset >= at + REWIND_MAX_RECORD || oldest->offset + oldest->size <= at) break;
+        DropOldestRewindFrame(rw);
+    }
+    // Deltas whose keyframe is gone cannot be rebuilt
+    while (rw->count > 0 && !rw->frames[rw->first].keyframe) DropOldestRewindFrame(rw);
+
+    bool keyframe = rw->count == 0 || rw->sinceKeyframe >= REWIND_KEYFRAME_TICKS - 1;
+    RewindFrame *frame = &rw->frames[RewindSlot(rw, rw->count)];
+    frame->offset   = at;
+    frame->size     = EncodeRewindRecord(rw->data + at, state, keyframe ? NULL : &rw->last);
+    frame->keyframe = keyframe;
+    frame->tickMs   = tickMs;
+    rw->head = at + frame->size;
+    rw->count++;
+    rw->last = *state;
+    rw->sinceKeyframe = keyframe ? 0 : rw->sinceKeyframe + 1;
+    if (tickMs >= REWIND_HITCH_MS) rw->hitch = rw->count - 1;
+    rw->recordUs = (GetTime() - start) * 1e6;
+}
+
+// Rebuild a frame (0 = oldest) from its keyframe and the deltas after it
+bool RewindStateAt(const RewindBuffer *rw, int frame, SimState *out)
+{
+    if (frame < 0 || frame >= rw->count) return false;
+    int key = frame;
+    while (!rw->frames[RewindSlot(rw, key)].keyframe) key--;
+    for (int i = key; i <= frame; i++) {
+        const RewindFrame *f = &rw->frames[RewindSlot(rw, i)];
+        ApplyRewindRecord(out, rw->data + f->offset, f->size);
+    }
+    return true;
+}
+
+// Leave scrubbing at the frame shown: the frames after it are discarded and
+// recording carries on from there
+void ResumeFromRewind(RewindBuffer *rw, SimState *state)
+{
+    rw->scrubbing = false;
+    if (!RewindStateAt(rw, rw->cursor, state)) return;
+    rw->count = rw->cursor + 1;
+    const RewindFrame *newest = &rw->frames[RewindSlot(rw, rw->cursor)];
+    rw->head = newest->offset + newest->size;
+    rw->last = *state;
+    rw->sinceKeyframe = 0;
+    for (int i = rw->cursor; !rw->frames[RewindSlot(rw, i)].keyframe; i--) rw->sinceKeyframe++;
+    if (rw->hitch > rw->cursor) rw->hitch = -1;
+}
+
+RewindStatus GetRewindStatus(const RewindBuffer *rw)
+{
+    RewindStatus status = { rw->scrubbing, rw->cursor, rw->count, 0.0f, 0.0f };
+    if (!rw->scrubbing) return status;
+    status.secondsBack = (float)(rw->count - 1 - rw->cursor) / SIM_TICK_HZ;
+    if (rw->cursor + 1 < rw->count) {
+        float nextMs = rw->frames[RewindSlot(rw, rw->cursor + 1)].tickMs;
+        if (nextMs >= REWIND_HITCH_MS) status.hitchMs = nextMs;
+    }
+    return status;
+}
+
+// Bytes the recorded frames span in the data ring
+size_t RewindBytes(const RewindBuffer *rw)
+{
+    if (rw->count == 0) return 0;
+    unsigned int oldest = rw->frames[rw->first].offset;
+    return rw->head > oldest ? rw->head - oldest : REWIND_DATA_BYTES - oldest + rw->head;
+}
+
+void FreeRewind(RewindBuffer *rw)
+{
+    free(rw->data);
+    rw->data  = NULL;
+    rw->count = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Job system  — fixed worker pool shared by every parallel phase. Each thread
+// owns a work-stealing deque; idle threads steal from random victims. Jobs
+// signal a JobCounter on completion, and jobs queued with RunJobAfter are
+// released by whichever thread drops their dependency to zero. The main
+// thread runs jobs while it waits, but never background jobs, so a long
+// chunk generation can't stall a frame.
+// ---------------------------------------------------------------------------
+static _Thread_local int jobThreadIndex;  // 0 = sim thread, 1.. = workers
+
+typedef struct {
+    JobSystem *js;
+    int        index;
+} JobWorkerStart;
+
+static bool JobDequePush(JobDeque *d, Job *job)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= JOB_DEQUE_SIZE) return false;
+    atomic_store_explicit(&d->slots[b & (JOB_DEQUE_SIZE - 1)], job, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_seq_cst);
+    return true;
+}
+
+static Job *JobDequePop(JobDeque *d)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_seq_cst);
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    Job *job = atomic_load_explicit(&d->slots[b & (JOB_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (t == b) {
+        // Last one: race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            job = NULL;
+        }
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+static Job *JobDequeSteal(JobDeque *d)
+{
+    long t = atomic_load_explicit(&d->top, memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_seq_cst);
+    if (t >= b) return NULL;
+    Job *job = atomic_load_explicit(&d->slots[t & (JOB_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+    return job;
+}
+
+static bool JobDequeEmpty(JobDeque *d)
+{
+    return atomic_load_explicit(&d->top, memory_order_seq_cst) >=
+           atomic_load_explicit(&d->bottom, memory_order_seq_cst);
+}
+
+static void LockJobCounter(JobCounter *counter)
+{
+    while (atomic_flag_test_and_set_explicit(&counter->lock, memory_order_acquire)) sched_yield();
+}
+
+static void UnlockJobCounter(JobCounter *counter)
+{
+    atomic_flag_clear_explicit(&counter->lock, memory_order_release);
+}
+
+static Job *AllocJob(JobSystem *js, JobFn fn, void *data, int begin, int end, JobCounter *counter)
+{
+    JobThread *self = &js->threads[jobThreadIndex];
+    Job *job = &self->pool[self->poolNext++ & (JOB_POOL_SIZE - 1)];
+    *job = (Job){ fn, data, begin, end, counter, NULL, false };
+    if (counter) atomic_fetch_add_explicit(&counter->pending, 1, memory_order_relaxed);
+    return job;
+}
+
+static void WakeJobWorkers(JobSystem *js)
+{
+    if (atomic_load_explicit(&js->sleepers, memory_order_seq_cst) == 0) return;
+    pthread_mutex_lock(&js->sleepLock);
+    pthread_cond_broadcast(&js->wake);
+    pthread_mutex_unlock(&js->sleepLock);
+}
+
+static void ExecuteJob(JobSystem *js, Job *job);
+
+// Queue on the calling thread's deque (runs inline if it is full)
+static void PushJob(JobSystem *js, Job *job)
+{
+    if (!JobDequePush(&js->threads[jobThreadIndex].deque, job)) {
+        ExecuteJob(js, job);
+        return;
+    }
+    WakeJobWorkers(js);
+}
+
+static void ExecuteJob(JobSystem *js, Job *job)
+{
+    // The record may be recycled once the job starts; keep what is needed after
+    JobCounter *counter = job->counter;
+    JobFn fn = job->fn;
+    void *data = job->data;
+    int begin = job->begin, end = job->end;
+    if (job->heap) free(job);
+    fn(data, begin, end);
+    if (counter == NULL) return;
+
+    // The final decrement happens under the lock, so a waiter that sees zero
+    // and then takes the lock knows this thread is done with the counter
+    LockJobCounter(counter);
+    Job *released = NULL;
+    if (atomic_fetch_sub_explicit(&counter->pending, 1, memory_order_acq_rel) == 1) {
+        released = counter->waiters;
+        counter->waiters = NULL;
+    }
+    UnlockJobCounter(counter);
+    while (released) {
+        Job *next = released->next;
+        PushJob(js, released);
+        released = next;
+    }
+}
+
+static Job *PopBackgroundJob(JobSystem *js)
+{
+    if (atomic_load_explicit(&js->backgroundCount, memory_order_seq_cst) == 0) return NULL;
+    pthread_mutex_lock(&js->backgroundLock);
+    Job *job = js->backgroundHead;
+    if (job) {
+        js->backgroundHead = job->next;
+        if (js->backgroundHead == NULL) js->backgroundTail = NULL;
+        atomic_fetch_sub_explicit(&js->backgroundCount, 1, memory_order_seq_cst);
+    }
+    pthread_mutex_unlock(&js->backgroundLock);
+    return job;
+}
+
+// Own deque first, then steal starting from a random victim, then (workers
+// only) the background queue
+static Job *FindJob(JobSystem *js, int self)
+{
+    JobThread *t = &js->threads[self];
+    Job *job = JobDequePop(&t->deque);
+    if (job) return job;
+    int threads = js->workerCount + 1;
+    t->rng = t->rng * 1103515245u + 12345u;
+    int start = (int)((t->rng >> 16) % (unsigned int)threads);
+    for (int k = 0; k < threads; k++) {
+        int victim = (start + k) % threads;
+        if (victim == self) continue;
+        job = JobDequeSteal(&js->threads[victim].deque);
+        if (job) return job;
+    }
+    return (self != 0) ? PopBackgroundJob(js) : NULL;
+}
+
+static bool JobsAvailable(JobSystem *js)
+{
+    if (atomic_load_explicit(&js->backgroundCount, memory_order_seq_cst) > 0) return true;
+    for (int i = 0; i <= js->workerCount; i++) {
+        if (!JobDequeEmpty(&js->threads[i].deque)) return true;
+    }
+    return false;
+}
+
+static void *JobWorkerMain(void *arg)
+{
+    JobWorkerStart *start = arg;
+    JobSystem *js = start->js;
+    jobThreadIndex = start->index;
+    free(start);
+
+    int idle = 0;
+    while (!atomic_load_explicit(&js->quit, memory_order_acquire)) {
+        Job *job = FindJob(js, jobThreadIndex);
+        if (job) {
+            ExecuteJob(js, job);
+            idle = 0;
+            continue;
+        }
+        if (++idle < JOB_SPIN_TRIES) {
+            sched_yield();
+            continue;
+        }
+        // Sleep until a push sees us in sleepers (it wakes under this lock,
+        // so the check below can't miss it)
+        pthread_mutex_lock(&js->sleepLock);
+        atomic_fetch_add_explicit(&js->sleepers, 1, memory_order_seq_cst);
+        while (!atomic_load_explicit(&js->quit, memory_order_acquire) && !JobsAvailable(js)) {
+            pthread_cond_wait(&js->wake, &js->sleepLock);
+        }
+        atomic_fetch_sub_explicit(&js->sleepers, 1, memory_order_seq_cst);
+        pthread_mutex_unlock(&js->sleepLock);
+        idle = 0;
+    }
+    return NULL;
+}
+
+void InitJobSystem(JobSystem *js)
+{
+    memset(js, 0, sizeof(*js));
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    js->workerCount = (int)Clamp((float)cores - 1.0f, 2.0f, (float)JOB_MAX_WORKERS);
+    for (int i = 0; i <= JOB_MAX_WORKERS; i++) {
+        atomic_init(&js->threads[i].deque.top, 0);
+        atomic_init(&js->threads[i].deque.bottom, 0);
+        js->threads[i].rng = 0x9E3779B9u * (unsigned int)(i + 1);
+    }
+    atomic_init(&js->quit, false);
+    atomic_init(&js->sleepers, 0);
+    atomic_init(&js->backgroundCount, 0);
+    pthread_mutex_init(&js->sleepLock, NULL);
+    pthread_cond_init(&js->wake, NULL);
+    pthread_mutex_init(&js->backgroundLock, NULL);
+    jobThreadIndex = 0;
+    for (int i = 0; i < js->workerCount; i++) {
+        JobWorkerStart *start = malloc(sizeof(*start));
+        *start = (JobWorkerStart){ js, i + 1 };
+        pthread_create(&js->workers[i], NULL, JobWorkerMain, start);
+    }
+}
+
+// Callers must have waited for their jobs (background jobs included)
+void ShutdownJobSystem(JobSystem *js)
+{
+    pthread_mutex_lock(&js->sleepLock);
+    atomic_store_explicit(&js->quit, true, memory_order_release);
+    pthread_cond_broadcast(&js->wake);
+    pthread_mutex_unlock(&js->sleepLock);
+    for (int i = 0; i < js->workerCount; i++) pthread_join(js->workers[i], NULL);
+    pthread_cond_destroy(&js->wake);
+    pthread_mutex_destroy(&js->sleepLock);
+    pthread_mutex_destroy(&js->backgroundLock);
+}
+
+void InitJobCounter(JobCounter *counter)
+{
+    atomic_init(&counter->pending, 0);
+    atomic_flag_clear(&counter->lock);
+    counter->waiters = NULL;
+}
+
+void RunJob(JobSystem *js, JobFn fn, void *data, int begin, int end, JobCounter *counter)
+{
+    PushJob(js, AllocJob(js, fn, data, begin, end, counter));
+}
+
+// Queue a job that may start only once dependency has reached zero
+void RunJobAfter(JobSystem *js, JobCounter *dependency, JobFn fn, void *data, int begin, int end,
+                 JobCounter *counter)
+{
+    Job *job = AllocJob(js, fn, data, begin, end, counter);
+    LockJobCounter(dependency);
+    if (atomic_load_explicit(&dependency->pending, memory_order_acquire) > 0) {
+        job->next = dependency->waiters;
+        dependency->waiters = job;
+        job = NULL;
+    }
+    UnlockJobCounter(dependency);
+    if (job) PushJob(js, job);
+}
+
+// Long-running work (chunk generation): FIFO, taken by workers only
+void RunBackgroundJob(JobSystem *js, JobFn fn, void *data)
+{
+    Job *job = malloc(sizeof(*job));
+    *job = (Job){ fn, data, 0, 0, NULL, NULL, true };
+    pthread_mutex_lock(&js->backgroundLock);
+    if (js->backgroundTail) js->backgroundTail->next = job;
+    else js->backgroundHead = job;
+    js->backgroundTail = job;
+    atomic_fetch_add_explicit(&js->backgroundCount, 1, memory_order_seq_cst);
+    pthread_mutex_unlock(&js->backgroundLock);
+    WakeJobWorkers(js);
+}
+
+// Split [0, count) into jobs of grain items each
+void ParallelFor(JobSystem *js, JobFn fn, void *data, int count, int grain, JobCounter *counter)
+{
+    if (grain < 1) grain = 1;
+    for (int begin = 0; begin < count; begin += grain) {
+        int end = (begin + grain < count) ? begin + grain : count;
+        RunJob(js, fn, data, begin, end, counter);
+    }
+}
+
+// Run (or steal) other jobs until counter reaches zero
+void WaitForJobs(JobSystem *js, JobCounter *counter)
+{
+    while (atomic_load_explicit(&counter->pending, memory_order_acquire) > 0) {
+        Job *job = FindJob(js, jobThreadIndex);
+        if (job) ExecuteJob(js, job);
+        else sched_yield();
+    }
+    // Let the thread that finished the last job release the counter
+    LockJobCounter(counter);
+    UnlockJobCounter(counter);
+}
+
+// ---------------------------------------------------------------------------
+// Chunk request heap (caller holds streamer->lock)
+// ---------------------------------------------------------------------------
+static void ChunkHeapSiftDown(ChunkStreamer *st, int i)
+{
+    for (;;) {
+        int l = i * 2 + 1, r = l + 1, best = i;
+        if (l < st->heapCount && st->heap[l].priority < st->heap[best].priority) best = l;
+        if (r < st->heapCount && st->heap[r].priority < st->heap[best].priority) best = r;
+        if (best == i) return;
+        ChunkRequest tmp = st->heap[i];
+        st->heap[i] = st->heap[best];
+        st->heap[best] = tmp;
+        i = best;
+    }
+}
+
+static void ChunkHeapPush(ChunkStreamer *st, ChunkRequest req)
+{
+    int i = st->heapCount++;
+    st->heap[i] = req;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (st->heap[parent].priority <= st->heap[i].priority) break;
+        ChunkRequest tmp = st->heap[i];
+        st->heap[i] = st->heap[parent];
+        st->heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+static ChunkRequest ChunkHeapPop(ChunkStreamer *st)
+{
+    ChunkRequest top = st->heap[0];
+    st->heap[0] = st->heap[--st->heapCount];
+    ChunkHeapSiftDown(st, 0);
+    return top;
+}
+
+// ---------------------------------------------------------------------------
+// Done queue: bounded lock-free ring, many workers push, main thread pops.
+// Capacity equals the job pool, so a push can never find it full.
+// ---------------------------------------------------------------------------
+static void ChunkDonePush(ChunkStreamer *st, int job)
+{
+    unsigned int pos = atomic_load_explicit(&st->doneHead, memory_order_relaxed);
+    for (;;) {
+        ChunkDoneCell *cell = &st->done[pos & (CHUNK_JOB_POOL - 1)];
+        unsigned int seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(&st->doneHead, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                cell->job = job;
+                atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+                return;
+            }
+        } else {
+            pos = atomic_load_explicit(&st->doneHead, memory_order_relaxed);
+        }
+    }
+}
+
+static int ChunkDonePop(ChunkStreamer *st)
+{
+    ChunkDoneCell *cell = &st->done[st->doneTail & (CHUNK_JOB_POOL - 1)];
+    unsigned int seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    if (seq != st->doneTail + 1) return -1;
+    int job = cell->job;
+    atomic_store_explicit(&cell->sequence, st->doneTail + CHUNK_JOB_POOL, memory_order_release);
+    st->doneTail++;
+    return job;
+}
+
+// ---------------------------------------------------------------------------
+// ChunkGenerateJob  — background job on the shared pool: generate the most
+// urgent request, repeatedly, until the heap is empty
+// ---------------------------------------------------------------------------
+static void ChunkGenerateJob(void *data, int begin, int end)
+{
+    (void)begin;
+    (void)end;
+    ChunkStreamer *st = data;
+    pthread_mutex_lock(&st->lock);
+    while (st->heapCount > 0) {
+        ChunkRequest req = ChunkHeapPop(st);
+        ChunkJob *job = &st->jobs[req.job];
+        int cx = job->cx, cy = job->cy;
+        pthread_mutex_unlock(&st->lock);
+
+        GenerateChunk(&job->chunk, cx, cy, st->seed);
+        ChunkDonePush(st, req.job);
+
+        pthread_mutex_lock(&st->lock);
+    }
+    st->generating--;
+    pthread_mutex_unlock(&st->lock);
+}
+
+// Start another generator if requests are waiting and a slot is free
+// (caller holds streamer->lock)
+static bool ClaimChunkGenSlot(ChunkStreamer *st)
+{
+    if (st->heapCount == 0 || st->generating >= CHUNK_GEN_SLOTS) return false;
+    st->generating++;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// StartChunkStreamer / StopChunkStreamer
+// ---------------------------------------------------------------------------
+void StartChunkStreamer(ChunkStreamer *streamer, unsigned long long seed, JobSystem *pool)
+{
+    memset(streamer, 0, sizeof(*streamer));
+    streamer->seed = seed;
+    streamer->pool = pool;
+    pthread_mutex_init(&streamer->lock, NULL);
+    for (int i = 0; i < CHUNK_JOB_POOL; i++) {
+        atomic_init(&streamer->done[i].sequence, (unsigned int)i);
+    }
+    atomic_init(&streamer->doneHead, 0u);
+}
+
+// Drop queued requests and wait for the generators to finish what they popped
+void StopChunkStreamer(ChunkStreamer *streamer)
+{
+    pthread_mutex_lock(&streamer->lock);
+    streamer->heapCount = 0;
+    while (streamer->generating > 0) {
+        pthread_mutex_unlock(&streamer->lock);
+        nanosleep(&(struct timespec){ 0, 200000 }, NULL);
+        pthread_mutex_lock(&streamer->lock);
+    }
+    pthread_mutex_unlock(&streamer->lock);
+    pthread_mutex_destroy(&streamer->lock);
+}
+
+// ---------------------------------------------------------------------------
+// RequestChunk  — queue (cx, cy) for background generation (main thread).
+// Returns false if it is already in flight or the job pool is exhausted.
+// Requests not repeated in a later streaming frame are cancelled.
+// ---------------------------------------------------------------------------
+bool RequestChunk(ChunkStreamer *streamer, int cx, int cy, float priority)
+{
+    int freeJob = -1;
+    for (int i = 0; i < CHUNK_JOB_POOL; i++) {
+        ChunkJob *job = &streamer->jobs[i];
+        if (job->inUse) {
+            if (job->cx == cx && job->cy == cy) {
+                job->wantedFrame = streamer->frame;
+                return false;
+            }
+        } else if (freeJob < 0) {
+            freeJob = i;
+        }
+    }
+    if (freeJob < 0) return false;
+
+    ChunkJob *job = &streamer->jobs[freeJob];
+    job->cx          = cx;
+    job->cy          = cy;
+    job->inUse       = true;
+    job->wantedFrame = streamer->frame;
+    streamer->jobsInUse++;
+
+    pthread_mutex_lock(&streamer->lock);
+    ChunkHeapPush(streamer, (ChunkRequest){ priority, freeJob });
+    bool startGenerator = ClaimChunkGenSlot(streamer);
+    pthread_mutex_unlock(&streamer->lock);
+    if (startGenerator) RunBackgroundJob(streamer->pool, ChunkGenerateJob, streamer);
+    return true;
+}
+
+// Helper: request priority = distance from the view center, shortened for
+// chunks in the direction the camera is moving
+static float ChunkPriority(int cx, int cy, Vector2 center, Vector2 velocity)
+{
+    Vector2 chunkCenter = { ((float)cx + 0.5f) * CHUNK_SIZE, ((float)cy + 0.5f) * CHUNK_SIZE };
+    Vector2 toChunk = Vector2Subtract(chunkCenter, center);
+    float dist  = Vector2Length(toChunk);
+    float speed = Vector2Length(velocity);
+    if (dist > 0.0f && speed > 1.0f) {
+        float ahead = Vector2DotProduct(toChunk, velocity) / (dist * speed); // -1..1
+        dist *= 1.0f - 0.5f * ahead;
+    }
+    return dist;
+}
+
+// Helper: keep (cx, cy) resident — touch it if cached, otherwise request it.
+// Returns true if the chunk is already loaded.
+static bool WantChunk(ChunkCache *cache, ChunkStreamer *streamer, int cx, int cy,
+                      Vector2 center, Vector2 velocity)
+{
+    Chunk *ch = FindChunk(cache, cx, cy);
+    if (ch != NULL) {
+        ch->lastUsedFrame = cache->frame;
+        return true;
+    }
+    RequestChunk(streamer, cx, cy, ChunkPriority(cx, cy, center, velocity));
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// UpdateChunkStreaming  — request missing chunks near the camera and along
+// its predicted path, cancel queued requests it has left behind, re-rank the
+// queue for the current camera motion, and install finished chunks.
+// Returns how many chunks near the camera are still missing.
+// ---------------------------------------------------------------------------
+int UpdateChunkStreaming(ChunkCache *cache, ChunkStreamer *streamer, Camera2D camera,
+                         Vector2 cameraVelocity, int screenWidth, int screenHeight)
+{
+    cache->frame++;
+    streamer->frame = cache->frame;
+
+    float visLeft   = camera.target.x - camera.offset.x / camera.zoom - CHUNK_LOAD_MARGIN;
+    float visTop    = camera.target.y - camera.offset.y / camera.zoom - CHUNK_LOAD_MARGIN;
+    float visRight  = visLeft + screenWidth  / camera.zoom + CHUNK_LOAD_MARGIN * 2.0f;
+    float visBottom = visTop  + screenHeight / camera.zoom + CHUNK_LOAD_MARGIN * 2.0f;
+
+    int startCX = WorldToChunk(visLeft);
+    int startCY = WorldToChunk(visTop);
+    int endCX   = WorldToChunk(visRight);
+    int endCY   = WorldToChunk(visBottom);
+
+    // Install finished chunks first so they count as loaded below. Only
+    // urgent while part of the load rect is missing; otherwise finalization
+    // is left to the frame scheduler's slack.
+    if (cache->missing > 0) FinalizeChunks(cache, streamer, CHUNK_INSTALLS_PER_FRAME, 0.0);
+
+    int missing = 0;
+    for (int cy = startCY; cy <= endCY; cy++) {
+        for (int cx = startCX; cx <= endCX; cx++) {
+            if (!WantChunk(cache, streamer, cx, cy, camera.target, cameraVelocity)) missing++;
+        }
+    }
+
+    // Prefetch: sweep the load rectangle along the velocity for the next few
+    // seconds, half a chunk at a time. Those chunks rank by the same distance
+    // metric, so the ones just ahead still beat the far end of the path.
+    float speed = Vector2Length(cameraVelocity);
+    int prefetched = 0;
+    if (speed > PREFETCH_MIN_SPEED) {
+        float viewW = visRight - visLeft, viewH = visBottom - visTop;
+        float lookAhead = speed * PREFETCH_SECONDS;
+        int   steps     = (int)(lookAhead / (CHUNK_SIZE * 0.5f)) + 1;
+        for (int s = 1; s <= steps; s++) {
+            Vector2 at = Vector2Add(camera.target,
+                                    Vector2Scale(cameraVelocity, PREFETCH_SECONDS * s / steps));
+            int pcx0 = WorldToChunk(at.x - viewW * 0.5f), pcx1 = WorldToChunk(at.x + viewW * 0.5f);
+            int pcy0 = WorldToChunk(at.y - viewH * 0.5f), pcy1 = WorldToChunk(at.y + viewH * 0.5f);
+            for (int cy = pcy0; cy <= pcy1 && prefetched < PREFETCH_MAX_CHUNKS; cy++) {
+                for (int cx = pcx0; cx <= pcx1 && prefetched < PREFETCH_MAX_CHUNKS; cx++) {
+                    if (WantChunk(cache, streamer, cx, cy, camera.target, cameraVelocity)) prefetched++;
+                }
+            }
+        }
+    }
+    cache->missing = missing;
+
+    // Drop queued requests nobody asked for this frame (the camera turned or
+    // moved on), then re-rank the rest for the current camera position/motion.
+    // Jobs a worker has already popped run to completion.
+    if (streamer->jobsInUse > 0) {
+        pthread_mutex_lock(&streamer->lock);
+        int kept = 0;
+        for (int i = 0; i < streamer->heapCount; i++) {
+            ChunkJob *job = &streamer->jobs[streamer->heap[i].job];
+            if (job->wantedFrame != streamer->frame) {
+                job->inUse = false;
+                streamer->jobsInUse--;
+                continue;
+            }
+            streamer->heap[kept] = streamer->heap[i];
+            streamer->heap[kept].priority = ChunkPriority(job->cx, job->cy,
+                                                          camera.target, cameraVelocity);
+            kept++;
+        }
+        streamer->heapCount = kept;
+        for (int i = streamer->heapCount / 2 - 1; i >= 0; i--) {
+            ChunkHeapSiftDown(streamer, i);
+        }
+        pthread_mutex_unlock(&streamer->lock);
+    }
+
+    return missing;
+}
+
+// Block until the load rect around camera is installed; gives up with a
+// warning after CHUNK_WAIT_TIMEOUT. Returns false if it gave up.
+bool WaitForChunks(ChunkCache *cache, ChunkStreamer *streamer, Camera2D camera,
+                   int screenWidth, int screenHeight)
+{
+    double giveUp = GetTime() + CHUNK_WAIT_TIMEOUT;
+    while (UpdateChunkStreaming(cache, streamer, camera, (Vector2){ 0 }, screenWidth, screenHeight) > 0) {
+        if (GetTime() >= giveUp) {
+            LogMessage(LOG_WARNING, LOGCAT_WORLD, "%d chunks around the camera still missing after %.1f s",
+                       cache->missing, CHUNK_WAIT_TIMEOUT);
+            return false;
+        }
+        nanosleep(&(struct timespec){ 0, 1000000 }, NULL);
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// FinalizeChunks  — install finished chunks from the done queue, up to
+// maxInstalls (0 = no limit) or until deadline (0 = none). Returns true if
+// it stopped early with results possibly still queued.
+// ---------------------------------------------------------------------------
+bool FinalizeChunks(ChunkCache *cache, ChunkStreamer *streamer, int maxInstalls, double deadline)
+{
+    for (int n = 0; maxInstalls == 0 || n < maxInstalls; n++) {
+        if (deadline > 0.0 && GetTime() >= deadline) return true;
+        int j = ChunkDonePop(streamer);
+        if (j < 0) return false;
+        ChunkJob *job = &streamer->jobs[j];
+        if (FindChunk(cache, job->cx, job->cy) == NULL) {
+            InstallChunk(cache, &job->chunk);
+        }
+        job->inUse = false;
+        streamer->jobsInUse--;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Minimap  — one MINIMAP_CHUNK_PX block per chunk in a wrapping texture.
+// Blocks are redrawn only when a chunk is installed, its items change, or the
+// player moves far enough that a block's slot now belongs to a different
+// chunk; drawing is a single textured quad. The sim thread renders blocks
+// into a single-producer ring and the render thread uploads them with
+// UpdateTextureRec (GL calls stay on the thread that owns the context).
+// ---------------------------------------------------------------------------
+static int MinimapBlock(int c)
+{
+    return ((c % MINIMAP_BLOCKS) + MINIMAP_BLOCKS) % MINIMAP_BLOCKS;
+}
+
+void InitMinimap(Minimap *map)
+{
+    Image img = GenImageColor(MINIMAP_TEX_SIZE, MINIMAP_TEX_SIZE, COL_MINIMAP_UNEXPLORED);
+    map->texture = LoadTextureFromImage(img);
+    UnloadImage(img);
+    SetTextureWrap(map->texture, TEXTURE_WRAP_REPEAT);
+    SetTextureFilter(map->texture, TEXTURE_FILTER_POINT);
+    memset(map->blockValid, 0, sizeof(map->blockValid));
+    map->open = true;
+    atomic_init(&map->uploadHead, 0);
+    atomic_init(&map->uploadTail, 0);
+}
 
-        // Workbench UI overlay
-        if (workbenchState != WB_CLOSED) {
-            DrawWorkbenchUI(inventory, &workbenchState,
-                            &repairSlot, &sacrificeSlot,
-                            &repairTimer, &repairDone,
-                            &pickupFlashTimer, pickupFlashMax,
-                            maxInventory, baseRepairBonus);
+// Queue one block for upload (px == NULL: reset the texture). False when the
+// ring is full; the caller retries on a later tick.
+static bool QueueMinimapUpload(Minimap *map, int bx, int by, const Color *px)
+{
+    unsigned int head = atomic_load_explicit(&map->uploadHead, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&map->uploadTail, memory_order_acquire);
+    if (head - tail >= MINIMAP_UPLOAD_RING) return false;
+    MinimapUpload *up = &map->uploads[head & (MINIMAP_UPLOAD_RING - 1)];
+    up->bx = bx;
+    up->by = by;
+    if (px) memcpy(up->px, px, sizeof(up->px));
+    atomic_store_explicit(&map->uploadHead, head + 1, memory_order_release);
+    return true;
+}
+
+// Render thread: push queued blocks to the texture
+void FlushMinimapUploads(Minimap *map)
+{
+    unsigned int tail = atomic_load_explicit(&map->uploadTail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&map->uploadHead, memory_order_acquire);
+    for (; tail != head; tail++) {
+        MinimapUpload *up = &map->uploads[tail & (MINIMAP_UPLOAD_RING - 1)];
+        if (up->bx < 0) {
+            Image img = GenImageColor(MINIMAP_TEX_SIZE, MINIMAP_TEX_SIZE, COL_MINIMAP_UNEXPLORED);
+            UpdateTexture(map->texture, img.data);
+            UnloadImage(img);
+        } else {
+            UpdateTextureRec(map->texture,
+                             (Rectangle){ (float)(up->bx * MINIMAP_CHUNK_PX), (float)(up->by * MINIMAP_CHUNK_PX),
+                                          MINIMAP_CHUNK_PX, MINIMAP_CHUNK_PX }, up->px);
         }
+    }
+    atomic_store_explicit(&map->uploadTail, tail, memory_order_release);
+}
 
-        // Trade screen overlay
-        if (tradeScreenOpen) {
-            DrawTradeScreenUI(inventory, maxInventory,
-                              &tokenCount, &tradeScreenOpen,
-                              &dataLogsPurchased, &toolUpgradePurchased,
-                              &carryUpgradePurchased, &maxInventory,
-                              &baseRepairBonus, &tokenAnimTimer,
-                              &tokenAnimDelta, &selectedTradeSlot,
-                              &dataLogViewerOpen, &dataLogViewerIndex);
+// Forget everything (new seed after a load). The reset always fits: it waits
+// for the render thread to drain the ring first.
+void ClearMinimap(Minimap *map)
+{
+    while (!QueueMinimapUpload(map, -1, -1, NULL)) {
+        nanosleep(&(struct timespec){ 0, 1000000 }, NULL);
+    }
+    memset(map->blockValid, 0, sizeof(map->blockValid));
+}
+
+// Downsample one chunk: tile color shaded by height, plus a dot per active item.
+// False when the upload ring is full.
+static bool RenderMinimapBlock(Minimap *map, const Chunk *ch, Sprites *spr)
+{
+    Color px[MINIMAP_CHUNK_PX * MINIMAP_CHUNK_PX];
+    int cellsPerPx = CHUNK_CELLS / MINIMAP_CHUNK_PX;
+    int pxPerTile  = MINIMAP_CHUNK_PX / CHUNK_TILES;
+    for (int y = 0; y < MINIMAP_CHUNK_PX; y++) {
+        for (int x = 0; x < MINIMAP_CHUNK_PX; x++) {
+            Color base  = spr->groundAvg[ch->tiles[y / pxPerTile][x / pxPerTile]];
+            float h     = ch->height[y * cellsPerPx + cellsPerPx / 2][x * cellsPerPx + cellsPerPx / 2] / 255.0f;
+            float shade = 0.8f + 0.4f * h;
+            px[y * MINIMAP_CHUNK_PX + x] = (Color){
+                (unsigned char)fminf(255.0f, base.r * shade),
+                (unsigned char)fminf(255.0f, base.g * shade),
+                (unsigned char)fminf(255.0f, base.b * shade), 255 };
         }
+    }
+    float originX = (float)ch->cx * CHUNK_SIZE, originY = (float)ch->cy * CHUNK_SIZE;
+    for (int i = 0; i < ch->numItems; i++) {
+        if (!ch->items[i].active) continue;
+        int x = (int)((ch->items[i].position.x - originX) * MINIMAP_CHUNK_PX / CHUNK_SIZE);
+        int y = (int)((ch->items[i].position.y - originY) * MINIMAP_CHUNK_PX / CHUNK_SIZE);
+        if (x < 0 || x >= MINIMAP_CHUNK_PX || y < 0 || y >= MINIMAP_CHUNK_PX) continue;
+        px[y * MINIMAP_CHUNK_PX + x] = itemTable.types[ch->items[i].typeIndex].color;
+    }
 
-        // Data log viewer overlay (can be opened from trade screen or independently)
-        if (dataLogViewerOpen) {
-            DrawDataLogViewer(dataLogViewerIndex, &dataLogViewerOpen);
+    int bx = MinimapBlock(ch->cx), by = MinimapBlock(ch->cy);
+    if (!QueueMinimapUpload(map, bx, by, px)) return false;
+    map->blockCx[by][bx]    = ch->cx;
+    map->blockCy[by][bx]    = ch->cy;
+    map->blockValid[by][bx] = true;
+    return true;
+}
+
+bool UpdateMinimap(Minimap *map, ChunkCache *cache, Sprites *spr, Vector2 playerPos, double deadline)
+{
+    // Chunk range the minimap window can show around the player
+    float half = MINIMAP_VIEW_CHUNKS * CHUNK_SIZE * 0.5f;
+    int minCX = WorldToChunk(playerPos.x - half), maxCX = WorldToChunk(playerPos.x + half);
+    int minCY = WorldToChunk(playerPos.y - half), maxCY = WorldToChunk(playerPos.y + half);
+
+    // Slots that wrapped around to a new chunk go back to unexplored
+    Color unexplored[MINIMAP_CHUNK_PX * MINIMAP_CHUNK_PX];
+    for (int i = 0; i < MINIMAP_CHUNK_PX * MINIMAP_CHUNK_PX; i++) unexplored[i] = COL_MINIMAP_UNEXPLORED;
+    for (int cy = minCY; cy <= maxCY; cy++) {
+        for (int cx = minCX; cx <= maxCX; cx++) {
+            int bx = MinimapBlock(cx), by = MinimapBlock(cy);
+            if (!map->blockValid[by][bx] ||
+                (map->blockCx[by][bx] == cx && map->blockCy[by][bx] == cy)) continue;
+            if (!QueueMinimapUpload(map, bx, by, unexplored)) return true;
+            map->blockValid[by][bx] = false;
         }
+    }
 
-        EndDrawing();
+    // Redraw changed chunks inside the window until the deadline (at least
+    // one per call); others wait until they are in it
+    int uploads = 0;
+    for (int c = 0; c < MAX_LOADED_CHUNKS; c++) {
+        Chunk *ch = &cache->chunks[c];
+        if (!ch->loaded || !ch->minimapDirty) continue;
+        if (ch->cx < minCX || ch->cx > maxCX || ch->cy < minCY || ch->cy > maxCY) continue;
+        if (uploads > 0 && GetTime() >= deadline) return true;
+        if (!RenderMinimapBlock(map, ch, spr)) return true;
+        ch->minimapDirty = false;
+        uploads++;
     }
+    return false;
+}
 
-    // --- Unload all sprites ---
-    UnloadTexture(spr.z_down);
-    UnloadTexture(spr.z_up);
-    UnloadTexture(spr.z_left);
-    UnloadTexture(spr.z_right);
-    for (int i = 0; i < 5; i++) UnloadTexture(spr.building[i]);
-    for (int i = 0; i < 5; i++) UnloadTexture(spr.item[i]);
-    for (int i = 0; i < 3; i++) UnloadTexture(spr.ground[i]);
-    for (int i = 0; i < 3; i++) UnloadTexture(spr.dune[i]);
-    UnloadTexture(spr.debris1);
-    UnloadTexture(spr.city_gate);
+// Screen area covered by the minimap panel (border included)
+static Rectangle MinimapRect(int screenWidth, int screenHeight)
+{
+    return (Rectangle){ (float)(screenWidth - MINIMAP_VIEW_PX - 20), (float)(screenHeight - MINIMAP_VIEW_PX - 20),
+                        (float)(MINIMAP_VIEW_PX + 8), (float)(MINIMAP_VIEW_PX + 8) };
+}
 
-    CloseWindow();
-    return 0;
+void DrawMinimap(Minimap *map, Vector2 playerPos, Vector2 facing,
+                 int screenWidth, int screenHeight, float pulseTimer)
+{
+    int size = MINIMAP_VIEW_PX;
+    int mapX = screenWidth  - size - 16;
+    int mapY = screenHeight - size - 16;
+    float texelsPerWorld = (float)MINIMAP_CHUNK_PX / CHUNK_SIZE;
+
+    // Texture wraps, so any window into the world is one quad
+    Rectangle src = { playerPos.x * texelsPerWorld - size / 2.0f,
+                      playerPos.y * texelsPerWorld - size / 2.0f, (float)size, (float)size };
+    DrawRectangle(mapX - 4, mapY - 4, size + 8, size + 8, COL_UI_BG);
+    DrawTexturePro(map->texture, src, (Rectangle){ (float)mapX, (float)mapY, (float)size, (float)size },
+                   (Vector2){ 0, 0 }, 0.0f, WHITE);
+    DrawRectangleLines(mapX - 4, mapY - 4, size + 8, size + 8, COL_UI_BORDER);
+
+    // Landmarks, clipped to the map
+    Vector2 center = { mapX + size / 2.0f, mapY + size / 2.0f };
+    Vector2 village = Vector2Add(center, Vector2Scale(Vector2Subtract((Vector2){ VILLAGE_X, VILLAGE_Y }, playerPos),
+                                                      texelsPerWorld));
+    Vector2 gate    = Vector2Add(center, Vector2Scale(Vector2Subtract((Vector2){ GATE_X, GATE_Y }, playerPos),
+                                                      texelsPerWorld));
+    Rectangle inner = { (float)mapX + 3, (float)mapY + 3, (float)size - 6, (float)size - 6 };
+    if (CheckCollisionPointRec(village, inner)) {
+        DrawRectangle((int)village.x - 3, (int)village.y - 3, 6, 6, COL_BLDG);
+        DrawRectangleLines((int)village.x - 3, (int)village.y - 3, 6, 6, COL_BLDG_OUTLINE);
+    } else {
+        // Edge arrow pointing home
+        Vector2 dir = Vector2Normalize(Vector2Subtract(village, center));
+        Vector2 tip = Vector2Add(center, Vector2Scale(dir, size / 2.0f - 6.0f));
+        DrawCircleV(tip, 3.0f, COL_BLDG);
+    }
+    if (CheckCollisionPointRec(gate, inner)) {
+        DrawRectangle((int)gate.x - 1, (int)gate.y - 3, 3, 6, COL_GATE_LIGHT);
+    }
+
+    // Player: pulsing dot plus a heading tick
+    float pr = 2.5f + sinf(pulseTimer * 4.0f) * 0.5f;
+    DrawCircleV(center, pr + 1.0f, COL_UI_DARK);
+    DrawCircleV(center, pr, COL_Z_SCARF);
+    DrawLineV(center, Vector2Add(center, Vector2Scale(facing, 7.0f)), COL_Z_SCARF);
 }
 
 // ---------------------------------------------------------------------------
 // DrawGround  — sprite-tiled ground with culling, plus dune arc lines
 // ---------------------------------------------------------------------------
-void DrawGround(GroundCircle *circles, int circleCount,
-                DuneLine *dunes, int duneCount,
-                Sprites *spr, unsigned char (*tileGrid)[GROUND_TILES_X],
+void DrawGround(const Chunk *chunks, int count, Sprites *spr,
                 Camera2D camera, int screenWidth, int screenHeight)
 {
-    (void)circles; (void)circleCount; // replaced by sprite tiles
-
-    // Determine tile pixel size from actual texture (use ground[0] as reference)
-    int tileW = GROUND_TILE_SIZE;
-    int tileH = GROUND_TILE_SIZE;
-    if (spr->ground[0].width  > 0) tileW = spr->ground[0].width;
-    if (spr->ground[0].height > 0) tileH = spr->ground[0].height;
-
-    // Base fill (visible even if tiles have gaps at edges)
-    DrawRectangle(0, 0, WORLD_WIDTH, WORLD_HEIGHT, COL_SAND_BASE);
-
-    // Compute visible tile range with culling
+    // Compute visible area
     float visLeft   = camera.target.x - camera.offset.x / camera.zoom;
     float visTop    = camera.target.y - camera.offset.y / camera.zoom;
     float visRight  = visLeft + screenWidth  / camera.zoom;
     float visBottom = visTop  + screenHeight / camera.zoom;
 
-    int startTX = (int)(visLeft  / tileW) - 1;
-    int startTY = (int)(visTop   / tileH) - 1;
-    int endTX   = (int)(visRight / tileW) + 1;
-    int endTY   = (int)(visBottom/ tileH) + 1;
+    // Base fill (visible even if a chunk is not loaded yet)
+    DrawRectangle((int)visLeft - 1, (int)visTop - 1,
+                  (int)(visRight - visLeft) + 2, (int)(visBottom - visTop) + 2, COL_SAND_BASE);
 
-    if (startTX < 0) startTX = 0;
-    if (startTY < 0) startTY = 0;
-    if (endTX > GROUND_TILES_X - 1) endTX = GROUND_TILES_X - 1;
-    if (endTY > GROUND_TILES_Y - 1) endTY = GROUND_TILES_Y - 1;
+    // Every tile is stretched to GROUND_TILE_SIZE so chunks line up exactly
+    int tileW = GROUND_TILE_SIZE;
+    int tileH = GROUND_TILE_SIZE;
 
-    for (int ty = startTY; ty <= endTY; ty++) {
-        for (int tx = startTX; tx <= endTX; tx++) {
-            int idx = tileGrid[ty][tx]; // 0, 1, or 2
-            float drawX = (float)(tx * tileW);
-            float drawY = (float)(ty * tileH);
-            if (drawX > WORLD_WIDTH || drawY > WORLD_HEIGHT) continue;
-            Texture2D t = spr->ground[idx];
-            // Stretch every tile to exactly tileW+1 x tileH+1 to eliminate seams
-            Rectangle src  = { 0, 0, (float)t.width, (float)t.height };
-            Rectangle dest = { drawX, drawY, (float)(tileW + 1), (float)(tileH + 1) };
-            DrawTexturePro(t, src, dest, (Vector2){0,0}, 0.0f, WHITE);
+    // Zoomed out, a tile is drawn as a flat rect in its texture's average color:
+    // one batched draw for the whole view instead of a texture switch per tile
+    bool impostor = GROUND_TILE_SIZE * camera.zoom < LOD_IMPOSTOR_TILE_PX;
+
+    for (int c = 0; c < count; c++) {
+        const Chunk *ch = &chunks[c];
+        float originX = (float)ch->cx * CHUNK_SIZE;
+        float originY = (float)ch->cy * CHUNK_SIZE;
+        if (originX > visRight || originX + CHUNK_SIZE < visLeft ||
+            originY > visBottom || originY + CHUNK_SIZE < visTop) continue;
+
+        // Visible tile range within this chunk
+        int startTX = (int)((visLeft   - originX) / tileW);
+        int startTY = (int)((visTop    - originY) / tileH);
+        int endTX   = (int)((visRight  - originX) / tileW);
+        int endTY   = (int)((visBottom - originY) / tileH);
+        if (startTX < 0) startTX = 0;
+        if (startTY < 0) startTY = 0;
+        if (endTX > CHUNK_TILES - 1) endTX = CHUNK_TILES - 1;
+        if (endTY > CHUNK_TILES - 1) endTY = CHUNK_TILES - 1;
+
+        for (int ty = startTY; ty <= endTY; ty++) {
+            for (int tx = startTX; tx <= endTX; tx++) {
+                int idx = ch->tiles[ty][tx]; // 0, 1, or 2
+                float drawX = originX + (float)(tx * tileW);
+                float drawY = originY + (float)(ty * tileH);
+                if (impostor) {
+                    DrawRectangleRec((Rectangle){ drawX, drawY, (float)(tileW + 1), (float)(tileH + 1) },
+                                     spr->groundAvg[idx]);
+                    continue;
+                }
+                Texture2D t = spr->ground[idx];
+                // Stretch every tile to exactly tileW+1 x tileH+1 to eliminate seams
+                Rectangle src  = { 0, 0, (float)t.width, (float)t.height };
+                Rectangle dest = { drawX, drawY, (float)(tileW + 1), (float)(tileH + 1) };
+                DrawTexturePro(t, src, dest, (Vector2){0,0}, 0.0f, WHITE);
+            }
         }
     }
 
-    // Near-edge haze: fade ground toward haze color along each border
-    int fadeW = 300;
-    Color hazeOpaque = { 212, 196, 168, 200 };
-    Color hazeClear  = { 212, 196, 168, 0   };
-    DrawRectangleGradientH(0, 0, fadeW, WORLD_HEIGHT,             hazeOpaque, hazeClear);
-    DrawRectangleGradientH(WORLD_WIDTH - fadeW, 0, fadeW, WORLD_HEIGHT, hazeClear, hazeOpaque);
-    DrawRectangleGradientV(0, 0, WORLD_WIDTH, fadeW,              hazeOpaque, hazeClear);
-    DrawRectangleGradientV(0, WORLD_HEIGHT - fadeW, WORLD_WIDTH, fadeW, hazeClear, hazeOpaque);
-
-    // Curved dune arc lines on top
-    for (int d = 0; d < duneCount; d++) {
-        for (int s = 0; s < dunes[d].numPts - 1; s++) {
-            DrawLineEx(dunes[d].pts[s], dunes[d].pts[s + 1],
-                       dunes[d].width, COL_DUNE_LINE);
+    // Curved dune arc lines on top (arcs can reach up to 700px outside their chunk)
+    for (int c = 0; c < count; c++) {
+        const Chunk *ch = &chunks[c];
+        float originX = (float)ch->cx * CHUNK_SIZE;
+        float originY = (float)ch->cy * CHUNK_SIZE;
+        if (originX - RENDER_CHUNK_PAD > visRight || originX + CHUNK_SIZE + RENDER_CHUNK_PAD < visLeft ||
+            originY - RENDER_CHUNK_PAD > visBottom || originY + CHUNK_SIZE + RENDER_CHUNK_PAD < visTop) continue;
+        for (int d = 0; d < ch->numDunes; d++) {
+            const DuneLine *dune = &ch->dunes[d];
+            if (dune->width * camera.zoom < LOD_DUNE_MIN_PX) continue;
+            for (int p = 0; p < dune->numPts - 1; p++) {
+                DrawLineEx(dune->pts[p], dune->pts[p + 1], dune->width, COL_DUNE_LINE);
+            }
         }
     }
 }
@@ -1228,9 +7443,10 @@ void DrawGround(GroundCircle *circles, int circleCount,
 // ---------------------------------------------------------------------------
 // DrawTerrainAccents  — dune/debris sprites scattered across the desert
 // ---------------------------------------------------------------------------
-void DrawTerrainAccents(TerrainAccent *accents, int count, Sprites *spr)
+void DrawTerrainAccents(TerrainAccent *accents, int count, Sprites *spr, float zoom)
 {
     float targetSize = 64.0f;
+    if (targetSize * zoom < LOD_ACCENT_MIN_PX) return;
     for (int i = 0; i < count; i++) {
         Texture2D tex;
         if (accents[i].spriteIdx == 3) {
@@ -1341,70 +7557,75 @@ void DrawParallaxDunes(ParallaxDune *dunes, int count, Camera2D camera,
 }
 
 // ---------------------------------------------------------------------------
-// DrawHeatShimmer (world space edges)
+// DrawHeatShimmer (world space, view edges once out in the deep desert)
 // ---------------------------------------------------------------------------
 void DrawHeatShimmer(Camera2D camera, int screenWidth, int screenHeight, float pulseTimer)
 {
-    // Visible world area
-    float visLeft   = camera.target.x - camera.offset.x;
-    float visTop    = camera.target.y - camera.offset.y;
-    float visRight  = visLeft + screenWidth;
-    float visBottom = visTop  + screenHeight;
+    // No shimmer near the village
+    Vector2 villageCenter = { VILLAGE_X, VILLAGE_Y };
+    if (Vector2Distance(camera.target, villageCenter) < HEAT_SHIMMER_RADIUS) return;
+
+    // Visible world area; spacing, lengths and widths are in screen pixels
+    // scaled by px so the effect looks the same at any zoom
+    float px        = 1.0f / camera.zoom;
+    float visLeft   = camera.target.x - camera.offset.x * px;
+    float visTop    = camera.target.y - camera.offset.y * px;
+    float visRight  = visLeft + screenWidth  * px;
+    float visBottom = visTop  + screenHeight * px;
 
     Color shimmerColor = { 212, 196, 168, 30 };
-    float edgeDist = 400.0f;
     int numLines = 20;
-    float spacing = 15.0f;
+    float spacing = 15.0f * px;
 
     // Left edge shimmer
-    if (visLeft < edgeDist) {
+    {
         for (int li = 0; li < numLines; li++) {
             float worldY = visTop + li * spacing;
-            float waveY  = worldY + sinf(pulseTimer * 3.0f + visLeft * 0.05f) * 2.0f;
-            float lineLen = (float)GetRandomValue(20, 40);
+            float waveY  = worldY + sinf(pulseTimer * 3.0f + visLeft * 0.05f) * 2.0f * px;
+            float lineLen = (float)GetRandomValue(20, 40) * px;
             DrawLineEx(
-                (Vector2){ visLeft + 10.0f, waveY },
-                (Vector2){ visLeft + 10.0f + lineLen, waveY },
-                1.0f, shimmerColor
+                (Vector2){ visLeft + 10.0f * px, waveY },
+                (Vector2){ visLeft + 10.0f * px + lineLen, waveY },
+                px, shimmerColor
             );
         }
     }
     // Right edge shimmer
-    if (visRight > WORLD_WIDTH - edgeDist) {
+    {
         for (int li = 0; li < numLines; li++) {
             float worldY = visTop + li * spacing;
-            float waveY  = worldY + sinf(pulseTimer * 3.0f + visRight * 0.05f) * 2.0f;
-            float lineLen = (float)GetRandomValue(20, 40);
+            float waveY  = worldY + sinf(pulseTimer * 3.0f + visRight * 0.05f) * 2.0f * px;
+            float lineLen = (float)GetRandomValue(20, 40) * px;
             DrawLineEx(
-                (Vector2){ visRight - 10.0f - lineLen, waveY },
-                (Vector2){ visRight - 10.0f, waveY },
-                1.0f, shimmerColor
+                (Vector2){ visRight - 10.0f * px - lineLen, waveY },
+                (Vector2){ visRight - 10.0f * px, waveY },
+                px, shimmerColor
             );
         }
     }
     // Top edge shimmer
-    if (visTop < edgeDist) {
+    {
         for (int li = 0; li < numLines; li++) {
             float worldX = visLeft + li * spacing;
-            float waveX  = worldX + sinf(pulseTimer * 3.0f + worldX * 0.05f) * 2.0f;
-            float lineLen = (float)GetRandomValue(20, 40);
+            float waveX  = worldX + sinf(pulseTimer * 3.0f + worldX * 0.05f) * 2.0f * px;
+            float lineLen = (float)GetRandomValue(20, 40) * px;
             DrawLineEx(
-                (Vector2){ waveX, visTop + 10.0f },
-                (Vector2){ waveX, visTop + 10.0f + lineLen },
-                1.0f, shimmerColor
+                (Vector2){ waveX, visTop + 10.0f * px },
+                (Vector2){ waveX, visTop + 10.0f * px + lineLen },
+                px, shimmerColor
             );
         }
     }
     // Bottom edge shimmer
-    if (visBottom > WORLD_HEIGHT - edgeDist) {
+    {
         for (int li = 0; li < numLines; li++) {
             float worldX = visLeft + li * spacing;
-            float waveX  = worldX + sinf(pulseTimer * 3.0f + worldX * 0.05f) * 2.0f;
-            float lineLen = (float)GetRandomValue(20, 40);
+            float waveX  = worldX + sinf(pulseTimer * 3.0f + worldX * 0.05f) * 2.0f * px;
+            float lineLen = (float)GetRandomValue(20, 40) * px;
             DrawLineEx(
-                (Vector2){ waveX, visBottom - 10.0f - lineLen },
-                (Vector2){ waveX, visBottom - 10.0f },
-                1.0f, shimmerColor
+                (Vector2){ waveX, visBottom - 10.0f * px - lineLen },
+                (Vector2){ waveX, visBottom - 10.0f * px },
+                px, shimmerColor
             );
         }
     }
@@ -1679,13 +7900,12 @@ void DrawDetailedBuilding(Rectangle base, bool hasWorkbench, float pulseTimer,
 void DrawVillage(float pulseTimer, bool isNight, float shadowOffsetX, float shadowOffsetY,
                  Sprites *spr)
 {
-    Vector2 villageCenter = { WORLD_WIDTH / 2.0f, WORLD_HEIGHT / 2.0f };
-
-    // Building rectangles remain IDENTICAL to original (WORKBENCH_X/Y depends on building1)
-    Rectangle building1 = { villageCenter.x - 100, villageCenter.y - 80, 80, 60 };
-    Rectangle building2 = { villageCenter.x + 40,  villageCenter.y - 60, 70, 50 };
-    Rectangle building3 = { villageCenter.x - 80,  villageCenter.y + 40, 60, 55 };
-    Rectangle building4 = { villageCenter.x + 50,  villageCenter.y + 50, 65, 50 };
+    Rectangle buildings[NUM_VILLAGE_BUILDINGS];
+    VillageBuildingRects(buildings);
+    Rectangle building1 = buildings[0];
+    Rectangle building2 = buildings[1];
+    Rectangle building3 = buildings[2];
+    Rectangle building4 = buildings[3];
 
     // building_1 sprite index 0 = main building with workbench
     DrawDetailedBuilding(building1, true,  pulseTimer, 0, isNight, shadowOffsetX, shadowOffsetY, spr, 0);
@@ -1722,7 +7942,7 @@ void DrawVillage(float pulseTimer, bool isNight, float shadowOffsetX, float shad
 void DrawCityGate(CityBuildings *cityBuildings, float pulseTimer, bool isNight, Texture2D gateSpr)
 {
     (void)gateSpr;
-    Vector2 villageCenter = { WORLD_WIDTH / 2.0f, WORLD_HEIGHT / 2.0f };
+    Vector2 villageCenter = { VILLAGE_X, VILLAGE_Y };
     Vector2 gatePos       = { villageCenter.x + 200, villageCenter.y };
 
     // City background buildings at varying heights
@@ -1736,11 +7956,13 @@ void DrawCityGate(CityBuildings *cityBuildings, float pulseTimer, bool isNight,
     }
 
     // Gate pillar dimensions
-    int pillarW = 20;
-    int pillarH = 80;
-    int leftPillarX  = (int)(gatePos.x - 10);
-    int rightPillarX = (int)(gatePos.x + 50);
-    int pillarY      = (int)(gatePos.y - 60);
+    Rectangle pillars[2];
+    GatePillarRects(pillars);
+    int pillarW = (int)pillars[0].width;
+    int pillarH = (int)pillars[0].height;
+    int leftPillarX  = (int)pillars[0].x;
+    int rightPillarX = (int)pillars[1].x;
+    int pillarY      = (int)pillars[0].y;
 
     // Pillars
     DrawRectangle(leftPillarX,  pillarY, pillarW, pillarH, COL_GATE_PILLAR);
@@ -1793,17 +8015,29 @@ void DrawWorldItems(WorldItem *items, int count, Vector2 playerPos,
                     float shadowOffsetX, float shadowOffsetY, bool isNight,
                     Sprites *spr)
 {
-    (void)camera;
     (void)isNight;
 
     float targetItemSize = 32.0f;
 
+    // Too small to read as a sprite: a colored point of fixed on-screen size
+    if (targetItemSize * camera.zoom < LOD_POINT_SPRITE_PX) {
+        float pointSize = 4.0f / camera.zoom;
+        for (int i = 0; i < count; i++) {
+            if (!items[i].active) continue;
+            Vector2 pos = items[i].position;
+            DrawRectangleV((Vector2){ pos.x - pointSize / 2.0f, pos.y - pointSize / 2.0f },
+                           (Vector2){ pointSize, pointSize }, itemTable.types[items[i].typeIndex].color);
+        }
+        return;
+    }
+    bool showLabels = camera.zoom >= LOD_LABEL_MIN_ZOOM;
+
     for (int i = 0; i < count; i++) {
         if (!items[i].active) continue;
 
         Vector2 pos       = items[i].position;
         int     typeIdx   = items[i].typeIndex;
-        Color   itemColor = ITEM_TYPES[typeIdx].color;
+        Color   itemColor = itemTable.types[typeIdx].color;
         float   dist      = Vector2Distance(playerPos, pos);
         bool    inRange   = (dist <= PICKUP_RADIUS);
 
@@ -1828,26 +8062,24 @@ void DrawWorldItems(WorldItem *items, int count, Vector2 playerPos,
             DrawEllipse((int)(pos.x + 2), (int)(pos.y + 2), 12, 4, COL_SHADOW);
         }
 
-        // Draw item sprite (typeIdx 0-4 maps to spr->item[0-4])
-        if (typeIdx >= 0 && typeIdx < 5 && spr->item[typeIdx].width > 0) {
-            Texture2D *itex = &spr->item[typeIdx];
-            float scale = targetItemSize / (float)itex->width;
-            float drawW = itex->width  * scale;
-            float drawH = itex->height * scale;
-            float drawX = pos.x - drawW / 2.0f;
-            float drawY = pos.y - drawH / 2.0f;
-            DrawTextureEx(*itex, (Vector2){ drawX, drawY }, 0.0f, scale, WHITE);
+        // Draw item sprite from the atlas
+        Rectangle src = itemTable.types[typeIdx].atlasRect;
+        if (src.width > 0.0f) {
+            float drawW = targetItemSize;
+            float drawH = targetItemSize * src.height / src.width;
+            Rectangle dst = { pos.x - drawW / 2.0f, pos.y - drawH / 2.0f, drawW, drawH };
+            DrawTexturePro(spr->itemAtlas, src, dst, (Vector2){ 0.0f, 0.0f }, 0.0f, WHITE);
         } else {
             // Fallback: colored circle
             DrawCircleV(pos, 10.0f, itemColor);
         }
 
         // Floating label when player is within pickup radius (keep original)
-        if (inRange) {
+        if (inRange && showLabels) {
             char label[64];
             int condPct = (int)(items[i].condition * 100.0f);
             snprintf(label, sizeof(label), "%s %d%%",
-                     ITEM_TYPES[typeIdx].name, condPct);
+                     itemTable.types[typeIdx].name, condPct);
 
             int fontSize = 14;
             int labelW   = MeasureText(label, fontSize);
@@ -1866,31 +8098,39 @@ void DrawWorldItems(WorldItem *items, int count, Vector2 playerPos,
 // ---------------------------------------------------------------------------
 // UpdateParticles
 // ---------------------------------------------------------------------------
-void UpdateParticles(Particle *particles, int count, float deltaTime)
+// fieldScale grows the field with the zoomed-out view (1 / zoom)
+void UpdateParticles(Particle *particles, int count, Vector2 center, float fieldScale,
+                     float deltaTime)
 {
+    float fieldW = PARTICLE_FIELD_HALF_W * 2 * fieldScale;
+    float fieldH = PARTICLE_FIELD_HALF_H * 2 * fieldScale;
+    float minX = center.x - fieldW / 2.0f;
+    float minY = center.y - fieldH / 2.0f;
     for (int i = 0; i < count; i++) {
-        particles[i].position.x += particles[i].velocity.x * deltaTime;
-        particles[i].position.y += particles[i].velocity.y * deltaTime;
-
-        // Wrap around world
-        if (particles[i].position.x < 0)            particles[i].position.x = WORLD_WIDTH;
-        if (particles[i].position.x > WORLD_WIDTH)  particles[i].position.x = 0;
-        if (particles[i].position.y < 0)             particles[i].position.y = WORLD_HEIGHT;
-        if (particles[i].position.y > WORLD_HEIGHT)  particles[i].position.y = 0;
+        particles[i].position.x += particles[i].velocity.x * fieldScale * deltaTime;
+        particles[i].position.y += particles[i].velocity.y * fieldScale * deltaTime;
+
+        // Wrap around the field that follows the camera (modulo, since zooming
+        // in can shrink the field by more than its own size in one frame)
+        float rx = fmodf(particles[i].position.x - minX, fieldW);
+        float ry = fmodf(particles[i].position.y - minY, fieldH);
+        particles[i].position.x = minX + (rx < 0.0f ? rx + fieldW : rx);
+        particles[i].position.y = minY + (ry < 0.0f ? ry + fieldH : ry);
     }
 }
 
 // ---------------------------------------------------------------------------
 // DrawParticles
 // ---------------------------------------------------------------------------
-void DrawParticles(Particle *particles, int count)
+// Dots keep their on-screen size; zoomed out, only a zoom-proportional share is drawn
+void DrawParticles(Particle *particles, int count, float zoom)
 {
     Color particleColor = { 212, 196, 168, 96 };
-    for (int i = 0; i < count; i++) {
+    int drawn = (zoom >= 1.0f) ? count : (int)ceilf(count * zoom);
+    for (int i = 0; i < drawn; i++) {
         // Alternate 1px and 2px dots
-        int r = (i % 2 == 0) ? 1 : 2;
-        DrawCircle((int)particles[i].position.x, (int)particles[i].position.y,
-                   r, particleColor);
+        float r = ((i % 2 == 0) ? 1.0f : 2.0f) / fminf(zoom, 1.0f);
+        DrawCircleV(particles[i].position, r, particleColor);
     }
 }
 
@@ -1908,21 +8148,17 @@ void DrawPickupEffect(PickupEffect *effect, Camera2D camera)
 }
 
 // ---------------------------------------------------------------------------
-// DrawInventoryScreen
+// UI layout  — where each screen's controls sit for a given model and screen
+// size. HitTestUi resolves the frame's clicks against it before anything is
+// drawn; the Draw* functions below draw from the same rectangles.
 // ---------------------------------------------------------------------------
-void DrawInventoryScreen(InventorySlot *inventory, int maxInv,
-                         int *inventoryTab, int dataLogsPurchased,
-                         bool *dataLogViewerOpen, int *dataLogViewerIndex)
+InventoryLayout InventoryLayoutFor(int maxInventory, int sw, int sh)
 {
-    int sw = GetScreenWidth();
-    int sh = GetScreenHeight();
-
-    // Semi-transparent overlay
-    DrawRectangle(0, 0, sw, sh, (Color){ 26, 26, 46, 200 });
+    InventoryLayout layout;
 
     // Panel — fixed height to accommodate both tabs comfortably
     int panelW = 560;
-    int panelH = 82 + maxInv * 44 + 30;
+    int panelH = 82 + maxInventory * 44 + 30;
     if (panelH < 500) panelH = 500;
     // Logs tab needs 5*64 + padding = 370 at minimum; add header space
     int logsNeeded = 46 + 34 + 10 + 5 * 64 + 30; // title + tabs + padding + rows + footer
@@ -1930,6 +8166,228 @@ void DrawInventoryScreen(InventorySlot *inventory, int maxInv,
     int panelX = sw / 2 - panelW / 2;
     int panelY = sh / 2 - panelH / 2;
     int pad    = 12;
+    layout.panel = (Rectangle){ panelX, panelY, panelW, panelH };
+
+    int tabY   = panelY + 56;
+    int tabH   = 34;
+    int tabW   = 120;
+    int tabGap = 8;
+    int tabsStartX = panelX + panelW / 2 - (tabW * 2 + tabGap) / 2;
+    for (int t = 0; t < 2; t++) {
+        layout.tabs[t] = (Rectangle){ tabsStartX + t * (tabW + tabGap), tabY, tabW, tabH };
+    }
+
+    int logRowH   = 64;
+    int logStartY = tabY + tabH + 8 + 4;
+    for (int i = 0; i < 5; i++) {
+        layout.logRows[i] = (Rectangle){ panelX + pad, logStartY + i * logRowH, panelW - pad * 2, logRowH };
+    }
+    return layout;
+}
+
+WorkbenchLayout WorkbenchLayoutFor(int maxInventory, int sw, int sh)
+{
+    WorkbenchLayout layout;
+    int panelW = 900;
+    int panelH = 560;
+    int panelX = sw / 2 - panelW / 2;
+    int panelY = sh / 2 - panelH / 2;
+    layout.panel = (Rectangle){ panelX, panelY, panelW, panelH };
+
+    // Inventory rows down the left, under their header
+    int rowH      = 52;
+    int invStartY = panelY + 56 + 22;
+    for (int i = 0; i < maxInventory && i < MAX_INVENTORY; i++) {
+        layout.rows[i] = (Rectangle){ panelX + 20, invStartY + i * rowH, 240, rowH - 2 };
+    }
+
+    int rightPanelX = panelX + 660;
+    int rightPanelW = 220;
+    layout.repairButton = (Rectangle){ rightPanelX + (rightPanelW - 160) / 2, panelY + 80, 160, 50 };
+    layout.closeButton  = (Rectangle){ panelX + panelW - 140, panelY + panelH - 50, 120, 36 };
+    return layout;
+}
+
+TradeLayout TradeLayoutFor(int maxInventory, int sw, int sh)
+{
+    TradeLayout layout;
+    int panelW = 940;
+    int panelH = 580;
+    int panelX = sw / 2 - panelW / 2;
+    int panelY = sh / 2 - panelH / 2;
+    layout.panel = (Rectangle){ panelX, panelY, panelW, panelH };
+
+    // Goods down the left, under their header
+    int rowH  = 48;
+    int leftY = panelY + 66 + 20;
+    for (int i = 0; i < maxInventory && i < MAX_INVENTORY; i++) {
+        layout.rows[i] = (Rectangle){ panelX + 16, leftY + i * rowH, 260, rowH - 2 };
+    }
+
+    // The TRADE button sits under the coin, clear of it even while it swells
+    int centerX = panelX + 292;
+    int centerW = 200;
+    int coinCY  = panelY + 66 + 24 + 40;
+    int coinR   = 32;
+    layout.tradeButton = (Rectangle){ centerX + centerW / 2 - 80, coinCY + coinR + 12 + 14, 160, 44 };
+
+    int shopX = panelX + 508;
+    int shopW = 416;
+    int shopY = panelY + 66 + 22;
+    int cardW = 390;
+    int cardH = 68;
+    int cardX = shopX + (shopW - cardW) / 2;
+    for (int k = 0; k < 3; k++) {
+        int cardY = shopY + (cardH + 8) * k;
+        layout.cards[k]      = (Rectangle){ cardX, cardY, cardW, cardH };
+        layout.buyButtons[k] = (Rectangle){ cardX + cardW - 80 - 8, cardY + cardH / 2 - 16, 80, 32 };
+    }
+
+    layout.closeButton = (Rectangle){ panelX + panelW / 2 - 70, panelY + panelH - 36 - 12, 140, 36 };
+    return layout;
+}
+
+DataLogLayout DataLogLayoutFor(int sw, int sh)
+{
+    DataLogLayout layout;
+    int panelW = 760;
+    int panelH = 580;
+    int panelX = sw / 2 - panelW / 2;
+    int panelY = sh / 2 - panelH / 2;
+    layout.panel       = (Rectangle){ panelX, panelY, panelW, panelH };
+    layout.closeButton = (Rectangle){ panelX + panelW / 2 - 60, panelY + panelH - 36 - 12, 120, 36 };
+    return layout;
+}
+
+// Rebuild the cached layouts if the screen size or pack capacity changed
+bool UpdateUiLayouts(UiLayouts *layouts, int maxInventory, int sw, int sh)
+{
+    if (layouts->width == sw && layouts->height == sh && layouts->maxInventory == maxInventory) return false;
+    layouts->width        = sw;
+    layouts->height       = sh;
+    layouts->maxInventory = maxInventory;
+    layouts->inventory    = InventoryLayoutFor(maxInventory, sw, sh);
+    layouts->workbench    = WorkbenchLayoutFor(maxInventory, sw, sh);
+    layouts->trade        = TradeLayoutFor(maxInventory, sw, sh);
+    layouts->dataLog      = DataLogLayoutFor(sw, sh);
+    return true;
+}
+
+static bool CanBuyUpgrade(const UiModel *ui, ShopUpgrade upgrade)
+{
+    switch (upgrade) {
+    case UPGRADE_DATA_LOG:     return ui->dataLogsPurchased < 5 && ui->tokenCount >= 2 + ui->dataLogsPurchased;
+    case UPGRADE_REPAIR_TOOLS: return !ui->toolUpgradePurchased && ui->tokenCount >= 3;
+    case UPGRADE_PACK:         return !ui->carryUpgradePurchased && ui->tokenCount >= 4;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// HitTestUi  — this frame's clicks, in the order they were sampled, go to the
+// topmost open screen (data log viewer, trade, workbench, inventory); ESC
+// closes every open screen that has a close action, as before
+// ---------------------------------------------------------------------------
+void HitTestUi(const UiModel *ui, const UiLayouts *layouts, const UiInput *in, CommandQueue *commands,
+               UiFeedback *feedback)
+{
+    if (ui->dataLogViewerOpen && (ui->dataLogViewerIndex < 0 || ui->dataLogViewerIndex >= 5)) {
+        PushCommand(commands, UI_CMD_CLOSE_LOG, 0, GetTime());
+    }
+
+    for (int e = 0; e < in->count; e++) {
+        Vector2 pos = in->events[e].pos;
+        double time = in->events[e].time;
+
+        if (in->events[e].back) {
+            if (ui->dataLogViewerOpen) PushCommand(commands, UI_CMD_CLOSE_LOG, 0, time);
+            if (ui->tradeScreenOpen) PushCommand(commands, UI_CMD_CLOSE_TRADE, 0, time);
+            if (ui->workbenchState == WB_OPEN) {
+                PushCommand(commands, UI_CMD_CLOSE_WORKBENCH, 0, time);
+                // small flash on close
+                feedback->pickupFlashTimer = feedback->pickupFlashMax * 0.5f;
+            }
+            continue;
+        }
+
+        if (ui->dataLogViewerOpen) {
+            if (CheckCollisionPointRec(pos, layouts->dataLog.closeButton)) {
+                PushCommand(commands, UI_CMD_CLOSE_LOG, 0, time);
+            }
+        } else if (ui->tradeScreenOpen) {
+            const TradeLayout *layout = &layouts->trade;
+            for (int i = 0; i < ui->maxInventory; i++) {
+                if (TradeableSlot(ui, i) && CheckCollisionPointRec(pos, layout->rows[i])) {
+                    PushCommand(commands, UI_CMD_SELECT_TRADE_SLOT, i, time);
+                }
+            }
+            if (TradeableSlot(ui, ui->selectedTradeSlot) && CheckCollisionPointRec(pos, layout->tradeButton)) {
+                // Item for a token
+                PushCommand(commands, UI_CMD_TRADE, 0, time);
+            }
+            for (int k = 0; k < 3; k++) {
+                if (CanBuyUpgrade(ui, (ShopUpgrade)k) && CheckCollisionPointRec(pos, layout->buyButtons[k])) {
+                    // Buying a data log makes the sim open it
+                    PushCommand(commands, UI_CMD_BUY, k, time);
+                }
+            }
+            if (CheckCollisionPointRec(pos, layout->closeButton)) {
+                PushCommand(commands, UI_CMD_CLOSE_TRADE, 0, time);
+            }
+        } else if (ui->workbenchState != WB_CLOSED) {
+            const WorkbenchLayout *layout = &layouts->workbench;
+            for (int i = 0; i < ui->maxInventory; i++) {
+                if (ui->inventory[i].occupied && CheckCollisionPointRec(pos, layout->rows[i])) {
+                    PushCommand(commands, UI_CMD_PICK_WORKBENCH_SLOT, i, time);
+                }
+            }
+            bool canRepair = ui->workbenchState == WB_OPEN && ui->repairSlot >= 0 && ui->sacrificeSlot >= 0 &&
+                             ui->inventory[ui->repairSlot].occupied && ui->inventory[ui->sacrificeSlot].occupied;
+            if (canRepair && CheckCollisionPointRec(pos, layout->repairButton)) {
+                PushCommand(commands, UI_CMD_START_REPAIR, 0, time);
+            }
+            if (ui->workbenchState == WB_OPEN && CheckCollisionPointRec(pos, layout->closeButton)) {
+                PushCommand(commands, UI_CMD_CLOSE_WORKBENCH, 0, time);
+                feedback->pickupFlashTimer = feedback->pickupFlashMax * 0.5f;
+            }
+        } else if (ui->inventoryOpen) {
+            const InventoryLayout *layout = &layouts->inventory;
+            for (int t = 0; t < 2; t++) {
+                if (CheckCollisionPointRec(pos, layout->tabs[t])) {
+                    PushCommand(commands, UI_CMD_SELECT_TAB, t, time);
+                }
+            }
+            for (int i = 0; ui->inventoryTab == 1 && i < ui->dataLogsPurchased && i < 5; i++) {
+                // Click row or READ button
+                if (CheckCollisionPointRec(pos, layout->logRows[i])) {
+                    PushCommand(commands, UI_CMD_OPEN_LOG, i, time);
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// DrawInventoryScreen
+// ---------------------------------------------------------------------------
+void DrawInventoryScreen(const UiModel *ui, const UiLayouts *layouts, Vector2 mouse)
+{
+    const InventorySlot *inventory = ui->inventory;
+    int maxInv            = ui->maxInventory;
+    int dataLogsPurchased = ui->dataLogsPurchased;
+
+    int sw = layouts->width;
+    int sh = layouts->height;
+    const InventoryLayout *layout = &layouts->inventory;
+
+    // Semi-transparent overlay
+    DrawRectangle(0, 0, sw, sh, (Color){ 26, 26, 46, 200 });
+
+    int panelW = (int)layout->panel.width;
+    int panelH = (int)layout->panel.height;
+    int panelX = (int)layout->panel.x;
+    int panelY = (int)layout->panel.y;
+    int pad    = 12;
 
     DrawRectangle(panelX, panelY, panelW, panelH, COL_UI_BG);
     DrawRectangleLines(panelX, panelY, panelW, panelH, COL_UI_BORDER);
@@ -1945,20 +8403,14 @@ void DrawInventoryScreen(InventorySlot *inventory, int maxInv,
              panelX + panelW - pad, panelY + 50, COL_UI_BORDER);
 
     // --- TAB BUTTONS ---
-    int tabY   = panelY + 56;
-    int tabH   = 34;
-    int tabW   = 120;
-    int tabGap = 8;
-    int tabsStartX = panelX + panelW / 2 - (tabW * 2 + tabGap) / 2;
-
-    Vector2 mouse   = GetMousePosition();
-    bool    clicked = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+    int tabY = (int)layout->tabs[0].y;
+    int tabH = (int)layout->tabs[0].height;
+    int tabW = (int)layout->tabs[0].width;
 
     for (int t = 0; t < 2; t++) {
-        int tx = tabsStartX + t * (tabW + tabGap);
-        bool isActive = (*inventoryTab == t);
-        bool hover    = (mouse.x >= tx && mouse.x < tx + tabW &&
-                         mouse.y >= tabY && mouse.y < tabY + tabH);
+        int tx = (int)layout->tabs[t].x;
+        bool isActive = (ui->inventoryTab == t);
+        bool hover    = CheckCollisionPointRec(mouse, layout->tabs[t]);
 
         Color tabBg     = isActive ? (Color){ 60, 50, 40, 220 } :
                          (hover    ? (Color){ 40, 32, 24, 200 } :
@@ -1974,10 +8426,6 @@ void DrawInventoryScreen(InventorySlot *inventory, int maxInv,
         const char *tabLabel = (t == 0) ? "ITEMS" : "LOGS";
         int tlW = MeasureText(tabLabel, 14);
         DrawText(tabLabel, tx + tabW / 2 - tlW / 2, tabY + tabH / 2 - 7, 14, tabText);
-
-        if (hover && clicked) {
-            *inventoryTab = t;
-        }
     }
 
     int contentY = tabY + tabH + 8;
@@ -1985,7 +8433,7 @@ void DrawInventoryScreen(InventorySlot *inventory, int maxInv,
     // ---------------------------------------------------------------
     // TAB 0: ITEMS
     // ---------------------------------------------------------------
-    if (*inventoryTab == 0) {
+    if (ui->inventoryTab == 0) {
         // Column headers
         DrawText("ITEM",      panelX + pad + 8,  contentY, 13, COL_UI_DIM);
         DrawText("TYPE",      panelX + 230,       contentY, 13, COL_UI_DIM);
@@ -2004,7 +8452,7 @@ void DrawInventoryScreen(InventorySlot *inventory, int maxInv,
             }
 
             if (inventory[i].occupied) {
-                const ItemTypeDef *def = &ITEM_TYPES[inventory[i].typeIndex];
+                const ItemTypeDef *def = &itemTable.types[inventory[i].typeIndex];
                 float cond = inventory[i].condition;
 
                 // TRADE: gold border around row if condition >= 0.8
@@ -2081,14 +8529,13 @@ void DrawInventoryScreen(InventorySlot *inventory, int maxInv,
             "TECHNICAL — UNCLASSIFIED"
         };
 
-        int logRowH  = 64;
-        int logStartY = contentY + 4;
+        int logRowH  = (int)layout->logRows[0].height;
         int rowInnerPad = 10;
 
         for (int i = 0; i < 5; i++) {
-            int rowX = panelX + pad;
-            int rowW = panelW - pad * 2;
-            int rowY = logStartY + i * logRowH;
+            int rowX = (int)layout->logRows[i].x;
+            int rowW = (int)layout->logRows[i].width;
+            int rowY = (int)layout->logRows[i].y;
 
             // Divider above each row except first
             if (i > 0) {
@@ -2097,8 +8544,7 @@ void DrawInventoryScreen(InventorySlot *inventory, int maxInv,
             }
 
             bool acquired = (i < dataLogsPurchased);
-            bool rowHover = (mouse.x >= rowX && mouse.x < rowX + rowW &&
-                             mouse.y >= rowY && mouse.y < rowY + logRowH);
+            bool rowHover = CheckCollisionPointRec(mouse, layout->logRows[i]);
 
             if (acquired) {
                 // Hover highlight
@@ -2164,12 +8610,6 @@ void DrawInventoryScreen(InventorySlot *inventory, int maxInv,
                          readBtnY + readBtnH / 2 - 6, 12,
                          (Color){ 212, 165, 116, 255 });
 
-                // Click row or READ button
-                if (clicked && rowHover) {
-                    *dataLogViewerOpen  = true;
-                    *dataLogViewerIndex = i;
-                }
-
             } else {
                 // LOCKED row
                 // Lock icon: small rect + circle on top
@@ -2207,8 +8647,6 @@ void DrawInventoryScreen(InventorySlot *inventory, int maxInv,
 void DrawHUD(InventorySlot *inventory, int screenWidth, int maxInv, int tokenCount,
              float tokenAnimTimer, int tokenAnimDelta)
 {
-    (void)tokenAnimDelta;
-
     int count = 0;
     for (int i = 0; i < maxInv; i++) {
         if (inventory[i].occupied) count++;
@@ -2252,9 +8690,86 @@ void DrawHUD(InventorySlot *inventory, int screenWidth, int maxInv, int tokenCou
         float progress = 1.0f - (tokenAnimTimer / 0.4f); // 0..1
         int floatY = coinCY - 10 - (int)(progress * 20.0f);
         unsigned char fa = (unsigned char)((1.0f - progress) * 200.0f);
-        DrawText(tokenAnimDelta > 0 ? "+1" : "-1",
-                 coinX - 8, floatY, 14, (Color){ 255, 240, 100, fa });
+        char deltaStr[16];
+        snprintf(deltaStr, sizeof(deltaStr), "%+d", tokenAnimDelta);
+        DrawText(deltaStr, coinX - 8, floatY, 14, (Color){ 255, 240, 100, fa });
+    }
+}
+
+// ---------------------------------------------------------------------------
+// DrawPerfOverlay  — frame pacing, sim timings, input latency and the last
+// autosave (F3)
+// ---------------------------------------------------------------------------
+void DrawPerfOverlay(const PerfStats *perf, const InputLatency *latency, const FramePacing *pacing,
+                     int fps, float frameTime)
+{
+    char lines[10][64];
+    int n = 0;
+    snprintf(lines[n++], sizeof(lines[0]), "FPS %d  frame %.2f ms", fps, frameTime * 1000.0f);
+    if (pacing->targetHz > 0) {
+        snprintf(lines[n++], sizeof(lines[0]), "cap %d Hz  jitter %.2f ms (max %.2f)  late %.2f ms",
+                 pacing->targetHz, pacing->jitterMs, pacing->maxJitterMs, pacing->lateMs);
+    } else {
+        snprintf(lines[n++], sizeof(lines[0]), "uncapped  jitter %.2f ms (max %.2f)",
+                 pacing->jitterMs, pacing->maxJitterMs);
+    }
+    snprintf(lines[n++], sizeof(lines[0]), "sim tick %.2f ms  deferred %.2f ms", perf->tickMs, perf->deferredMs);
+    if (latency->count > 0) {
+        snprintf(lines[n++], sizeof(lines[0]), "input->sim %.1f ms  input->frame %.1f ms",
+                 perf->inputToSimMs, latency->lastMs);
+        snprintf(lines[n++], sizeof(lines[0]), "  frame avg %.1f ms  max %.1f ms", latency->avgMs, latency->maxMs);
+    }
+    if (perf->autosave.slot < 0) {
+        snprintf(lines[n++], sizeof(lines[0]), "autosave: none yet%s", perf->autosaveBusy ? " (writing)" : "");
+    } else {
+        snprintf(lines[n++], sizeof(lines[0]), "autosave slot %d%s", perf->autosave.slot,
+                 perf->autosaveBusy ? " (writing next)" : "");
+        snprintf(lines[n++], sizeof(lines[0]), "  copy %.1f us (sim)  write %.2f ms (bg)",
+                 perf->autosaveCopyUs, perf->autosave.writeMs);
+        snprintf(lines[n++], sizeof(lines[0]), "  %d KB packed to %d KB",
+                 (int)(perf->autosave.rawBytes / 1024), (int)(perf->autosave.packedBytes / 1024));
+    }
+    if (perf->autosaveFailures > 0) {
+        snprintf(lines[n++], sizeof(lines[0]), "autosave failures: %d", perf->autosaveFailures);
+    }
+    snprintf(lines[n++], sizeof(lines[0]), "rewind %d ticks  %d KB  record %.1f us",
+             perf->rewindFrames, (int)(perf->rewindBytes / 1024), perf->rewindRecordUs);
+
+    int fontSize = 10, lineH = 14, pad = 8;
+    int w = 0;
+    for (int i = 0; i < n; i++) {
+        int lw = MeasureText(lines[i], fontSize);
+        if (lw > w) w = lw;
+    }
+    int x = 10, y = 120;
+    DrawRectangle(x, y, w + pad * 2, n * lineH + pad * 2 - 4, COL_UI_BG);
+    DrawRectangleLines(x, y, w + pad * 2, n * lineH + pad * 2 - 4, COL_UI_BORDER);
+    for (int i = 0; i < n; i++) {
+        DrawText(lines[i], x + pad, y + pad + i * lineH, fontSize, i == 0 ? COL_UI_HEADER : COL_UI_TEXT);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// DrawRewindBanner  — where the scrub cursor is and how to move it (F7)
+// ---------------------------------------------------------------------------
+void DrawRewindBanner(const RewindStatus *status, int screenWidth)
+{
+    char title[64], detail[64];
+    snprintf(title, sizeof(title), "REWIND  -%.2f s  (frame %d / %d)",
+             status->secondsBack, status->frame + 1, status->frames);
+    if (status->hitchMs > 0.0f) {
+        snprintf(detail, sizeof(detail), "next tick hitched: %.1f ms", status->hitchMs);
+    } else {
+        snprintf(detail, sizeof(detail), "A/D tick  S/W second  F8 hitch  F7 resume");
     }
+    int w = MeasureText(title, 16);
+    int dw = MeasureText(detail, 10);
+    if (dw > w) w = dw;
+    int x = screenWidth / 2 - w / 2 - 10, y = 80;
+    DrawRectangle(x, y, w + 20, 44, COL_UI_BG);
+    DrawRectangleLines(x, y, w + 20, 44, COL_UI_BORDER);
+    DrawText(title, x + 10, y + 6, 16, COL_UI_HEADER);
+    DrawText(detail, x + 10, y + 28, 10, status->hitchMs > 0.0f ? (Color){ 230, 120, 90, 255 } : COL_UI_TEXT);
 }
 
 // ---------------------------------------------------------------------------
@@ -2321,25 +8836,24 @@ void DrawSpawnShimmers(SpawnShimmer *shimmers, int count)
 // ---------------------------------------------------------------------------
 // DrawWorkbenchUI  (screen space, called after EndMode2D)
 // ---------------------------------------------------------------------------
-void DrawWorkbenchUI(InventorySlot *inventory, WorkbenchState *workbenchState,
-                     int *repairSlot, int *sacrificeSlot,
-                     float *repairTimer, bool *repairDone,
-                     float *pickupFlashTimer, float pickupFlashMax,
-                     int maxInv, float baseRepairBonus)
+void DrawWorkbenchUI(const UiModel *ui, const UiLayouts *layouts)
 {
-    (void)repairDone;
+    const InventorySlot *inventory = ui->inventory;
+    int   maxInv          = ui->maxInventory;
+    float baseRepairBonus = ui->baseRepairBonus;
 
-    int sw = GetScreenWidth();
-    int sh = GetScreenHeight();
+    int sw = layouts->width;
+    int sh = layouts->height;
+    const WorkbenchLayout *layout = &layouts->workbench;
 
     // Full-screen dark overlay
     DrawRectangle(0, 0, sw, sh, (Color){ 10, 8, 6, 210 });
 
     // Panel dimensions
-    int panelW = 900;
-    int panelH = 560;
-    int panelX = sw / 2 - panelW / 2;
-    int panelY = sh / 2 - panelH / 2;
+    int panelW = (int)layout->panel.width;
+    int panelH = (int)layout->panel.height;
+    int panelX = (int)layout->panel.x;
+    int panelY = (int)layout->panel.y;
 
     // Panel background + border
     DrawRectangle(panelX, panelY, panelW, panelH, (Color){ 26, 20, 14, 240 });
@@ -2355,34 +8869,29 @@ void DrawWorkbenchUI(InventorySlot *inventory, WorkbenchState *workbenchState,
              (Color){ 212, 165, 116, 100 });
 
     // ---------- LEFT PANEL: Inventory ----------
-    int invPanelX = panelX + 20;
-    int invPanelW = 240;
-    int invStartY = panelY + 56;
-    int rowH      = 52;
-
-    DrawText("INVENTORY", invPanelX, invStartY, 16, (Color){ 212, 165, 116, 255 });
-    invStartY += 22;
+    int invPanelX = (int)layout->rows[0].x;
+    int invPanelW = (int)layout->rows[0].width;
+    int rowH      = (int)layout->rows[0].height + 2;
 
-    bool clicked = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
-    Vector2 mouse = GetMousePosition();
+    DrawText("INVENTORY", invPanelX, panelY + 56, 16, (Color){ 212, 165, 116, 255 });
 
     for (int i = 0; i < maxInv; i++) {
         int rowX = invPanelX;
-        int rowY = invStartY + i * rowH;
+        int rowY = (int)layout->rows[i].y;
 
         // Row background
         DrawRectangle(rowX, rowY, invPanelW, rowH - 2, (Color){ 20, 16, 12, 200 });
 
         // Highlight: repair slot (blue), sacrifice slot (red)
-        if (*repairSlot == i) {
+        if (ui->repairSlot == i) {
             DrawRectangle(rowX, rowY, invPanelW, rowH - 2, (Color){ 60, 100, 160, 40 });
         }
-        if (*sacrificeSlot == i) {
+        if (ui->sacrificeSlot == i) {
             DrawRectangle(rowX, rowY, invPanelW, rowH - 2, (Color){ 160, 60, 60, 40 });
         }
 
         if (inventory[i].occupied) {
-            const ItemTypeDef *def = &ITEM_TYPES[inventory[i].typeIndex];
+            const ItemTypeDef *def = &itemTable.types[inventory[i].typeIndex];
             float cond = inventory[i].condition;
 
             // TRADE: gold border if condition >= 0.8
@@ -2426,21 +8935,6 @@ void DrawWorkbenchUI(InventorySlot *inventory, WorkbenchState *workbenchState,
                 DrawText("TRADE", rowX + invPanelW - 42, rowY + 5, 10,
                          (Color){ 212, 165, 116, 255 });
             }
-
-            // Click detection
-            if (clicked &&
-                mouse.x >= rowX && mouse.x < rowX + invPanelW &&
-                mouse.y >= rowY && mouse.y < rowY + rowH - 2) {
-                if (*repairSlot == i) {
-                    *repairSlot = -1;
-                } else if (*sacrificeSlot == i) {
-                    *sacrificeSlot = -1;
-                } else if (*repairSlot == -1 && i != *sacrificeSlot) {
-                    *repairSlot = i;
-                } else if (*sacrificeSlot == -1 && i != *repairSlot) {
-                    *sacrificeSlot = i;
-                }
-            }
         } else {
             DrawText("- empty -", rowX + 22, rowY + 17, 13,
                      (Color){ 80, 76, 70, 255 });
@@ -2466,9 +8960,9 @@ void DrawWorkbenchUI(InventorySlot *inventory, WorkbenchState *workbenchState,
     DrawRectangleLines(slotBoxX, contentY, slotBoxW, slotBoxH,
                        (Color){ 120, 100, 80, 255 });
 
-    if (*repairSlot >= 0 && inventory[*repairSlot].occupied) {
-        const ItemTypeDef *rdef = &ITEM_TYPES[inventory[*repairSlot].typeIndex];
-        float rcond = inventory[*repairSlot].condition;
+    if (ui->repairSlot >= 0 && inventory[ui->repairSlot].occupied) {
+        const ItemTypeDef *rdef = &itemTable.types[inventory[ui->repairSlot].typeIndex];
+        float rcond = inventory[ui->repairSlot].condition;
         DrawRectangle(slotBoxX + 4, contentY + 6, 12, 12, rdef->color);
         DrawText(rdef->name, slotBoxX + 20, contentY + 5, 12, COL_UI_TEXT);
         DrawText(rdef->categoryName, slotBoxX + 20, contentY + 20, 10,
@@ -2502,9 +8996,9 @@ void DrawWorkbenchUI(InventorySlot *inventory, WorkbenchState *workbenchState,
     DrawRectangleLines(slotBoxX, contentY, slotBoxW, slotBoxH,
                        (Color){ 120, 100, 80, 255 });
 
-    if (*sacrificeSlot >= 0 && inventory[*sacrificeSlot].occupied) {
-        const ItemTypeDef *sdef = &ITEM_TYPES[inventory[*sacrificeSlot].typeIndex];
-        float scond = inventory[*sacrificeSlot].condition;
+    if (ui->sacrificeSlot >= 0 && inventory[ui->sacrificeSlot].occupied) {
+        const ItemTypeDef *sdef = &itemTable.types[inventory[ui->sacrificeSlot].typeIndex];
+        float scond = inventory[ui->sacrificeSlot].condition;
         DrawRectangle(slotBoxX + 4, contentY + 6, 12, 12, sdef->color);
         DrawText(sdef->name, slotBoxX + 20, contentY + 5, 12, COL_UI_TEXT);
         DrawText(sdef->categoryName, slotBoxX + 20, contentY + 20, 10,
@@ -2533,16 +9027,16 @@ void DrawWorkbenchUI(InventorySlot *inventory, WorkbenchState *workbenchState,
     DrawText("RESULT PREVIEW", slotBoxX, contentY, 13, (Color){ 212, 165, 116, 255 });
     contentY += 18;
 
-    bool bothFilled = (*repairSlot >= 0 && *sacrificeSlot >= 0 &&
-                       inventory[*repairSlot].occupied &&
-                       inventory[*sacrificeSlot].occupied);
+    bool bothFilled = (ui->repairSlot >= 0 && ui->sacrificeSlot >= 0 &&
+                       inventory[ui->repairSlot].occupied &&
+                       inventory[ui->sacrificeSlot].occupied);
 
     if (bothFilled) {
-        ItemCategory repCat = ITEM_TYPES[inventory[*repairSlot].typeIndex].category;
-        ItemCategory sacCat = ITEM_TYPES[inventory[*sacrificeSlot].typeIndex].category;
-        bool typeMatch = (repCat == sacCat);
-        float bonus    = typeMatch ? (baseRepairBonus + 0.1f) : baseRepairBonus;
-        float newCond  = inventory[*repairSlot].condition + bonus;
+        const ItemTypeDef *repDef = &itemTable.types[inventory[ui->repairSlot].typeIndex];
+        int sacCat     = itemTable.types[inventory[ui->sacrificeSlot].typeIndex].category;
+        bool typeMatch = (repDef->category == sacCat);
+        float bonus    = typeMatch ? (baseRepairBonus + repDef->repairBonus) : baseRepairBonus;
+        float newCond  = inventory[ui->repairSlot].condition + bonus;
         if (newCond > 1.0f) newCond = 1.0f;
 
         // Result condition bar
@@ -2560,7 +9054,7 @@ void DrawWorkbenchUI(InventorySlot *inventory, WorkbenchState *workbenchState,
 
         if (typeMatch) {
             char matchBuf[32];
-            snprintf(matchBuf, sizeof(matchBuf), "TYPE MATCH +%.2f", baseRepairBonus + 0.1f);
+            snprintf(matchBuf, sizeof(matchBuf), "TYPE MATCH +%.2f", bonus);
             DrawText(matchBuf, prX, prY + 30, 12, (Color){ 100, 200, 100, 255 });
         } else {
             char bonusBuf[16];
@@ -2573,13 +9067,11 @@ void DrawWorkbenchUI(InventorySlot *inventory, WorkbenchState *workbenchState,
     }
 
     // ---------- RIGHT PANEL: Buttons ----------
-    int rightPanelX = panelX + 660;
-    int rightPanelW = 220;
-    int btnX        = rightPanelX + (rightPanelW - 160) / 2;
-    int btnY        = panelY + 80;
+    int btnX = (int)layout->repairButton.x;
+    int btnY = (int)layout->repairButton.y;
 
     // REPAIR BUTTON
-    bool canRepair = (bothFilled && *workbenchState == WB_OPEN);
+    bool canRepair = (bothFilled && ui->workbenchState == WB_OPEN);
     Color repairBtnBg  = canRepair ? (Color){ 80,  140, 80,  220 } : (Color){ 40, 40, 40, 180 };
     Color repairBtnBdr = canRepair ? (Color){ 120, 200, 120, 255 } : (Color){ 80, 80, 80, 255 };
     Color repairBtnTxt = canRepair ? COL_ALMOST_WHITE                : (Color){ 100, 100, 100, 255 };
@@ -2589,22 +9081,15 @@ void DrawWorkbenchUI(InventorySlot *inventory, WorkbenchState *workbenchState,
     int repairTxtW = MeasureText("REPAIR", 18);
     DrawText("REPAIR", btnX + 80 - repairTxtW / 2, btnY + 16, 18, repairBtnTxt);
 
-    if (canRepair && clicked &&
-        mouse.x >= btnX && mouse.x < btnX + 160 &&
-        mouse.y >= btnY && mouse.y < btnY + 50) {
-        *workbenchState = WB_REPAIRING;
-        *repairTimer    = 0.0f;
-    }
-
     btnY += 60;
 
     // PROGRESS BAR (while repairing)
-    if (*workbenchState == WB_REPAIRING) {
+    if (ui->workbenchState == WB_REPAIRING) {
         DrawText("Repairing...", btnX, btnY, 12, COL_UI_DIM);
         btnY += 16;
         int pbX = btnX, pbY = btnY;
         int pbW = 160, pbH = 20;
-        float progress = (*repairTimer >= 2.0f) ? 1.0f : (*repairTimer / 2.0f);
+        float progress = (ui->repairTimer >= 2.0f) ? 1.0f : (ui->repairTimer / 2.0f);
         DrawRectangle(pbX, pbY, pbW, pbH, (Color){ 30, 30, 30, 255 });
         DrawRectangle(pbX, pbY, (int)(progress * pbW), pbH, (Color){ 100, 200, 100, 255 });
         DrawRectangleLines(pbX, pbY, pbW, pbH, (Color){ 212, 165, 116, 255 });
@@ -2612,35 +9097,20 @@ void DrawWorkbenchUI(InventorySlot *inventory, WorkbenchState *workbenchState,
     }
 
     // CLOSE BUTTON (bottom right of panel)
-    int closeBtnX = panelX + panelW - 140;
-    int closeBtnY = panelY + panelH - 50;
+    int closeBtnX = (int)layout->closeButton.x;
+    int closeBtnY = (int)layout->closeButton.y;
     DrawRectangle(closeBtnX, closeBtnY, 120, 36, (Color){ 60, 30, 20, 200 });
     DrawRectangleLines(closeBtnX, closeBtnY, 120, 36, (Color){ 212, 165, 116, 255 });
     int closeTxtW = MeasureText("CLOSE (ESC)", 12);
     DrawText("CLOSE (ESC)", closeBtnX + 60 - closeTxtW / 2, closeBtnY + 12, 12,
              COL_UI_TEXT);
-
-    // Close on ESC or close button click (only if not repairing)
-    if (*workbenchState != WB_REPAIRING) {
-        bool escPressed = IsKeyPressed(KEY_ESCAPE);
-        bool closeBtnClicked = (clicked &&
-                                mouse.x >= closeBtnX && mouse.x < closeBtnX + 120 &&
-                                mouse.y >= closeBtnY && mouse.y < closeBtnY + 36);
-        if (escPressed || closeBtnClicked) {
-            *workbenchState = WB_CLOSED;
-            *repairSlot     = -1;
-            *sacrificeSlot  = -1;
-            // small flash on close
-            *pickupFlashTimer = pickupFlashMax * 0.5f;
-        }
-    }
 }
 
 // ---------------------------------------------------------------------------
 // DrawDataLogViewer  (screen space)
 // Full-screen log reader for the 5 data logs.
 // ---------------------------------------------------------------------------
-void DrawDataLogViewer(int logIndex, bool *open)
+void DrawDataLogViewer(int logIndex, const UiLayouts *layouts, Vector2 mouse)
 {
     // Full display titles (shown in the viewer header)
     static const char *LOG_VIEWER_TITLES[5] = {
@@ -2741,19 +9211,20 @@ void DrawDataLogViewer(int logIndex, bool *open)
         "personal notation. Date"
     };
 
-    if (logIndex < 0 || logIndex >= 5) { *open = false; return; }
+    if (logIndex < 0 || logIndex >= 5) return;   // the hit test closes it
 
-    int sw = GetScreenWidth();
-    int sh = GetScreenHeight();
+    int sw = layouts->width;
+    int sh = layouts->height;
+    const DataLogLayout *layout = &layouts->dataLog;
 
     // Very dark full-screen background
     DrawRectangle(0, 0, sw, sh, (Color){ 8, 6, 4, 252 });
 
     // Parchment-toned text panel
-    int panelW = 760;
-    int panelH = 580;
-    int panelX = sw / 2 - panelW / 2;
-    int panelY = sh / 2 - panelH / 2;
+    int panelW = (int)layout->panel.width;
+    int panelH = (int)layout->panel.height;
+    int panelX = (int)layout->panel.x;
+    int panelY = (int)layout->panel.y;
 
     DrawRectangle(panelX, panelY, panelW, panelH, (Color){ 28, 22, 16, 245 });
     DrawRectangleLines(panelX, panelY, panelW, panelH, (Color){ 212, 165, 116, 255 });
@@ -2851,16 +9322,12 @@ void DrawDataLogViewer(int logIndex, bool *open)
     }
 
     // CLOSE button at bottom center
-    int closeBtnW = 120;
-    int closeBtnH = 36;
-    int closeBtnX = panelX + panelW / 2 - closeBtnW / 2;
-    int closeBtnY = panelY + panelH - closeBtnH - 12;
-
-    Vector2 mouse = GetMousePosition();
-    bool clicked  = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+    int closeBtnW = (int)layout->closeButton.width;
+    int closeBtnH = (int)layout->closeButton.height;
+    int closeBtnX = (int)layout->closeButton.x;
+    int closeBtnY = (int)layout->closeButton.y;
 
-    bool hoverClose = (mouse.x >= closeBtnX && mouse.x < closeBtnX + closeBtnW &&
-                       mouse.y >= closeBtnY && mouse.y < closeBtnY + closeBtnH);
+    bool hoverClose = CheckCollisionPointRec(mouse, layout->closeButton);
     Color closeBg  = hoverClose ? (Color){ 70, 50, 30, 230 } : (Color){ 40, 30, 18, 200 };
 
     DrawRectangle(closeBtnX, closeBtnY, closeBtnW, closeBtnH, closeBg);
@@ -2869,34 +9336,28 @@ void DrawDataLogViewer(int logIndex, bool *open)
     int closeTW = MeasureText("CLOSE", 16);
     DrawText("CLOSE", closeBtnX + closeBtnW / 2 - closeTW / 2, closeBtnY + 10, 16,
              (Color){ 232, 224, 216, 255 });
-
-    if (IsKeyPressed(KEY_ESCAPE) || (clicked && hoverClose)) {
-        *open = false;
-    }
 }
 
 // ---------------------------------------------------------------------------
 // DrawTradeScreenUI  (screen space, called after EndMode2D)
 // ---------------------------------------------------------------------------
-void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
-                       int *tokenCount, bool *tradeScreenOpen,
-                       int *dataLogsPurchased, bool *toolUpgradePurchased,
-                       bool *carryUpgradePurchased, int *maxInventoryPtr,
-                       float *baseRepairBonusPtr, float *tokenAnimTimer,
-                       int *tokenAnimDelta, int *selectedTradeSlot,
-                       bool *dataLogViewerOpen, int *dataLogViewerIndex)
+void DrawTradeScreenUI(const UiModel *ui, const UiFeedback *feedback, const UiLayouts *layouts, Vector2 mouse)
 {
-    int sw = GetScreenWidth();
-    int sh = GetScreenHeight();
+    const InventorySlot *inventory = ui->inventory;
+    int maxInventory = ui->maxInventory;
+
+    int sw = layouts->width;
+    int sh = layouts->height;
+    const TradeLayout *layout = &layouts->trade;
 
     // Full-screen dark overlay
     DrawRectangle(0, 0, sw, sh, (Color){ 10, 8, 6, 200 });
 
     // Panel
-    int panelW = 940;
-    int panelH = 580;
-    int panelX = sw / 2 - panelW / 2;
-    int panelY = sh / 2 - panelH / 2;
+    int panelW = (int)layout->panel.width;
+    int panelH = (int)layout->panel.height;
+    int panelX = (int)layout->panel.x;
+    int panelY = (int)layout->panel.y;
 
     DrawRectangle(panelX, panelY, panelW, panelH, (Color){ 20, 16, 28, 245 });
     DrawRectangleLines(panelX, panelY, panelW, panelH, (Color){ 212, 165, 116, 255 });
@@ -2921,34 +9382,29 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
     DrawLine(panelX + 16, panelY + 58, panelX + panelW - 16, panelY + 58,
              (Color){ 212, 165, 116, 80 });
 
-    bool clicked = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
-    Vector2 mouse = GetMousePosition();
-
     // ----------------------------------------------------------------
     // LEFT PANEL: Inventory (x+16, width 260)
     // ----------------------------------------------------------------
-    int leftX  = panelX + 16;
-    int leftW  = 260;
-    int leftY  = panelY + 66;
+    int leftX  = (int)layout->rows[0].x;
+    int leftY  = (int)layout->rows[0].y;
 
-    DrawText("YOUR GOODS", leftX, leftY, 14, (Color){ 212, 165, 116, 255 });
-    leftY += 20;
+    DrawText("YOUR GOODS", leftX, panelY + 66, 14, (Color){ 212, 165, 116, 255 });
 
-    int rowH  = 48;
-    int iRowW = leftW;
+    int rowH  = (int)layout->rows[0].height + 2;
+    int iRowW = (int)layout->rows[0].width;
 
     for (int i = 0; i < maxInventory; i++) {
         int rowX = leftX;
-        int rowY = leftY + i * rowH;
+        int rowY = (int)layout->rows[i].y;
 
         // Row background
         DrawRectangle(rowX, rowY, iRowW, rowH - 2, (Color){ 26, 20, 14, 200 });
 
         if (inventory[i].occupied) {
-            const ItemTypeDef *def  = &ITEM_TYPES[inventory[i].typeIndex];
+            const ItemTypeDef *def  = &itemTable.types[inventory[i].typeIndex];
             float cond              = inventory[i].condition;
             bool  tradeable         = (cond >= 0.8f);
-            bool  isSelected        = (*selectedTradeSlot == i);
+            bool  isSelected        = (ui->selectedTradeSlot == i);
 
             // Highlight
             if (isSelected) {
@@ -2993,12 +9449,6 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
                 DrawRectangle(badgeX, badgeY, 40, 16, (Color){ 60, 45, 10, 200 });
                 DrawRectangleLines(badgeX, badgeY, 40, 16, (Color){ 212, 165, 116, 255 });
                 DrawText("TRADE", badgeX + 2, badgeY + 3, 10, (Color){ 212, 165, 116, 255 });
-
-                // Clickable
-                if (clicked && mouse.x >= rowX && mouse.x < rowX + iRowW &&
-                    mouse.y >= rowY && mouse.y < rowY + rowH - 2) {
-                    *selectedTradeSlot = (*selectedTradeSlot == i) ? -1 : i;
-                }
             }
         } else {
             DrawText("- empty -", rowX + 20, rowY + rowH / 2 - 7, 12,
@@ -3032,7 +9482,7 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
     // Coin
     int coinCX = centerX + centerW / 2;
     int coinCY = centerY + 40;
-    float coinR = (*tokenAnimTimer > 0.0f) ? 32.0f : 28.0f;
+    float coinR = (feedback->tokenAnimTimer > 0.0f) ? 32.0f : 28.0f;
 
     // Coin shadow
     DrawCircle(coinCX + 2, coinCY + 2, (int)coinR, (Color){ 0, 0, 0, 60 });
@@ -3044,43 +9494,43 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
 
     // Token count inside coin
     char tkBuf[8];
-    snprintf(tkBuf, sizeof(tkBuf), "%d", *tokenCount);
+    snprintf(tkBuf, sizeof(tkBuf), "%d", ui->tokenCount);
     int tkFontSz = 28;
     int tkW = MeasureText(tkBuf, tkFontSz);
     DrawText(tkBuf, coinCX - tkW / 2, coinCY - tkFontSz / 2, tkFontSz,
              (Color){ 40, 26, 8, 255 });
 
     // Floating +/- anim
-    if (*tokenAnimTimer > 0.0f) {
-        float progress = 1.0f - (*tokenAnimTimer / 0.4f);
+    if (feedback->tokenAnimTimer > 0.0f) {
+        float progress = 1.0f - (feedback->tokenAnimTimer / 0.4f);
         int floatY = coinCY - (int)coinR - 10 - (int)(progress * 24.0f);
         unsigned char fa = (unsigned char)((1.0f - progress) * 220.0f);
-        const char *deltaStr = (*tokenAnimDelta > 0) ? "+1" : "-1";
-        Color deltaCol = (*tokenAnimDelta > 0) ?
+        char deltaStr[16];
+        snprintf(deltaStr, sizeof(deltaStr), "%+d", feedback->tokenAnimDelta);
+        Color deltaCol = (feedback->tokenAnimDelta > 0) ?
             (Color){ 100, 230, 100, fa } : (Color){ 230, 100, 100, fa };
         int dtW = MeasureText(deltaStr, 16);
         DrawText(deltaStr, coinCX - dtW / 2, floatY, 16, deltaCol);
     }
 
     // Divider below coin
-    int divY = coinCY + (int)coinR + 12;
+    int divY = (int)layout->tradeButton.y - 14;    // fixed, while the coin swells
     DrawLine(centerX + 10, divY, centerX + centerW - 10, divY,
              (Color){ 212, 165, 116, 60 });
     divY += 14;
 
     // TRADE button
-    int tradeBtnW = 160;
-    int tradeBtnH = 44;
-    int tradeBtnX = centerX + centerW / 2 - tradeBtnW / 2;
-    int tradeBtnY = divY;
+    int tradeBtnW = (int)layout->tradeButton.width;
+    int tradeBtnH = (int)layout->tradeButton.height;
+    int tradeBtnX = (int)layout->tradeButton.x;
+    int tradeBtnY = (int)layout->tradeButton.y;
 
-    bool hasSelected = (*selectedTradeSlot >= 0 &&
-                        *selectedTradeSlot < maxInventory &&
-                        inventory[*selectedTradeSlot].occupied &&
-                        inventory[*selectedTradeSlot].condition >= 0.8f);
+    bool hasSelected = (ui->selectedTradeSlot >= 0 &&
+                        ui->selectedTradeSlot < maxInventory &&
+                        inventory[ui->selectedTradeSlot].occupied &&
+                        inventory[ui->selectedTradeSlot].condition >= 0.8f);
 
-    bool hoverTrade = (mouse.x >= tradeBtnX && mouse.x < tradeBtnX + tradeBtnW &&
-                       mouse.y >= tradeBtnY && mouse.y < tradeBtnY + tradeBtnH);
+    bool hoverTrade = CheckCollisionPointRec(mouse, layout->tradeButton);
 
     Color tradeBtnBg  = hasSelected ?
         (Color){ 60 + (hoverTrade ? 20 : 0), 120 + (hoverTrade ? 20 : 0), 60, 220 } :
@@ -3099,43 +9549,28 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
              tradeBtnY + tradeBtnH / 2 - tradeLblFontSz / 2,
              tradeLblFontSz, tradeLblCol);
 
-    // Trade action
-    if (hasSelected && clicked && hoverTrade) {
-        // Remove item from inventory
-        inventory[*selectedTradeSlot].occupied   = false;
-        inventory[*selectedTradeSlot].condition  = 0.0f;
-        // Give token
-        (*tokenCount)++;
-        *tokenAnimTimer = 0.4f;
-        *tokenAnimDelta = 1;
-        *selectedTradeSlot = -1;
-    }
-
     // ----------------------------------------------------------------
     // RIGHT PANEL: Shop (x+508, width 416)
     // ----------------------------------------------------------------
     int shopX = panelX + 508;
     int shopW = 416;
-    int shopY = panelY + 66;
 
     const char *shopHeader = "AVAILABLE";
     int shopHW = MeasureText(shopHeader, 14);
-    DrawText(shopHeader, shopX + shopW / 2 - shopHW / 2, shopY,
+    DrawText(shopHeader, shopX + shopW / 2 - shopHW / 2, panelY + 66,
              14, (Color){ 212, 165, 116, 255 });
-    shopY += 22;
 
-    int cardW = 390;
-    int cardH = 68;
-    int cardX = shopX + (shopW - cardW) / 2;
+    int cardW = (int)layout->cards[0].width;
+    int cardH = (int)layout->cards[0].height;
+    int cardX = (int)layout->cards[0].x;
 
     // --- DATA LOG card ---
     {
-        int cardY = shopY;
-        bool mouseOver = (mouse.x >= cardX && mouse.x < cardX + cardW &&
-                          mouse.y >= cardY && mouse.y < cardY + cardH);
-        bool complete  = (*dataLogsPurchased >= 5);
-        int  logCost   = 2 + *dataLogsPurchased;
-        bool canAfford = (!complete && *tokenCount >= logCost);
+        int cardY = (int)layout->cards[UPGRADE_DATA_LOG].y;
+        bool mouseOver = CheckCollisionPointRec(mouse, layout->cards[UPGRADE_DATA_LOG]);
+        bool complete  = (ui->dataLogsPurchased >= 5);
+        int  logCost   = 2 + ui->dataLogsPurchased;
+        bool canAfford = (!complete && ui->tokenCount >= logCost);
 
         Color cardBg  = mouseOver ? (Color){ 40, 34, 28, 220 } : (Color){ 30, 24, 20, 200 };
         Color cardBdr = canAfford ? (Color){ 212, 165, 116, 255 } : (Color){ 80, 70, 60, 255 };
@@ -3145,7 +9580,7 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
 
         // Title
         char logTitle[32];
-        snprintf(logTitle, sizeof(logTitle), "Data Log [%d/5]", *dataLogsPurchased);
+        snprintf(logTitle, sizeof(logTitle), "Data Log [%d/5]", ui->dataLogsPurchased);
         DrawText(logTitle, cardX + 10, cardY + 8, 14, (Color){ 232, 224, 210, 255 });
 
         // Description teaser
@@ -3157,7 +9592,7 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
             "A signal from above the clouds. It has been there for years."
         };
         const char *teaser = (complete) ? "All logs recovered." :
-                             LOG_TEASERS[*dataLogsPurchased];
+                             LOG_TEASERS[ui->dataLogsPurchased];
         DrawText(teaser, cardX + 10, cardY + 26, 11, (Color){ 140, 130, 118, 255 });
 
         // Cost or COMPLETE
@@ -3179,13 +9614,13 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
                      (Color){ 170, 160, 140, 255 });
 
             // BUY button
-            int buyBtnW = 80;
-            int buyBtnH = 32;
-            int buyBtnX = cardX + cardW - buyBtnW - 8;
-            int buyBtnY = cardY + cardH / 2 - buyBtnH / 2;
+            Rectangle buyBtn = layout->buyButtons[UPGRADE_DATA_LOG];
+            int buyBtnW = (int)buyBtn.width;
+            int buyBtnH = (int)buyBtn.height;
+            int buyBtnX = (int)buyBtn.x;
+            int buyBtnY = (int)buyBtn.y;
 
-            bool hoverBuy = (mouse.x >= buyBtnX && mouse.x < buyBtnX + buyBtnW &&
-                             mouse.y >= buyBtnY && mouse.y < buyBtnY + buyBtnH);
+            bool hoverBuy = CheckCollisionPointRec(mouse, buyBtn);
             Color buyBg  = canAfford ? (hoverBuy ? (Color){ 70, 55, 20, 230 } :
                                                     (Color){ 50, 38, 12, 200 }) :
                                        (Color){ 30, 28, 24, 160 };
@@ -3198,27 +9633,16 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
             DrawRectangleLines(buyBtnX, buyBtnY, buyBtnW, buyBtnH, buyBdr);
             int buyTW = MeasureText("BUY", 14);
             DrawText("BUY", buyBtnX + buyBtnW / 2 - buyTW / 2, buyBtnY + 9, 14, buyTxt);
-
-            if (canAfford && clicked && hoverBuy) {
-                *tokenCount -= logCost;
-                *tokenAnimTimer = 0.4f;
-                *tokenAnimDelta = -1;
-                // Open the newly purchased log
-                *dataLogViewerIndex = *dataLogsPurchased;
-                (*dataLogsPurchased)++;
-                *dataLogViewerOpen = true;
-            }
         }
     }
 
     // --- TOOL UPGRADE card ---
     {
-        int cardY = shopY + cardH + 8;
-        bool mouseOver = (mouse.x >= cardX && mouse.x < cardX + cardW &&
-                          mouse.y >= cardY && mouse.y < cardY + cardH);
-        bool purchased  = *toolUpgradePurchased;
+        int cardY = (int)layout->cards[UPGRADE_REPAIR_TOOLS].y;
+        bool mouseOver = CheckCollisionPointRec(mouse, layout->cards[UPGRADE_REPAIR_TOOLS]);
+        bool purchased  = ui->toolUpgradePurchased;
         int  toolCost   = 3;
-        bool canAfford  = (!purchased && *tokenCount >= toolCost);
+        bool canAfford  = (!purchased && ui->tokenCount >= toolCost);
 
         Color cardBg  = mouseOver ? (Color){ 40, 34, 28, 220 } : (Color){ 30, 24, 20, 200 };
         Color cardBdr = canAfford ? (Color){ 212, 165, 116, 255 } : (Color){ 80, 70, 60, 255 };
@@ -3244,11 +9668,11 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
             DrawText("tokens", cardX + 30, cardY + cardH - 21, 11,
                      (Color){ 170, 160, 140, 255 });
 
-            int buyBtnW = 80, buyBtnH = 32;
-            int buyBtnX = cardX + cardW - buyBtnW - 8;
-            int buyBtnY = cardY + cardH / 2 - buyBtnH / 2;
-            bool hoverBuy = (mouse.x >= buyBtnX && mouse.x < buyBtnX + buyBtnW &&
-                             mouse.y >= buyBtnY && mouse.y < buyBtnY + buyBtnH);
+            Rectangle buyBtn = layout->buyButtons[UPGRADE_REPAIR_TOOLS];
+            int buyBtnW = (int)buyBtn.width, buyBtnH = (int)buyBtn.height;
+            int buyBtnX = (int)buyBtn.x;
+            int buyBtnY = (int)buyBtn.y;
+            bool hoverBuy = CheckCollisionPointRec(mouse, buyBtn);
             Color buyBg  = canAfford ? (hoverBuy ? (Color){ 70, 55, 20, 230 } :
                                                     (Color){ 50, 38, 12, 200 }) :
                                        (Color){ 30, 28, 24, 160 };
@@ -3258,25 +9682,16 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
             DrawRectangleLines(buyBtnX, buyBtnY, buyBtnW, buyBtnH, buyBdr);
             int buyTW = MeasureText("BUY", 14);
             DrawText("BUY", buyBtnX + buyBtnW / 2 - buyTW / 2, buyBtnY + 9, 14, buyTxt);
-
-            if (canAfford && clicked && hoverBuy) {
-                *tokenCount -= toolCost;
-                *tokenAnimTimer = 0.4f;
-                *tokenAnimDelta = -1;
-                *toolUpgradePurchased = true;
-                *baseRepairBonusPtr   = 0.25f;
-            }
         }
     }
 
     // --- CARRY UPGRADE card ---
     {
-        int cardY = shopY + (cardH + 8) * 2;
-        bool mouseOver = (mouse.x >= cardX && mouse.x < cardX + cardW &&
-                          mouse.y >= cardY && mouse.y < cardY + cardH);
-        bool purchased  = *carryUpgradePurchased;
+        int cardY = (int)layout->cards[UPGRADE_PACK].y;
+        bool mouseOver = CheckCollisionPointRec(mouse, layout->cards[UPGRADE_PACK]);
+        bool purchased  = ui->carryUpgradePurchased;
         int  carryCost  = 4;
-        bool canAfford  = (!purchased && *tokenCount >= carryCost);
+        bool canAfford  = (!purchased && ui->tokenCount >= carryCost);
 
         Color cardBg  = mouseOver ? (Color){ 40, 34, 28, 220 } : (Color){ 30, 24, 20, 200 };
         Color cardBdr = canAfford ? (Color){ 212, 165, 116, 255 } : (Color){ 80, 70, 60, 255 };
@@ -3302,11 +9717,11 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
             DrawText("tokens", cardX + 30, cardY + cardH - 21, 11,
                      (Color){ 170, 160, 140, 255 });
 
-            int buyBtnW = 80, buyBtnH = 32;
-            int buyBtnX = cardX + cardW - buyBtnW - 8;
-            int buyBtnY = cardY + cardH / 2 - buyBtnH / 2;
-            bool hoverBuy = (mouse.x >= buyBtnX && mouse.x < buyBtnX + buyBtnW &&
-                             mouse.y >= buyBtnY && mouse.y < buyBtnY + buyBtnH);
+            Rectangle buyBtn = layout->buyButtons[UPGRADE_PACK];
+            int buyBtnW = (int)buyBtn.width, buyBtnH = (int)buyBtn.height;
+            int buyBtnX = (int)buyBtn.x;
+            int buyBtnY = (int)buyBtn.y;
+            bool hoverBuy = CheckCollisionPointRec(mouse, buyBtn);
             Color buyBg  = canAfford ? (hoverBuy ? (Color){ 70, 55, 20, 230 } :
                                                     (Color){ 50, 38, 12, 200 }) :
                                        (Color){ 30, 28, 24, 160 };
@@ -3316,27 +9731,18 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
             DrawRectangleLines(buyBtnX, buyBtnY, buyBtnW, buyBtnH, buyBdr);
             int buyTW = MeasureText("BUY", 14);
             DrawText("BUY", buyBtnX + buyBtnW / 2 - buyTW / 2, buyBtnY + 9, 14, buyTxt);
-
-            if (canAfford && clicked && hoverBuy) {
-                *tokenCount -= carryCost;
-                *tokenAnimTimer = 0.4f;
-                *tokenAnimDelta = -1;
-                *carryUpgradePurchased = true;
-                *maxInventoryPtr       = 10;
-            }
         }
     }
 
     // ----------------------------------------------------------------
     // CLOSE BUTTON (bottom center of panel)
     // ----------------------------------------------------------------
-    int closeBtnW = 140;
-    int closeBtnH = 36;
-    int closeBtnX = panelX + panelW / 2 - closeBtnW / 2;
-    int closeBtnY = panelY + panelH - closeBtnH - 12;
+    int closeBtnW = (int)layout->closeButton.width;
+    int closeBtnH = (int)layout->closeButton.height;
+    int closeBtnX = (int)layout->closeButton.x;
+    int closeBtnY = (int)layout->closeButton.y;
 
-    bool hoverClose = (mouse.x >= closeBtnX && mouse.x < closeBtnX + closeBtnW &&
-                       mouse.y >= closeBtnY && mouse.y < closeBtnY + closeBtnH);
+    bool hoverClose = CheckCollisionPointRec(mouse, layout->closeButton);
     Color closeBg  = hoverClose ? (Color){ 60, 30, 20, 230 } : (Color){ 40, 24, 16, 200 };
 
     DrawRectangle(closeBtnX, closeBtnY, closeBtnW, closeBtnH, closeBg);
@@ -3346,10 +9752,4 @@ void DrawTradeScreenUI(InventorySlot *inventory, int maxInventory,
     int closeLblW = MeasureText(closeLbl, 13);
     DrawText(closeLbl, closeBtnX + closeBtnW / 2 - closeLblW / 2, closeBtnY + 11, 13,
              (Color){ 232, 224, 216, 255 });
-
-    if (IsKeyPressed(KEY_ESCAPE) ||
-        (clicked && hoverClose)) {
-        *tradeScreenOpen  = false;
-        *selectedTradeSlot = -1;
-    }
 }